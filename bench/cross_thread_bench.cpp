@@ -0,0 +1,99 @@
+#include <array>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#include "memaw/literals.hpp"
+
+#include "resource_bench_base.hpp"
+
+using namespace memaw;
+using namespace memaw::bench;
+
+// A bounded single-producer single-consumer queue of pointers
+class ctb_channel {
+public:
+  bool push(void* const ptr) noexcept {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == capacity)
+      return false;
+
+    slots_[tail % capacity] = ptr;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  void* pop() noexcept {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+
+    const auto result = slots_[head % capacity];
+    head_.store(head + 1, std::memory_order_release);
+    return result;
+  }
+
+private:
+  constexpr static size_t capacity = 1024;
+
+  alignas(64) std::atomic<size_t> head_ = 0;
+  alignas(64) std::atomic<size_t> tail_ = 0;
+  std::array<void*, capacity> slots_;
+};
+
+// Producer/consumer: the threads are split into pairs, the first of
+// which allocates the regions and passes them to the second one to
+// deallocate (the cross-thread frees)
+template <resource R>
+void BM_cross_thread(benchmark::State& state) {
+  const auto size = ceil_size<R>(size_t(state.range(0)));
+  shared_instance<R> res{state};
+
+  static std::unique_ptr<ctb_channel[]> channels;
+  if (state.thread_index() == 0)
+    channels = std::make_unique<ctb_channel[]>(state.threads() / 2);
+
+  const bool is_producer = state.thread_index() % 2 == 0;
+  const auto channel_id = size_t(state.thread_index() / 2);
+
+  // An odd thread out just frees its own regions
+  const bool has_pair = channel_id < size_t(state.threads() / 2);
+
+  // All the threads run the same number of iterations, so every
+  // region produced is also consumed
+  for (auto _ : state) {
+    if (!has_pair) [[unlikely]] {
+      const auto ptr = (*res).allocate(size);
+      benchmark::DoNotOptimize(ptr);
+      (*res).deallocate(ptr, size);
+      continue;
+    }
+
+    auto& channel = channels[channel_id];
+    if (is_producer) {
+      const auto ptr = (*res).allocate(size);
+      benchmark::DoNotOptimize(ptr);
+      while (!channel.push(ptr)) std::this_thread::yield();
+    }
+    else {
+      void* ptr;
+      while (!(ptr = channel.pop())) std::this_thread::yield();
+      (*res).deallocate(ptr, size);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  res.finish(state);
+}
+
+#define CTB_BENCHMARK(R)                                    \
+  BENCHMARK_TEMPLATE(BM_cross_thread, R)->Arg(64)->Arg(1024) \
+    ->ThreadRange(2, get_max_threads())->UseRealTime()
+
+CTB_BENCHMARK(malloc_resource);
+CTB_BENCHMARK(pmr_synchronized_pool_t);
+CTB_BENCHMARK(pool_t);
+CTB_BENCHMARK(pool_cached_t);
+CTB_BENCHMARK(cache_t);
+CTB_BENCHMARK(cache_arenas_t);
@@ -0,0 +1,54 @@
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+
+#include "memaw/backoff_resource.hpp"
+#include "memaw/chain_resource.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/os_resource.hpp"
+#include "memaw/pages_resource.hpp"
+
+#include "resource_bench_base.hpp"
+
+using namespace memaw;
+using namespace memaw::bench;
+
+using big_or_regular_pages_t =
+  chain_resource<big_pages_resource, regular_pages_resource>;
+
+using backoff_big_or_regular_pages_t =
+  chain_resource<backoff_resource<big_pages_resource>,
+                 regular_pages_resource>;
+
+constexpr size_t pb_batch_size = 16;
+
+// Allocates a batch of big regions directly from the system (touching
+// the first byte of each), then frees them
+template <resource R>
+void BM_pages(benchmark::State& state) {
+  const auto size = ceil_size<R>(size_t(state.range(0)));
+  shared_instance<R> res{state};
+
+  std::array<void*, pb_batch_size> ptrs;
+  for (auto _ : state) {
+    for (auto& ptr : ptrs) {
+      ptr = (*res).allocate(size);
+      if (ptr) *static_cast<volatile char*>(ptr) = 1;
+    }
+    for (const auto ptr : ptrs)
+      if (ptr) (*res).deallocate(ptr, size);
+  }
+
+  state.SetItemsProcessed(state.iterations() * pb_batch_size);
+  res.finish(state);
+}
+
+#define PB_BENCHMARK(R)                                  \
+  BENCHMARK_TEMPLATE(BM_pages, R)->Arg(64_KiB)->Arg(2_MiB) \
+    ->ThreadRange(1, get_max_threads())->UseRealTime()
+
+PB_BENCHMARK(malloc_resource);
+PB_BENCHMARK(os_resource);
+PB_BENCHMARK(regular_pages_resource);
+PB_BENCHMARK(big_or_regular_pages_t);
+PB_BENCHMARK(backoff_big_or_regular_pages_t);
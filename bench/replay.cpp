@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "memaw/cache_resource.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/os_resource.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+#include "memaw/resource_traits.hpp"
+#include "memaw/stats_resource.hpp"
+#include "memaw/tracing_resource.hpp"
+
+#include "resource_bench_base.hpp"
+
+/**
+ * @file
+ * Replays the traces written by tracing_resource against several
+ * configurations of the library resources and reports, for each one,
+ * the time of the replay, the peak RSS, the upstream calls and the
+ * fragmentation.
+ *
+ * Usage: memaw_replay <trace file>...
+ *
+ * The configurations are listed at the bottom of the file (add the
+ * ones to try there). The calls are replayed in a single thread in the
+ * order of their timestamps, so the report reflects the sizes and the
+ * lifetimes of the allocations rather than the contention.
+ **/
+
+using namespace memaw;
+using namespace memaw::bench;
+
+/**
+ * @brief A call of the trace with the region referred to by the index
+ *        of its slot (reused after deallocation) instead of an address
+ **/
+struct replay_op {
+  size_t slot;
+  size_t size;
+  size_t alignment;
+  bool is_allocate;
+};
+
+struct replay_trace {
+  std::vector<replay_op> ops;
+  size_t slots_count;
+
+  size_t peak_live_bytes;  // the maximum of the requested bytes in use
+  size_t skipped;          // the records with no matching allocation
+};
+
+/**
+ * @brief Reads the trace file, orders the records by timestamp and
+ *        matches the deallocations to the allocations
+ **/
+std::optional<replay_trace> load_trace(const char* const path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return std::nullopt;
+
+  std::vector<trace_record> records;
+  for (trace_record record;
+       file.read(reinterpret_cast<char*>(&record), sizeof(record));)
+    records.push_back(record);
+
+  // The buffers of different threads are interleaved in the file
+  std::ranges::stable_sort(records, {}, &trace_record::timestamp);
+
+  replay_trace result = {};
+  result.ops.reserve(records.size());
+
+  std::unordered_map<uint64_t, size_t> live;  // address to slot
+  std::vector<size_t> free_slots;
+  size_t live_bytes = 0;
+
+  for (const auto& record : records) {
+    const auto alignment = size_t(1) << record.alignment_log;
+
+    switch (record.event) {
+    case trace_event::allocate: {
+      size_t slot = result.slots_count;
+      if (free_slots.empty()) ++result.slots_count;
+      else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+      }
+
+      if (!live.emplace(record.address, slot).second) {
+        // Should not happen unless the traced resource is sweeping
+        ++result.skipped;
+        free_slots.push_back(slot);
+        break;
+      }
+
+      result.ops.push_back({ .slot = slot, .size = record.size,
+                             .alignment = alignment, .is_allocate = true });
+
+      live_bytes+= record.size;
+      result.peak_live_bytes = std::max(result.peak_live_bytes, live_bytes);
+      break;
+    }
+
+    case trace_event::deallocate: {
+      const auto it = live.find(record.address);
+      if (it == live.end()) {
+        // Allocated before the tracing has started
+        ++result.skipped;
+        break;
+      }
+
+      result.ops.push_back({ .slot = it->second, .size = record.size,
+                             .alignment = alignment, .is_allocate = false });
+
+      free_slots.push_back(it->second);
+      live.erase(it);
+      live_bytes-= std::min(live_bytes, size_t(record.size));
+      break;
+    }
+
+    case trace_event::failed_allocate:
+      break;
+    }
+  }
+
+  return result;
+}
+
+// The upstream of the library resources: counts the calls and tracks
+// the peak exactly (since the replay is single-threaded)
+using replay_upstream_t =
+  stats_resource<regular_pages_resource,
+                 stats_resource_config{ .shards_count = 1,
+                                        .peak_granularity = 1 }>;
+
+/**
+ * @brief Replays the trace with a new instance of R. If touch is
+ *        true, writes a byte to every page of every allocated region
+ *        and returns the peak RSS growth (sampled every few thousand
+ *        calls). Returns the time of the replay otherwise
+ **/
+template <resource R>
+double run_replay(const replay_trace& trace, const bool touch,
+                  size_t& failed, resource_stats& upstream_stats) {
+  constexpr size_t rss_period = 4096;
+  const auto page_size = size_t(os_resource::get_page_size());
+
+  std::vector<void*> slots(trace.slots_count);
+  const auto rss_before = get_rss();
+  size_t peak_rss = rss_before;
+
+  auto res = std::make_unique<R>();
+  failed = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < trace.ops.size(); ++i) {
+    const auto& op = trace.ops[i];
+    const auto size = ceil_size<R>(op.size);
+    auto& ptr = slots[op.slot];
+
+    if (op.is_allocate) {
+      ptr = res->allocate(size, op.alignment);
+      if (!ptr) ++failed;
+      else if (touch) {
+        for (size_t offset = 0; offset < size; offset+= page_size)
+          static_cast<volatile std::byte*>(ptr)[offset] = std::byte{1};
+      }
+    }
+    else if (ptr) {
+      res->deallocate(ptr, size, op.alignment);
+      ptr = nullptr;
+    }
+
+    if (touch && i % rss_period == 0)
+      peak_rss = std::max(peak_rss, get_rss());
+  }
+  const auto finish = std::chrono::steady_clock::now();
+
+  if (touch) peak_rss = std::max(peak_rss, get_rss());
+
+  if constexpr (requires { res->upstream().get_stats(); })
+    upstream_stats = res->upstream().get_stats();
+  else upstream_stats = {};
+
+  // Return what's left (the regions never freed in the trace)
+  for (size_t i = trace.ops.size(); i > 0; --i) {
+    const auto& op = trace.ops[i - 1];
+    auto& ptr = slots[op.slot];
+    if (op.is_allocate && ptr) {
+      res->deallocate(ptr, ceil_size<R>(op.size), op.alignment);
+      ptr = nullptr;
+    }
+  }
+
+  if (touch) return double(peak_rss - rss_before);
+  return std::chrono::duration<double>(finish - start).count();
+}
+
+/**
+ * @brief Replays the trace with R twice (for the time and for the
+ *        memory usage) and prints a line of the report
+ **/
+template <resource R>
+void replay(const char* const name, const replay_trace& trace) {
+  size_t failed;
+  resource_stats stats;
+
+  const auto seconds = run_replay<R>(trace, false, failed, stats);
+  const auto rss = run_replay<R>(trace, true, failed, stats);
+
+  std::printf("%-24s %10.2f %8.1f %10.2f", name, seconds * 1e3,
+              seconds * 1e9 / double(std::max<size_t>(trace.ops.size(), 1)),
+              rss / double(1_MiB));
+
+  // Fragmentation: the share of the memory taken from the upstream at
+  // the peak that was never requested by the trace
+  if (stats.allocations) {
+    std::printf(" %10zu %10zu %10.2f %6.1f%%",
+                stats.allocations, stats.deallocations,
+                double(stats.peak_bytes) / double(1_MiB),
+                stats.peak_bytes > trace.peak_live_bytes
+                ? 100.0 * double(stats.peak_bytes - trace.peak_live_bytes)
+                  / double(stats.peak_bytes)
+                : 0.0);
+  }
+  else std::printf(" %10s %10s %10s %7s", "-", "-", "-", "-");
+
+  if (failed) std::printf("  (%zu failed)", failed);
+  std::printf("\n");
+}
+
+// The configurations to compare
+
+template <size_t _max_chunk_size, size_t _multiplier,
+          large_allocation_mode _large = large_allocation_mode::split>
+constexpr pool_resource_config replay_pool_config = {
+  .min_chunk_size = pow2_t{64},
+  .max_chunk_size = _max_chunk_size,
+  .chunk_size_multiplier = _multiplier,
+  .thread_safe = false,
+  .large_allocations = _large
+};
+
+template <size_t _min_block_size, double _multiplier>
+constexpr cache_resource_config replay_cache_config = {
+  .granularity = pow2_t{64},
+  .min_block_size = _min_block_size,
+  .block_size_multiplier = _multiplier,
+  .thread_safe = false,
+  .max_reused_size = 4_KiB
+};
+
+template <auto _config>
+using replay_pool_t = pool_resource<replay_upstream_t, _config>;
+
+template <auto _config>
+using replay_cache_t = cache_resource<replay_upstream_t, _config>;
+
+using pool_4k_x2 = replay_pool_t<replay_pool_config<4_KiB, 2>>;
+using pool_16k_x2 = replay_pool_t<replay_pool_config<16_KiB, 2>>;
+using pool_16k_x4 = replay_pool_t<replay_pool_config<16_KiB, 4>>;
+using pool_16k_x2_pass =
+  replay_pool_t<replay_pool_config<16_KiB, 2,
+                                   large_allocation_mode::pass_through>>;
+using pool_16k_x2_cached =
+  replay_pool_t<replay_pool_config<16_KiB, 2,
+                                   large_allocation_mode::cached>>;
+
+using cache_1m_x2 = replay_cache_t<replay_cache_config<1_MiB, 2.0>>;
+using cache_32m_x2 = replay_cache_t<replay_cache_config<32_MiB, 2.0>>;
+
+#define REPLAY(R) replay<R>(#R, trace)
+
+void replay_all(const replay_trace& trace) {
+  REPLAY(malloc_resource);
+  REPLAY(pool_4k_x2);
+  REPLAY(pool_16k_x2);
+  REPLAY(pool_16k_x4);
+  REPLAY(pool_16k_x2_pass);
+  REPLAY(pool_16k_x2_cached);
+  REPLAY(cache_1m_x2);
+  REPLAY(cache_32m_x2);
+}
+
+int main(const int argc, const char* const* const argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s <trace file>...\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    const auto trace = load_trace(argv[i]);
+    if (!trace) {
+      std::fprintf(stderr, "Cannot read %s\n", argv[i]);
+      return 1;
+    }
+
+    std::printf("%s: %zu calls, peak %.2f MiB in use, %zu skipped\n",
+                argv[i], trace->ops.size(),
+                double(trace->peak_live_bytes) / double(1_MiB),
+                trace->skipped);
+    std::printf("%-24s %10s %8s %10s %10s %10s %10s %7s\n",
+                "resource", "time_ms", "ns/call", "rss_MiB",
+                "up_allocs", "up_frees", "up_MiB", "frag");
+
+    replay_all(*trace);
+    std::printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <thread>
+
+#include "memaw/cache_resource.hpp"
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/os_resource.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+#include "memaw/resource_traits.hpp"
+
+using std::size_t;
+
+namespace memaw::bench {
+
+/**
+ * @brief The baseline: a resource calling std::malloc()/std::free()
+ *        (or their aligned versions when necessary)
+ **/
+struct malloc_resource {
+  constexpr static bool is_thread_safe = true;
+
+  void* allocate(const size_t size,
+                 const size_t alignment = alignof(std::max_align_t))
+    noexcept {
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+
+#ifdef _MSC_VER
+    return _aligned_malloc(size, alignment);
+#else
+    // NB: std::aligned_alloc() requires a multiple of the alignment
+    return std::aligned_alloc(alignment,
+                              (size + alignment - 1) & ~(alignment - 1));
+#endif
+  }
+
+  void deallocate(void* const ptr, size_t,
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept {
+#ifdef _MSC_VER
+    if (alignment > alignof(std::max_align_t)) return _aligned_free(ptr);
+#else
+    (void)alignment;
+#endif
+    std::free(ptr);
+  }
+
+  bool operator==(const malloc_resource&) const noexcept = default;
+};
+
+/**
+ * @brief A resource owning a standard polymorphic resource of type T
+ *        and forwarding the calls to it
+ **/
+template <typename T>
+struct pmr_resource {
+  void* allocate(const size_t size,
+                 const size_t alignment = alignof(std::max_align_t)) {
+    return impl->allocate(size, alignment);
+  }
+
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t alignment = alignof(std::max_align_t)) {
+    impl->deallocate(ptr, size, alignment);
+  }
+
+  bool operator==(const pmr_resource& rhs) const noexcept {
+    return impl == rhs.impl;
+  }
+
+  std::unique_ptr<T> impl = std::make_unique<T>();
+};
+
+// The standard resources to compare with
+using pmr_pool_t = pmr_resource<std::pmr::unsynchronized_pool_resource>;
+using pmr_synchronized_pool_t =
+  pmr_resource<std::pmr::synchronized_pool_resource>;
+using pmr_monotonic_t = pmr_resource<std::pmr::monotonic_buffer_resource>;
+
+// The configurations of the library resources for small objects (up
+// to 4KiB), on top of regular pages
+template <bool _thread_safe, size_t _thread_cache_size = 0>
+constexpr pool_resource_config bench_pool_config = {
+  .min_chunk_size = pow2_t{64},
+  .max_chunk_size = 4_KiB,
+  .chunk_size_multiplier = 2,
+  .thread_safe = _thread_safe,
+  .thread_cache_size = _thread_cache_size
+};
+
+template <bool _thread_safe, size_t _thread_arena_size = 0>
+constexpr cache_resource_config bench_cache_config = {
+  .granularity = pow2_t{64},
+  .thread_safe = _thread_safe,
+  .max_reused_size = 4_KiB,
+  .thread_arena_size = _thread_arena_size
+};
+
+using pool_t = pool_resource<regular_pages_resource, bench_pool_config<true>>;
+using pool_unsafe_t =
+  pool_resource<regular_pages_resource, bench_pool_config<false>>;
+using pool_cached_t =
+  pool_resource<regular_pages_resource, bench_pool_config<true, 64>>;
+
+using cache_t =
+  cache_resource<regular_pages_resource, bench_cache_config<true>>;
+using cache_unsafe_t =
+  cache_resource<regular_pages_resource, bench_cache_config<false>>;
+using cache_arenas_t =
+  cache_resource<regular_pages_resource, bench_cache_config<true, 64_KiB>>;
+
+/**
+ * @brief Returns the resident set size of the process (or 0 if it
+ *        cannot be determined on this system)
+ **/
+inline size_t get_rss() noexcept {
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0, resident_pages = 0;
+  if (statm >> total_pages >> resident_pages)
+    return resident_pages * size_t(os_resource::get_page_size());
+#endif
+  return 0;
+}
+
+/**
+ * @brief The maximum number of threads to scale the thread safe
+ *        benchmarks to
+ **/
+inline int get_max_threads() noexcept {
+  const auto result = int(std::thread::hardware_concurrency());
+  return result > 1 ? result : 2;
+}
+
+/**
+ * @brief Holds the instance of the resource shared by all the threads
+ *        of a benchmark. Thread 0 creates it before the measurement
+ *        loop (that starts with a barrier) and destroys it after
+ **/
+template <typename R>
+class shared_instance {
+public:
+  explicit shared_instance(const benchmark::State& state):
+    is_owner_(state.thread_index() == 0) {
+    if (is_owner_) instance_ = std::make_unique<R>();
+  }
+
+  shared_instance(const shared_instance&) = delete;
+  shared_instance& operator=(const shared_instance&) = delete;
+
+  R& operator*() const noexcept {
+    return *instance_;
+  }
+
+  /**
+   * @brief Reports the RSS (while the resource is still alive) and
+   *        destroys the resource. Must be called after the loop
+   **/
+  void finish(benchmark::State& state) noexcept {
+    if (!is_owner_) return;
+
+    state.counters["rss_MiB"] = double(get_rss()) / 1_MiB;
+    instance_.reset();
+  }
+
+private:
+  bool is_owner_;
+  inline static std::unique_ptr<R> instance_;
+};
+
+/**
+ * @brief Returns the size of the allocation the resource R must be
+ *        asked for to get at least the given number of bytes
+ **/
+template <resource R>
+constexpr size_t ceil_size(const size_t size) noexcept {
+  return resource_traits<R>::ceil_allocation_size(size);
+}
+
+} // namespace memaw::bench
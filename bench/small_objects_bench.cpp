@@ -0,0 +1,123 @@
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "memaw/literals.hpp"
+
+#include "resource_bench_base.hpp"
+
+using namespace memaw;
+using namespace memaw::bench;
+
+// NB: only const values are passed to benchmark::DoNotOptimize() here
+// since some versions of GCC miscompile its non-const overload
+
+constexpr size_t sob_batch_size = 64;
+
+// Allocates a batch of regions of the same size, then frees them in
+// the same order
+template <resource R>
+void BM_fixed_size(benchmark::State& state) {
+  const auto size = ceil_size<R>(size_t(state.range(0)));
+  shared_instance<R> res{state};
+
+  std::array<void*, sob_batch_size> ptrs;
+  for (auto _ : state) {
+    for (auto& ptr : ptrs) {
+      const auto result = (*res).allocate(size);
+      benchmark::DoNotOptimize(result);
+      ptr = result;
+    }
+    for (const auto ptr : ptrs) (*res).deallocate(ptr, size);
+  }
+
+  state.SetItemsProcessed(state.iterations() * sob_batch_size);
+  res.finish(state);
+}
+
+// Keeps a set of live regions of random sizes (from 16 bytes to 4KiB
+// with the logarithm distributed uniformly), replacing a random one of
+// them every time
+template <resource R>
+void BM_random_sizes(benchmark::State& state) {
+  constexpr size_t live_count = 256;
+  constexpr size_t steps_count = 4096;
+
+  struct step_t {
+    size_t slot;
+    size_t size;
+  };
+
+  // Pre-generate everything not to measure the generator
+  std::mt19937_64 rng(state.thread_index());
+  std::uniform_int_distribution<size_t> slot_dist(0, live_count - 1);
+  std::uniform_real_distribution<double> log_dist(4, 12);
+
+  const auto random_size = [&]() {
+    return ceil_size<R>(size_t(std::exp2(log_dist(rng))));
+  };
+
+  std::vector<step_t> steps(steps_count);
+  for (auto& step : steps) step = { slot_dist(rng), random_size() };
+
+  shared_instance<R> res{state};
+
+  // The set is filled during the first steps
+  struct region_t {
+    void* ptr;
+    size_t size;
+  };
+  std::array<region_t, live_count> live = {};
+
+  size_t step_id = 0;
+  for (auto _ : state) {
+    const auto& step = steps[step_id++ % steps_count];
+    auto& region = live[step.slot];
+
+    if (region.ptr) (*res).deallocate(region.ptr, region.size);
+    const auto ptr = (*res).allocate(step.size);
+    benchmark::DoNotOptimize(ptr);
+    region = { ptr, step.size };
+  }
+
+  for (const auto& region : live)
+    if (region.ptr) (*res).deallocate(region.ptr, region.size);
+
+  state.SetItemsProcessed(state.iterations());
+  res.finish(state);
+}
+
+// Single-threaded: all the resources, including the unsynchronized ones
+
+#define SOB_SINGLE_THREADED(R)                              \
+  BENCHMARK_TEMPLATE(BM_fixed_size, R)->Arg(64)->Arg(1024); \
+  BENCHMARK_TEMPLATE(BM_random_sizes, R)
+
+SOB_SINGLE_THREADED(malloc_resource);
+SOB_SINGLE_THREADED(pmr_pool_t);
+SOB_SINGLE_THREADED(pmr_synchronized_pool_t);
+SOB_SINGLE_THREADED(pmr_monotonic_t);
+SOB_SINGLE_THREADED(pool_t);
+SOB_SINGLE_THREADED(pool_unsafe_t);
+SOB_SINGLE_THREADED(pool_cached_t);
+SOB_SINGLE_THREADED(cache_t);
+SOB_SINGLE_THREADED(cache_unsafe_t);
+SOB_SINGLE_THREADED(cache_arenas_t);
+
+// Thread scaling: only the thread safe resources
+
+#define SOB_MULTITHREADED(R)                              \
+  BENCHMARK_TEMPLATE(BM_fixed_size, R)->Arg(64)           \
+    ->ThreadRange(2, get_max_threads())->UseRealTime();   \
+  BENCHMARK_TEMPLATE(BM_random_sizes, R)                  \
+    ->ThreadRange(2, get_max_threads())->UseRealTime()
+
+SOB_MULTITHREADED(malloc_resource);
+SOB_MULTITHREADED(pmr_synchronized_pool_t);
+SOB_MULTITHREADED(pool_t);
+SOB_MULTITHREADED(pool_cached_t);
+SOB_MULTITHREADED(cache_t);
+SOB_MULTITHREADED(cache_arenas_t);
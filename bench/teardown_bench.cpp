@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "memaw/cache_resource.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+
+#include "resource_bench_base.hpp"
+
+using namespace memaw;
+using namespace memaw::bench;
+
+constexpr pool_resource_config tb_pool_config = {
+  .min_chunk_size = pow2_t{1_KiB},
+  .max_chunk_size = 16_KiB,
+  .thread_safe = false
+};
+
+using tb_pool_t = pool_resource<regular_pages_resource, tb_pool_config>;
+
+constexpr cache_resource_config tb_cache_config = {
+  .granularity = pow2_t{1_KiB},
+  .thread_safe = false,
+  .max_reused_size = 1_KiB
+};
+
+using tb_cache_t = cache_resource<regular_pages_resource, tb_cache_config>;
+
+// Measures the destruction of a resource holding the given number of
+// free 1KiB chunks, deallocated in a random order (so that the free
+// lists have to be sorted to merge the chunks before returning them
+// to the upstream)
+template <resource R>
+void BM_teardown(benchmark::State& state) {
+  const auto count = size_t(state.range(0));
+  std::vector<void*> ptrs(count);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto res = std::make_unique<R>();
+    for (auto& ptr : ptrs) ptr = res->allocate(1_KiB);
+
+    std::ranges::shuffle(ptrs, std::mt19937{42});
+    for (const auto ptr : ptrs)
+      if (ptr) res->deallocate(ptr, 1_KiB);
+    state.ResumeTiming();
+
+    res.reset();
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+#define TB_BENCHMARK(R)                                  \
+  BENCHMARK_TEMPLATE(BM_teardown, R)->RangeMultiplier(4) \
+    ->Range(4_KiB, 256_KiB)->Unit(benchmark::kMillisecond)
+
+TB_BENCHMARK(tb_pool_t);
+TB_BENCHMARK(tb_cache_t);
@@ -0,0 +1,104 @@
+#pragma once
+#include <concepts>
+#include <type_traits>
+#include <utility>
+
+#include "../concepts.hpp"
+
+/**
+ * @file
+ * The common base of the resource adaptors that forward all the calls
+ * to a single underlying resource (and model the same concepts)
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+/**
+ * @brief Holds the underlying resource of an adaptor and defines all
+ *        the traits, the static functions and the methods that the
+ *        adaptor just takes from (or forwards to) the upstream, so
+ *        that the adaptor models all the same concepts. The adaptor
+ *        itself only defines allocate(), deallocate() and whatever it
+ *        adds on top of them
+ **/
+template <resource R>
+class adaptor_base {
+public:
+  /**
+   * @brief The underlying resource (a template parameter)
+   **/
+  using upstream_t = R;
+
+  constexpr static bool is_granular = granular_resource<upstream_t>;
+  constexpr static bool is_sweeping = sweeping_resource<upstream_t>;
+  constexpr static bool is_thread_safe = thread_safe_resource<upstream_t>;
+
+  constexpr static bool has_equal_instances = equal_instances<upstream_t>;
+
+  template <resource T>
+  constexpr static bool is_interchangeable_with =
+    interchangeable_resource_with<upstream_t, T>;
+
+  template <resource T>
+  constexpr static bool is_substitutable_for =
+    substitutable_resource_for<upstream_t, T>;
+
+  /**
+   * @brief Returns the minimum allocation size of the upstream (is
+   *        only defined if it is bound)
+   **/
+  constexpr static size_t min_size() noexcept
+    requires(bound_resource<upstream_t>) {
+    return upstream_t::min_size();
+  }
+
+  /**
+   * @brief Returns the guaranteed alignment of the upstream (is only
+   *        defined if it is overaligning)
+   **/
+  constexpr static pow2_t guaranteed_alignment() noexcept
+    requires(overaligning_resource<upstream_t>) {
+    return upstream_t::guaranteed_alignment();
+  }
+
+  /**
+   * @brief Returns the underlying resource
+   **/
+  upstream_t& upstream() noexcept {
+    return upstream_;
+  }
+
+  /**
+   * @brief Forwards the call to the upstream purge() (is only defined
+   *        if it is a purging_resource)
+   **/
+  void purge(void* const ptr, const size_t size) noexcept
+    requires(purging_resource<upstream_t>) {
+    upstream_.purge(ptr, size);
+  }
+
+  constexpr bool operator==(const adaptor_base& rhs) const
+    noexcept(nothrow_equality_comparable<upstream_t>)
+    requires(!has_equal_instances) {
+    return upstream_ == rhs.upstream_;
+  }
+
+protected:
+  constexpr adaptor_base()
+    noexcept(std::is_nothrow_default_constructible_v<upstream_t>)
+    requires(std::default_initializable<upstream_t>) {}
+
+  constexpr adaptor_base(upstream_t&& upstream)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    upstream_(std::move(upstream)) {}
+
+  constexpr adaptor_base(adaptor_base&&)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>) = default;
+
+  [[no_unique_address]] upstream_t upstream_;
+};
+
+} // namespace memaw::__detail
@@ -0,0 +1,126 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "base.hpp"
+
+/**
+ * @file
+ * A helper thread that runs a job of its owner on request
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+/**
+ * @brief A single helper thread, started on the first request, that
+ *        calls job(context) once per request (the requests made while
+ *        the job is already pending are merged) until stopped
+ * @note  The thread refers to the owner through the context, so the
+ *        worker is neither copyable nor movable (the owner is to stop
+ *        it and start a new one instead)
+ **/
+class background_worker {
+public:
+  using job_t = void (*)(void*) noexcept;
+
+  background_worker() noexcept = default;
+
+  background_worker(const background_worker&) = delete;
+  background_worker& operator=(const background_worker&) = delete;
+
+  ~background_worker() noexcept {
+    stop();
+  }
+
+  /**
+   * @brief Makes the thread call job(context) soon, starting it if
+   *        necessary
+   * @return false if the thread could not be started (then the job
+   *         is not going to be called)
+   **/
+  inline bool request(job_t, void*) noexcept;
+
+  /**
+   * @brief Waits for the job in progress (if any) to finish and joins
+   *        the thread. The pending request is dropped. A following
+   *        request() starts a new thread
+   **/
+  inline void stop() noexcept;
+
+private:
+  inline void run() noexcept;
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+
+  job_t job_ = nullptr;
+  void* context_ = nullptr;
+
+  bool is_pending_ = false;
+  bool is_stopping_ = false;
+
+  std::thread thread_;
+};
+
+bool background_worker::request(const job_t job, void* const context)
+  noexcept {
+  {
+    const std::lock_guard lock{mutex_};
+    job_ = job;
+    context_ = context;
+    is_pending_ = true;
+
+    if (!thread_.joinable()) {
+#ifdef __cpp_exceptions
+      try {
+        thread_ = std::thread{[this]() noexcept { run(); }};
+      } catch (...) {
+        is_pending_ = false;
+        return false;
+      }
+#else
+      thread_ = std::thread{[this]() noexcept { run(); }};
+#endif
+      return true;
+    }
+  }
+
+  wakeup_.notify_one();
+  return true;
+}
+
+void background_worker::stop() noexcept {
+  {
+    const std::lock_guard lock{mutex_};
+    if (!thread_.joinable()) return;
+    is_stopping_ = true;
+  }
+
+  wakeup_.notify_one();
+  thread_.join();
+
+  // No other thread can touch the fields now
+  is_pending_ = is_stopping_ = false;
+}
+
+void background_worker::run() noexcept {
+  std::unique_lock lock{mutex_};
+  for (;;) {
+    wakeup_.wait(lock, [this] { return is_pending_ || is_stopping_; });
+    if (is_stopping_) return;
+
+    is_pending_ = false;
+    const auto job = job_;
+    const auto context = context_;
+
+    lock.unlock();
+    job(context);
+    lock.lock();
+  }
+}
+
+} // namespace memaw::__detail
@@ -1,11 +1,18 @@
 #pragma once
+#include <array>
 #include <cmath>
+#include <numeric>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
 #include "../resource_traits.hpp"
+#include "background_worker.hpp"
 #include "mem_ref.hpp"
 #include "resource_common.hpp"
+#include "stack.hpp"
+#include "tagged_ptr.hpp"
+#include "thread_registry.hpp"
 
 /**
  * @file
@@ -25,6 +32,21 @@ public:
   constexpr static auto thread_safety = _cfg.thread_safe
     ? thread_safe : thread_unsafe;
 
+  // Free chunks of sizes (i+1)*granularity go to the i-th bin
+  constexpr static size_t bins_count =
+    _cfg.max_reused_size / _cfg.granularity;
+
+  constexpr static bool has_thread_arenas =
+    _cfg.thread_safe && _cfg.thread_arena_size > 0;
+
+  constexpr static bool is_resettable = _cfg.resettable;
+
+  using refill_mode_t = std::remove_cvref_t<decltype(_cfg.refill)>;
+
+  constexpr static bool has_refills = _cfg.refill_watermark > 0;
+  constexpr static bool has_background_refills =
+    has_refills && _cfg.refill == refill_mode_t::background;
+
   constexpr cache_resource_impl()
     noexcept(std::is_nothrow_default_constructible_v<upstream_t>) = default;
 
@@ -36,6 +58,10 @@ public:
 
   constexpr cache_resource_impl(cache_resource_impl&& rhs)
     noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    reuse_bins_(std::move(rhs.reuse_bins_)),
+    arenas_(std::move(rhs.arenas_)),
+    blocks_(std::move(rhs.blocks_)),
+    refill_(rhs.take_refill_state()),
     upstream_(std::move(rhs.upstream_)) {
     head_ = make_mem_ref<thread_safety>(rhs.head_)
       .exchange({}, mo_t::acquire);
@@ -49,6 +75,27 @@ public:
 
   inline void deallocate(void*, size_t, pow2_t = {}) noexcept;
 
+  inline bool expand(void*, size_t, size_t) noexcept;
+
+  inline size_t allocate_batch(size_t, size_t, pow2_t, void**) noexcept;
+  inline void deallocate_batch(size_t, size_t, pow2_t, void* const*) noexcept;
+
+  const upstream_t& get_upstream() const noexcept {
+    return upstream_;
+  }
+
+  inline bool needs_refill() const noexcept requires(has_refills);
+
+  bool refill() noexcept requires(has_refills) {
+    auto status = refill_status_t::idle;
+    if (!make_mem_ref<thread_safety>(refill_.status)
+        .compare_exchange_strong(status, refill_status_t::busy,
+                                 mo_t::acquire, mo_t::relaxed))
+      return false;
+
+    return do_refill();
+  }
+
   bool operator==(const cache_resource_impl& rhs) const noexcept {
     // While inside constructors & assignment operator we can ignore
     // thread safety, here we can't. Thus, for simplicity:
@@ -69,13 +116,43 @@ private:
    **/
   constexpr static size_t get_prev_block_size(const size_t size) noexcept;
 
-  struct alignas(16) head_block_t {
+  struct head_block_t {
     uintptr_t ptr;
     size_t size;
-
-    bool operator==(const head_block_t&) const noexcept = default;
   };
 
+  /**
+   * @brief The representation of the shared head block: a tagged
+   *        pointer with the size as the tag. If packed (with no
+   *        DWCAS), the size is kept in granules, thus the upstream
+   *        blocks are requested in multiples of granularity and the
+   *        head can have at most max_head_size bytes
+   **/
+  using head_t = tagged_ptr<std::byte, thread_safety, _cfg.granularity>;
+
+  constexpr static size_t head_size_unit =
+    head_t::is_packed ? size_t(_cfg.granularity) : 1;
+
+  constexpr static size_t max_head_size =
+    (head_t::max_tag > ~size_t(0) / head_size_unit)
+    ? ~size_t(0) / head_size_unit * head_size_unit
+    : head_t::max_tag * head_size_unit;
+
+  static head_t pack_head(const head_block_t block) noexcept {
+    return { reinterpret_cast<std::byte*>(block.ptr),
+             block.size / head_size_unit };
+  }
+
+  static head_block_t unpack_head(const head_t head) noexcept {
+    return { uintptr_t(head.ptr()), head.tag() * head_size_unit };
+  }
+
+  /**
+   * @brief Returns the size to request from the upstream for a block
+   *        of (at least) the given size
+   **/
+  inline static size_t ceil_block_size(size_t) noexcept;
+
   /**
    * @brief Allocates the given (non-zero) amount of bytes from the
    *        upstream with the regular alignment. On failure returns
@@ -83,7 +160,69 @@ private:
    **/
   inline head_block_t upstream_allocate(size_t) noexcept;
 
-  head_block_t head_ = {};
+public:
+  /**
+   * @brief The header of an upstream block of the resettable cache,
+   *        occupying its first granule(s)
+   **/
+  struct block_t {
+    block_t* next;
+    size_t size;  // as allocated from the upstream
+  };
+
+private:
+  constexpr static size_t block_header_size = is_resettable
+    ? (sizeof(block_t) + _cfg.granularity.get_mask())
+      & ~_cfg.granularity.get_mask()
+    : 0;
+
+  /**
+   * @brief The upstream blocks that are in use (push-only until the
+   *        cache is rewound) and the ones retained by reset() or
+   *        rewind() to be taken again instead of new allocations
+   **/
+  struct blocks_t {
+    stack<block_t, thread_safety> used;
+    stack<block_t, thread_safety> spare;
+  };
+
+  struct no_blocks_t {};
+
+public:
+  /**
+   * @brief A position of the resettable cache: its head and the last
+   *        upstream block at the moment
+   **/
+  class marker_t {
+    friend cache_resource_impl;
+
+    constexpr marker_t(const head_t head, block_t* const block) noexcept:
+      head_(head), block_(block) {}
+
+    head_t head_;
+    block_t* block_;
+  };
+
+  marker_t get_marker() const noexcept requires(is_resettable) {
+    return { head_, blocks_.used.peek() };
+  }
+
+  inline void rewind(const marker_t&) noexcept requires(is_resettable);
+  inline void reset(size_t) noexcept requires(is_resettable);
+
+private:
+  /**
+   * @brief Takes the spare block on the top if it can fit the given
+   *        size (with the header), marking it used again
+   **/
+  inline head_block_t take_spare_block(size_t) noexcept;
+
+  /**
+   * @brief Allocates directly from the shared head (or the upstream)
+   **/
+  inline void* allocate_shared(size_t, pow2_t) noexcept;
+
+  head_t head_;
 
   struct free_chunk_t {
     free_chunk_t* next;
@@ -94,6 +233,113 @@ private:
   };
   free_chunk_t* free_chunks_head_ = nullptr;
 
+  /**
+   * @brief Takes a chunk of the given size suitable for the alignment
+   *        from the corresponding bin (nullptr if there is none)
+   **/
+  inline void* reuse(size_t, pow2_t) noexcept;
+
+  // Unlike the free list above, chunks from here are reused, hence
+  // the ABA-safe stacks
+  std::array<stack<free_chunk_t, thread_safety>, bins_count> reuse_bins_ = {};
+
+  /**
+   * @brief A sub-range of a block claimed by a thread with a single
+   *        allocation from the shared head. Only accessed by its
+   *        owner thread (or in the destructor)
+   **/
+  struct arena_t {
+    uintptr_t ptr;
+    size_t size;
+  };
+
+  struct no_arenas_t {};
+
+  // The size of memory each arena record occupies in the cache
+  constexpr static size_t arena_alloc_size =
+    (sizeof(typename thread_registry<arena_t>::record_t)
+     + _cfg.granularity.get_mask()) & ~_cfg.granularity.get_mask();
+
+  inline arena_t* get_arena() noexcept;
+  inline void* allocate_from_arena(arena_t&, size_t, pow2_t) noexcept;
+
+  // The arena records are allocated from the cache itself and
+  // returned to it in the destructor
+  [[no_unique_address]] std::conditional_t<has_thread_arenas,
+                                           thread_registry<arena_t>,
+                                           no_arenas_t> arenas_;
+
+  [[no_unique_address]] std::conditional_t<is_resettable, blocks_t,
+                                           no_blocks_t> blocks_;
+
+  // NB: plain integers to be usable with the __atomic built-ins
+  struct refill_status_t {
+    constexpr static size_t idle = 0;    // no block is kept aside
+    constexpr static size_t busy = 1;    // being allocated or taken
+    constexpr static size_t ready = 2;   // the block is kept aside
+    constexpr static size_t failed = 3;  // wait for a new current block
+  };
+
+  /**
+   * @brief The next block allocated ahead of time (only valid when
+   *        ready) and the status of the refill
+   **/
+  struct refill_t {
+    size_t status = refill_status_t::idle;
+    head_block_t block = {};
+  };
+
+  struct no_refill_t {};
+  struct no_worker_t {};
+
+  /**
+   * @brief Called after an allocation from the shared head leaving the
+   *        given number of bytes in it: starts a refill as configured
+   *        if that is below the watermark
+   **/
+  inline void on_head_moved(size_t) noexcept;
+
+  /**
+   * @brief Allocates the next block with the status already set to
+   *        busy by the caller and makes it ready (or failed)
+   **/
+  inline bool do_refill() noexcept;
+
+  static void run_refill(void* const self) noexcept {
+    static_cast<cache_resource_impl*>(self)->do_refill();
+  }
+
+  /**
+   * @brief Takes the ready block if it can fit the given size
+   **/
+  inline head_block_t take_refill_block(size_t) noexcept;
+
+  /**
+   * @brief Stops the background refills and takes the refill state
+   *        away (for the move constructor)
+   **/
+  auto take_refill_state() noexcept {
+    if constexpr (has_background_refills) refill_worker_.stop();
+
+    if constexpr (has_refills) {
+      auto result = std::exchange(refill_, refill_t{});
+
+      // NB: stop() drops a pending request, which leaves the status
+      // busy with no block and nobody to ever reset it
+      if (result.status == refill_status_t::busy)
+        result.status = refill_status_t::idle;
+      return result;
+    }
+    else return no_refill_t{};
+  }
+
+  [[no_unique_address]] std::conditional_t<has_refills, refill_t,
+                                           no_refill_t> refill_;
+
+  [[no_unique_address]] std::conditional_t<has_background_refills,
+                                           background_worker,
+                                           no_worker_t> refill_worker_;
+
   size_t last_block_size_ = 0;
   upstream_t upstream_;
 
@@ -132,17 +378,55 @@ constexpr size_t cache_resource_impl<R, _cfg>::get_prev_block_size
 }
 
 template <sweeping_resource R, auto _cfg>
-auto cache_resource_impl<R, _cfg>::upstream_allocate
-  (const size_t size) noexcept -> head_block_t {
+size_t cache_resource_impl<R, _cfg>::ceil_block_size(size_t size) noexcept {
   using traits = resource_traits<upstream_t>;
 
+  if constexpr (head_t::is_packed) {
+    // Make sure the upstream won't ceil the result again
+    size_t unit = _cfg.granularity;
+    if constexpr (traits::is_granular)
+      unit = std::lcm(unit, traits::min_size());
+
+    size = (traits::ceil_allocation_size(size) + unit - 1) / unit * unit;
+  }
+
+  return traits::ceil_allocation_size(size);
+}
+
+template <sweeping_resource R, auto _cfg>
+auto cache_resource_impl<R, _cfg>::take_spare_block
+  (const size_t size) noexcept -> head_block_t {
+  const auto block = blocks_.spare.pop();
+  if (!block) return {};
+
+  if (block->size < size + block_header_size) {
+    blocks_.spare.push(block);  // Leave it for smaller requests
+    return {};
+  }
+
+  blocks_.used.push(block);
+  return { uintptr_t(block) + block_header_size,
+           block->size - block_header_size };
+}
+
+template <sweeping_resource R, auto _cfg>
+auto cache_resource_impl<R, _cfg>::upstream_allocate
+  (size_t size) noexcept -> head_block_t {
+  if constexpr (is_resettable) {
+    // Retained blocks go first, then the new ones get a header
+    if (const auto block = take_spare_block(size); block.size)
+      return block;
+
+    size+= block_header_size;
+  }
+
   // If got here, we'll need to allocate from the upstream. First
   // determine the size we request
   size_t next_size = get_next_block_size();
-  size_t next_allocation = traits::ceil_allocation_size(next_size);
+  size_t next_allocation = ceil_block_size(next_size);
 
   size_t allocation_size = next_allocation >= size
-    ? next_allocation : traits::ceil_allocation_size(size);
+    ? next_allocation : ceil_block_size(size);
 
   for (;;) {
     const auto lbs_ref = make_mem_ref<thread_safety>(last_block_size_);
@@ -154,7 +438,14 @@ auto cache_resource_impl<R, _cfg>::upstream_allocate
        * won't bother with CAS here, this value is more of a
        * recommendation anyway) */
       lbs_ref.store(next_size, mo_t::relaxed);
-      return head_block_t{ uintptr_t(result), allocation_size };
+
+      if constexpr (is_resettable) {
+        blocks_.used.push(new (result) block_t{ .next = nullptr,
+                                                .size = allocation_size });
+      }
+
+      return head_block_t{ uintptr_t(result) + block_header_size,
+                           allocation_size - block_header_size };
     }
     else if (allocation_size > next_allocation)
       // Do not update the lbs if the allocation was overly big
@@ -171,7 +462,7 @@ auto cache_resource_impl<R, _cfg>::upstream_allocate
     }
 
     next_size = get_prev_block_size(next_size);
-    allocation_size = next_allocation = traits::ceil_allocation_size(next_size);
+    allocation_size = next_allocation = ceil_block_size(next_size);
     if (allocation_size < size) {  // Can't reduce that much
       lbs_ref.store(next_size, mo_t::relaxed);
       return {};
@@ -186,15 +477,38 @@ void* cache_resource_impl<R, _cfg>::allocate(const size_t size,
   // pow2_t, so the check is easy)
   if (size % _cfg.granularity) [[unlikely]] return nullptr;
 
-  /* Okay, now load the head. We will use two relaxed atomic reads
-   * here, realizing we can end up loading values from different
-   * blocks (in which case the first CAS will fix that) */
-  auto curr_head = head_block_t {
-    .ptr = make_mem_ref<thread_safety>(head_.ptr).load(mo_t::relaxed),
-    .size = make_mem_ref<thread_safety>(head_.size).load(mo_t::relaxed)
-  };
+  if constexpr (bins_count > 0) {
+    if (size <= _cfg.max_reused_size) {
+      if (const auto result = reuse(size, alignment)) return result;
+    }
+  }
 
-  for (;;) {
+  if constexpr (has_thread_arenas) {
+    // Only take (relatively) small allocations from the arena, so
+    // that a refill never wastes more than a half of it
+    const auto max_padding =
+      alignment > _cfg.granularity ? (alignment - _cfg.granularity) : 0;
+
+    if (size + max_padding <= _cfg.thread_arena_size / 2) {
+      if (const auto arena = get_arena()) [[likely]]
+        return allocate_from_arena(*arena, size, alignment);
+    }
+  }
+
+  return allocate_shared(size, alignment);
+}
+
+template <sweeping_resource R, auto _cfg>
+void* cache_resource_impl<R, _cfg>::allocate_shared
+  (const size_t size, const pow2_t alignment) noexcept {
+  /* Okay, now load the head. Unless packed, we will use two relaxed
+   * atomic reads here, realizing we can end up loading values from
+   * different blocks (in which case the first CAS will fix that) */
+  auto curr_value = head_t::load(head_, mo_t::relaxed);
+  auto curr_head = unpack_head(curr_value);
+
+  const auto head_ref = make_mem_ref<thread_safety>(head_);
+  for (;; curr_head = unpack_head(curr_value)) {
     const auto [result, padding] = align_pointer(curr_head.ptr, alignment);
     const head_block_t new_head = {
       .ptr = result + size,
@@ -204,11 +518,11 @@ void* cache_resource_impl<R, _cfg>::allocate(const size_t size,
     if (new_head.ptr > curr_head.ptr + curr_head.size)
       break;  // We will need a direct allocation
 
-    if (make_mem_ref<thread_safety>(head_)
-        .compare_exchange_weak(curr_head, new_head,
-                               mo_t::acquire, mo_t::relaxed)) {
+    if (head_ref.compare_exchange_weak(curr_value, pack_head(new_head),
+                                       mo_t::acquire, mo_t::relaxed)) {
       // The easy and likely way out
       deallocate(reinterpret_cast<void*>(curr_head.ptr), padding);
+      if constexpr (has_refills) on_head_moved(new_head.size);
       return reinterpret_cast<void*>(result);
     }
   }
@@ -217,7 +531,10 @@ void* cache_resource_impl<R, _cfg>::allocate(const size_t size,
   const auto required_size = size +  // Also require max padding bytes
     (alignment > _cfg.granularity ? (alignment - _cfg.granularity) : 0);
 
-  const auto new_head = upstream_allocate(required_size);
+  head_block_t new_head = {};
+  if constexpr (has_refills) new_head = take_refill_block(required_size);
+
+  if (!new_head.size) new_head = upstream_allocate(required_size);
   if (!new_head.size) return nullptr;  // Couldn't allocate
 
   // Try to install a new head if it has more free size left than the
@@ -226,12 +543,20 @@ void* cache_resource_impl<R, _cfg>::allocate(const size_t size,
   const auto [result, padding] = align_pointer(new_head.ptr, alignment);
   deallocate(reinterpret_cast<void*>(new_head.ptr), padding);
 
-  const head_block_t next_head = {
+  head_block_t next_head = {
     .ptr = result + size,
     .size = new_head.size - size - padding
   };
 
-  for (;;) {
+  if (next_head.size > max_head_size) [[unlikely]] {
+    // Only possible for the packed head: the rest of the block (which
+    // is a non-zero multiple of granularity) is just marked free
+    deallocate(reinterpret_cast<void*>(next_head.ptr + max_head_size),
+               next_head.size - max_head_size);
+    next_head.size = max_head_size;
+  }
+
+  for (;; curr_head = unpack_head(curr_value)) {
     if (curr_head.size >= next_head.size) {
       // The head has more free space: mark the remaining allocated
       // block free
@@ -240,22 +565,220 @@ void* cache_resource_impl<R, _cfg>::allocate(const size_t size,
     }
 
     // The allocated block has more free space: try to exchange
-    if (make_mem_ref<thread_safety>(head_)
-        .compare_exchange_weak(curr_head, next_head,
-                               mo_t::release, mo_t::relaxed)) {
+    if (head_ref.compare_exchange_weak(curr_value, pack_head(next_head),
+                                       mo_t::release, mo_t::relaxed)) {
       // If successful, marks free what's remaining of the old head
       // (if anything)
       deallocate(reinterpret_cast<void*>(curr_head.ptr), curr_head.size);
+
+      if constexpr (has_refills) {
+        // A new block is current, so a failed refill can be retried
+        auto status = refill_status_t::failed;
+        make_mem_ref<thread_safety>(refill_.status)
+          .compare_exchange_strong(status, refill_status_t::idle,
+                                   mo_t::relaxed, mo_t::relaxed);
+        on_head_moved(next_head.size);
+      }
       return reinterpret_cast<void*>(result);
     }
   }
 }
 
+template <sweeping_resource R, auto _cfg>
+bool cache_resource_impl<R, _cfg>::expand(void* const ptr,
+                                          const size_t old_size,
+                                          const size_t new_size) noexcept {
+  if (old_size == new_size) return true;
+
+  const auto end = uintptr_t(ptr) + old_size;
+
+  if constexpr (has_thread_arenas) {
+    // The region may be the last one from this thread's arena
+    if (const auto arena = arenas_.find(); arena && arena->ptr == end) {
+      if (new_size > old_size + arena->size) return false;
+
+      // No atomics here, the arena is ours
+      arena->ptr = uintptr_t(ptr) + new_size;
+      arena->size = arena->size + old_size - new_size;
+      return true;
+    }
+  }
+
+  const auto head_ref = make_mem_ref<thread_safety>(head_);
+  auto curr_value = head_t::load(head_, mo_t::relaxed);
+
+  for (;;) {
+    const auto curr_head = unpack_head(curr_value);
+    if (curr_head.ptr != end) break;  // Not the last allocation
+
+    const head_block_t new_head = {
+      .ptr = uintptr_t(ptr) + new_size,
+      .size = curr_head.size + old_size - new_size
+    };
+
+    // Also fails on overflow when growing
+    if (new_head.size > (new_size > old_size ? curr_head.size
+                                             : max_head_size))
+      break;
+
+    if (head_ref.compare_exchange_weak(curr_value, pack_head(new_head),
+                                       mo_t::relaxed, mo_t::relaxed)) {
+      if constexpr (has_refills) on_head_moved(new_head.size);
+      return true;
+    }
+  }
+
+  if (new_size > old_size) return false;
+
+  // Shrinking is always possible: the tail is just freed
+  deallocate(reinterpret_cast<void*>(uintptr_t(ptr) + new_size),
+             old_size - new_size);
+  return true;
+}
+
+template <sweeping_resource R, auto _cfg>
+bool cache_resource_impl<R, _cfg>::needs_refill() const noexcept
+  requires(has_refills) {
+  // NB: the atomic loads need non-const references
+  auto& self = const_cast<cache_resource_impl&>(*this);
+
+  return make_mem_ref<thread_safety>(self.refill_.status).load(mo_t::relaxed)
+      == refill_status_t::idle
+    && unpack_head(head_t::load(self.head_, mo_t::relaxed)).size
+      < _cfg.refill_watermark;
+}
+
+template <sweeping_resource R, auto _cfg>
+void cache_resource_impl<R, _cfg>::on_head_moved(const size_t left)
+  noexcept {
+  if constexpr (_cfg.refill == refill_mode_t::manual) return;
+  else {
+    if (left >= _cfg.refill_watermark) [[likely]] return;
+
+    // Check first to avoid contending on the status cache line
+    const auto status_ref = make_mem_ref<thread_safety>(refill_.status);
+    auto status = status_ref.load(mo_t::relaxed);
+    if (status != refill_status_t::idle
+        || !status_ref.compare_exchange_strong(status, refill_status_t::busy,
+                                               mo_t::acquire, mo_t::relaxed))
+      return;
+
+    if constexpr (has_background_refills) {
+      if (refill_worker_.request(run_refill, this)) [[likely]] return;
+    }
+
+    do_refill();  // Also if the helper thread could not be started
+  }
+}
+
+template <sweeping_resource R, auto _cfg>
+bool cache_resource_impl<R, _cfg>::do_refill() noexcept {
+  // NB: upstream_allocate() also advances the block size
+  const auto block = upstream_allocate(_cfg.granularity);
+  const auto status_ref = make_mem_ref<thread_safety>(refill_.status);
+
+  if (!block.size) [[unlikely]] {
+    status_ref.store(refill_status_t::failed, mo_t::relaxed);
+    return false;
+  }
+
+  refill_.block = block;
+  status_ref.store(refill_status_t::ready, mo_t::release);
+  return true;
+}
+
+template <sweeping_resource R, auto _cfg>
+auto cache_resource_impl<R, _cfg>::take_refill_block
+  (const size_t size) noexcept -> head_block_t {
+  const auto status_ref = make_mem_ref<thread_safety>(refill_.status);
+
+  auto status = refill_status_t::ready;
+  if (!status_ref.compare_exchange_strong(status, refill_status_t::busy,
+                                          mo_t::acquire, mo_t::relaxed))
+    return {};
+
+  const auto block = refill_.block;
+  if (block.size < size) {  // Leave it for smaller requests
+    status_ref.store(refill_status_t::ready, mo_t::release);
+    return {};
+  }
+
+  status_ref.store(refill_status_t::idle, mo_t::release);
+  return block;
+}
+
+template <sweeping_resource R, auto _cfg>
+auto cache_resource_impl<R, _cfg>::get_arena() noexcept -> arena_t* {
+  return arenas_.get([this](size_t) noexcept {
+    return allocate_shared(arena_alloc_size, _cfg.granularity);
+  });
+}
+
+template <sweeping_resource R, auto _cfg>
+void* cache_resource_impl<R, _cfg>::allocate_from_arena
+  (arena_t& arena, const size_t size, const pow2_t alignment) noexcept {
+  auto [result, padding] = align_pointer(arena.ptr, alignment);
+
+  if (padding + size > arena.size) [[unlikely]] {
+    // Claim a new sub-range, what's left of the old one is freed
+    // like the remainder of an old head
+    const auto new_arena = allocate_shared(_cfg.thread_arena_size,
+                                           _cfg.granularity);
+    if (!new_arena) [[unlikely]] return allocate_shared(size, alignment);
+
+    deallocate(reinterpret_cast<void*>(arena.ptr), arena.size);
+    arena = { .ptr = uintptr_t(new_arena), .size = _cfg.thread_arena_size };
+
+    // Always fits now (see the check in allocate())
+    std::tie(result, padding) = align_pointer(arena.ptr, alignment);
+  }
+
+  // No atomics here, the arena is ours
+  deallocate(reinterpret_cast<void*>(arena.ptr), padding);
+  arena.ptr = result + size;
+  arena.size-= padding + size;
+
+  return reinterpret_cast<void*>(result);
+}
+
+template <sweeping_resource R, auto _cfg>
+void* cache_resource_impl<R, _cfg>::reuse(const size_t size,
+                                          const pow2_t alignment) noexcept {
+  auto& bin = reuse_bins_[size / _cfg.granularity - 1];
+
+  const auto chunk = bin.pop();
+  if (!chunk) return nullptr;
+
+  // Normally every chunk is aligned by granularity, so this only
+  // fails for big alignments. Then just give the chunk back
+  if (uintptr_t(chunk) & alignment.get_mask()) [[unlikely]] {
+    bin.push(chunk);
+    return nullptr;
+  }
+
+  chunk->~free_chunk_t();
+  return chunk;
+}
+
 template <sweeping_resource R, auto _cfg>
 void cache_resource_impl<R, _cfg>::deallocate(void* ptr, const size_t size,
                                               const pow2_t alignment) noexcept {
   if (!ptr || !size) [[unlikely]] return;
 
+  if constexpr (bins_count > 0) {
+    if (size <= _cfg.max_reused_size && size % _cfg.granularity == 0) {
+      reuse_bins_[size / _cfg.granularity - 1]
+        .push(new (ptr) free_chunk_t {
+            .next = nullptr, .size = size, .alignment = alignment
+          });
+      return;
+    }
+  }
+
+  // The resettable cache reclaims whole blocks, so the free list is
+  // not needed
+  if constexpr (is_resettable) return;
+
   const auto head_ref = make_mem_ref<thread_safety>(free_chunks_head_);
 
   auto chunk = new (ptr) free_chunk_t {
@@ -271,23 +794,181 @@ void cache_resource_impl<R, _cfg>::deallocate(void* ptr, const size_t size,
                                          mo_t::release, mo_t::relaxed));
 }
 
+template <sweeping_resource R, auto _cfg>
+size_t cache_resource_impl<R, _cfg>::allocate_batch
+  (const size_t count, const size_t size, const pow2_t alignment,
+   void** const out) noexcept {
+  if (!size || size % _cfg.granularity) [[unlikely]] return 0;
+
+  size_t result = 0;
+
+  // Regions of a multiple of granularity are all aligned by it, so
+  // they can just be laid out one after another
+  const bool is_contiguous = alignment <= _cfg.granularity;
+
+  if constexpr (bins_count > 0) {
+    // Pop the chunks off the bin one by one, leaving the rest of it
+    // available to the other threads
+    if (is_contiguous && size <= _cfg.max_reused_size) {
+      auto& bin = reuse_bins_[size / _cfg.granularity - 1];
+
+      while (result < count) {
+        const auto chunk = bin.pop();
+        if (!chunk) break;
+        chunk->~free_chunk_t();
+        out[result++] = chunk;
+      }
+    }
+  }
+
+  // Then allocate all the rest as a single region (i.e., move the
+  // head once) unless the size overflows
+  const auto left = count - result;
+  if (left && is_contiguous && left <= ~size_t(0) / size) {
+    if (const auto ptr = allocate(left * size, alignment)) {
+      for (auto region = uintptr_t(ptr); result < count; region+= size)
+        out[result++] = reinterpret_cast<void*>(region);
+      return result;
+    }
+  }
+
+  // If that failed (or the alignment is big), go one by one
+  for (; result < count; ++result) {
+    out[result] = allocate(size, alignment);
+    if (!out[result]) [[unlikely]] break;
+  }
+
+  return result;
+}
+
+template <sweeping_resource R, auto _cfg>
+void cache_resource_impl<R, _cfg>::deallocate_batch
+  (const size_t count, const size_t size, const pow2_t alignment,
+   void* const* const ptrs) noexcept {
+  if (!size) [[unlikely]] return;
+
+  // Pre-build the list of chunks to push it with a single CAS
+  free_chunk_t* head = nullptr;
+  free_chunk_t* last = nullptr;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!ptrs[i]) [[unlikely]] continue;
+
+    const auto chunk = new (ptrs[i]) free_chunk_t {
+      .next = head, .size = size, .alignment = alignment
+    };
+    if (!head) last = chunk;
+    head = chunk;
+  }
+
+  if (!head) return;
+
+  if constexpr (bins_count > 0) {
+    if (size <= _cfg.max_reused_size && size % _cfg.granularity == 0) {
+      reuse_bins_[size / _cfg.granularity - 1].push(head, last);
+      return;
+    }
+  }
+
+  if constexpr (is_resettable) return;  // See deallocate()
+
+  const auto head_ref = make_mem_ref<thread_safety>(free_chunks_head_);
+
+  last->next = head_ref.load(mo_t::relaxed);
+  while (!head_ref.compare_exchange_weak(last->next, head,
+                                         mo_t::release, mo_t::relaxed));
+}
+
+template <sweeping_resource R, auto _cfg>
+void cache_resource_impl<R, _cfg>::rewind(const marker_t& marker) noexcept
+  requires(is_resettable) {
+  // The blocks allocated after the marker are kept for reuse, the
+  // chunks freed since then might be inside them, so drop them all
+  while (blocks_.used.peek() != marker.block_)
+    blocks_.spare.push(blocks_.used.pop());
+
+  for (auto& bin : reuse_bins_) bin.reset();
+  head_ = marker.head_;
+}
+
+template <sweeping_resource R, auto _cfg>
+void cache_resource_impl<R, _cfg>::reset(const size_t max_retained_size)
+  noexcept requires(is_resettable) {
+  std::array lists = { blocks_.used.reset(), blocks_.spare.reset() };
+
+  // The most recent (and, normally, the biggest) blocks are retained
+  // first, the rest go back to the upstream
+  size_t retained_size = 0;
+  for (auto block : lists) {
+    while (block) {
+      const auto next = block->next;
+
+      if (block->size <= max_retained_size - retained_size) {
+        retained_size+= block->size;
+        blocks_.spare.push(block);
+      }
+      else {
+        const auto size = block->size;
+        block->~block_t();
+
+        memaw::deallocate<exceptions_policy::nothrow>
+          (upstream_, block, size, _cfg.granularity);
+      }
+
+      block = next;
+    }
+  }
+
+  for (auto& bin : reuse_bins_) bin.reset();
+  head_ = {};
+}
+
 template <sweeping_resource R, auto _cfg>
 cache_resource_impl<R, _cfg>::~cache_resource_impl() noexcept {
+  if constexpr (is_resettable) {
+    reset(0);
+    return;
+  }
+
+  if constexpr (has_refills) {
+    // The block kept aside is just free (after the refill in flight,
+    // if any, is finished)
+    if constexpr (has_background_refills) refill_worker_.stop();
+
+    if (refill_.status == refill_status_t::ready)
+      deallocate(reinterpret_cast<void*>(refill_.block.ptr),
+                 refill_.block.size);
+  }
+
+  if constexpr (has_thread_arenas) {
+    // Free what's left of the arenas and then the records themselves
+    arenas_.for_each([this](arena_t& arena) noexcept {
+      deallocate(reinterpret_cast<void*>(arena.ptr), arena.size);
+    });
+    arenas_.clear([this](void* const ptr) noexcept {
+      deallocate(ptr, arena_alloc_size);
+    });
+  }
+
   /* The chunks in the free list are obviously out of order, so we
    * find andjacent ones here. Luckily, this is the destructor so
    * we don't have to think about thread safety */
   free_chunk_t* chunks_head =
     make_mem_ref<thread_safety>(free_chunks_head_).load(mo_t::acquire);
 
-  if (head_.size)  // "deallocate" head
-    chunks_head = new (reinterpret_cast<void*>(head_.ptr)) free_chunk_t {
+  if (const auto head = unpack_head(head_); head.size)  // "deallocate" head
+    chunks_head = new (reinterpret_cast<void*>(head.ptr)) free_chunk_t {
       .next = chunks_head,
-      .size = head_.size,
+      .size = head.size,
       .alignment = pow2_t{}
     };
 
+  auto regions = merge_chunks(chunks_head);
+  for (auto& bin : reuse_bins_)
+    regions = merge_chunks(bin.reset(), 0, regions);
+
   // Merge adjacent regions and pass them to deallocate()
-  for (auto region = merge_chunks(chunks_head); region;) {
+  for (auto region = regions; region;) {
     free_chunk_t curr_chunk = *region;
     region->~free_chunk_t();
 
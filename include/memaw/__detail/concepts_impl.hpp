@@ -34,6 +34,26 @@ concept has_nothrow_deallocate = requires(R res, void* ptr, size_t size,
   { res.deallocate(ptr, size, alignment) } noexcept;
 };
 
+template <typename R>
+concept has_batch_allocate = requires(R res, size_t count, size_t size,
+                                      size_t alignment, void** out) {
+  { res.allocate_batch(count, size, alignment, out) } noexcept
+    -> std::same_as<size_t>;
+};
+
+template <typename R>
+concept has_batch_deallocate = requires(R res, size_t count, size_t size,
+                                        size_t alignment, void* const* ptrs) {
+  { res.deallocate_batch(count, size, alignment, ptrs) } noexcept;
+};
+
+template <typename R>
+concept has_reallocate = requires(R res, void* ptr, size_t old_size,
+                                  size_t new_size, size_t alignment) {
+  { res.reallocate(ptr, old_size, new_size, alignment) } noexcept
+    -> std::same_as<void*>;
+};
+
 template <typename T, typename... Ts>
 concept same_as_either = (... || std::same_as<T, Ts>);
 
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdint>
+#include <nupp/algorithm.hpp>
+#include <utility>
+
+#include "../os_resource.hpp"
+#include "base.hpp"
+#include "mem_ref.hpp"
+#include "os_mapper.hpp"
+#include "resource_common.hpp"
+
+/**
+ * @file
+ * The common implementation of the resources that allocate from a
+ * mapped (shared) object
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+template <page_type auto _type, thread_safety_t _ts>
+class mapped_resource_impl {
+public:
+  using native_handle_t = os_mapper::native_handle_t;
+
+  static pow2_t min_size() noexcept {
+    return os_mapper::get_min_size(_type);
+  }
+
+  static pow2_t guaranteed_alignment() noexcept {
+    return os_mapper::get_guaranteed_alignment(_type);
+  }
+
+  /**
+   * @brief Maps the first size bytes of the object with the handle
+   *        (taking ownership of the latter). On failure the resource
+   *        is left empty and the handle is closed
+   **/
+  mapped_resource_impl(const native_handle_t handle, const size_t size,
+                       const size_t used_size) noexcept:
+    handle_(handle), size_(size),
+    begin_(uintptr_t(os_mapper::map_object(handle, size, _type))),
+    offset_(nupp::minimum(used_size, size)) {
+    if (!begin_) {
+      os_mapper::close_handle(std::exchange(handle_,
+                                            os_mapper::invalid_handle));
+      size_ = offset_ = 0;
+    }
+  }
+
+  /**
+   * @brief Opens (or creates) the file and maps it with the size
+   *        ceiled to min_size() (or the current file size floored to
+   *        it, if size is 0)
+   **/
+  static mapped_resource_impl from_file(const char* const path, size_t size,
+                                        const size_t used_size) noexcept {
+    const auto mask = min_size().get_mask();
+    size = (size + mask) & ~mask;
+
+    const auto handle = os_mapper::open_file(path, size);
+    return { handle, size & ~mask, used_size };
+  }
+
+  /**
+   * @brief Creates and maps a new shared memory object of the size
+   *        ceiled to min_size()
+   **/
+  static mapped_resource_impl from_shared_memory(size_t size) noexcept {
+    const auto mask = min_size().get_mask();
+    size = (size + mask) & ~mask;
+
+    return { os_mapper::create_shared_memory(size, _type), size, 0 };
+  }
+
+  mapped_resource_impl(const mapped_resource_impl&) = delete;
+  mapped_resource_impl& operator=(const mapped_resource_impl&) = delete;
+  mapped_resource_impl& operator=(mapped_resource_impl&&) = delete;
+
+  mapped_resource_impl(mapped_resource_impl&& rhs) noexcept:
+    handle_(std::exchange(rhs.handle_, os_mapper::invalid_handle)),
+    size_(std::exchange(rhs.size_, 0)),
+    begin_(std::exchange(rhs.begin_, 0)),
+    offset_(std::exchange(rhs.offset_, 0)) {}
+
+  ~mapped_resource_impl() noexcept {
+    os_mapper::unmap_object(reinterpret_cast<void*>(begin_), size_);
+    os_mapper::close_handle(handle_);
+  }
+
+  native_handle_t native_handle() const noexcept {
+    return handle_;
+  }
+
+  void* range_begin() const noexcept {
+    return reinterpret_cast<void*>(begin_);
+  }
+
+  size_t mapped_size() const noexcept {
+    return size_;
+  }
+
+  size_t used_size() const noexcept {
+    return make_mem_ref<_ts>(offset_).load(mo_t::relaxed);
+  }
+
+  [[nodiscard]] inline void* allocate(size_t, size_t) noexcept;
+
+  bool flush() const noexcept {
+    return begin_
+      && os_mapper::flush(reinterpret_cast<void*>(begin_), size_);
+  }
+
+private:
+  native_handle_t handle_;
+
+  size_t size_;
+  uintptr_t begin_;
+
+  size_t offset_;  // The end of the allocated part of the object
+};
+
+template <page_type auto _type, thread_safety_t _ts>
+void* mapped_resource_impl<_type, _ts>::allocate
+  (const size_t size, const size_t alignment) noexcept {
+  if (!size || (size & min_size().get_mask())) [[unlikely]] return nullptr;
+
+  const auto real_alignment =
+    nupp::maximum(pow2_t{alignment, pow2_t::ceil}, guaranteed_alignment());
+
+  const auto offset_ref = make_mem_ref<_ts>(offset_);
+  auto offset = offset_ref.load(mo_t::relaxed);
+
+  uintptr_t result;
+  size_t new_offset;
+  do {
+    const auto [ptr, padding] = align_pointer(begin_ + offset, real_alignment);
+
+    // Compare with the space left to avoid overflows
+    const size_t left = size_ - offset;
+    if (padding > left || size > left - padding) return nullptr;
+
+    result = ptr;
+    new_offset = offset + padding + size;
+  } while (!offset_ref.compare_exchange_weak(offset, new_offset,
+                                             mo_t::relaxed, mo_t::relaxed));
+
+  return reinterpret_cast<void*>(result);
+}
+
+} // namespace memaw::__detail
@@ -13,10 +13,22 @@
  * @copyright 2023, under the MIT License (see /LICENSE for details)
  **/
 
+/* The lock-free structures use DWCAS (through atomic128) unless
+ * MEMAW_USE_DWCAS is defined as 0, in which case they switch to
+ * tagged pointers packed into a single word. The packed mode is meant
+ * for the targets without DWCAS only: it requires all the addresses
+ * to fit into 48 bits, has shorter ABA tags and changes the way
+ * cache_resource allocates its blocks (see tagged_ptr.hpp) */
+#ifndef MEMAW_USE_DWCAS
+#  define MEMAW_USE_DWCAS 1
+#endif
+
 namespace memaw::__detail {
 
 using namespace atomic128;
 
+constexpr bool use_dwcas = MEMAW_USE_DWCAS;
+
 enum thread_safety_t {
   thread_unsafe,
   thread_safe
@@ -46,6 +58,24 @@ public:
     return value;
   }
 
+  T fetch_add(const T& value, const mo_t) const noexcept {
+    const auto result = ref;
+    ref+= value;
+    return result;
+  }
+
+  T fetch_or(const T& value, const mo_t) const noexcept {
+    const auto result = ref;
+    ref|= value;
+    return result;
+  }
+
+  T fetch_and(const T& value, const mo_t) const noexcept {
+    const auto result = ref;
+    ref&= value;
+    return result;
+  }
+
   bool compare_exchange_strong(T& old_val, const T& new_val, const mo_t,
                                const mo_t = mo_t::relaxed) const noexcept {
     if (ref != old_val) {
@@ -83,6 +113,18 @@ public:
     return std::atomic_ref(ref).exchange(val, mo);
   }
 
+  T fetch_add(const T& val, const mo_t mo) const noexcept {
+    return std::atomic_ref(ref).fetch_add(val, mo);
+  }
+
+  T fetch_or(const T& val, const mo_t mo) const noexcept {
+    return std::atomic_ref(ref).fetch_or(val, mo);
+  }
+
+  T fetch_and(const T& val, const mo_t mo) const noexcept {
+    return std::atomic_ref(ref).fetch_and(val, mo);
+  }
+
   template <std::same_as<mo_t>... MOs>
   bool compare_exchange_strong(T& old_val, const T& new_val,
                                const MOs... mos) const noexcept {
@@ -129,6 +171,18 @@ public:
     return __atomic_exchange_n(&ref, val, unsigned(mo));
   }
 
+  T fetch_add(const T& val, const mo_t mo) const noexcept {
+    return __atomic_fetch_add(&ref, val, unsigned(mo));
+  }
+
+  T fetch_or(const T& val, const mo_t mo) const noexcept {
+    return __atomic_fetch_or(&ref, val, unsigned(mo));
+  }
+
+  T fetch_and(const T& val, const mo_t mo) const noexcept {
+    return __atomic_fetch_and(&ref, val, unsigned(mo));
+  }
+
   template <std::same_as<mo_t>... MOs>
   bool compare_exchange_strong(T& old_val, const T& new_val,
                                const MOs... mos) const noexcept {
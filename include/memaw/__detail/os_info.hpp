@@ -16,7 +16,10 @@
 #  include <unistd.h>
 #  if MEMAW_IS(OS, LINUX)
 #    include <cstdio>
+#    include <cstring>
 #    include <dirent.h>
+#    include <sched.h>
+#    include <sys/syscall.h>
 #  endif
 #endif
 
@@ -30,6 +33,23 @@
 
 namespace memaw::__detail {
 
+/**
+ * @brief The current counters of the system pool of big pages of a
+ *        particular size
+ **/
+struct big_pages_stats {
+  size_t total;     // The number of pages in the pool
+  size_t free;      // The number of pages not backing any memory yet
+  size_t reserved;  // The number of free pages promised to mappings
+
+  /**
+   * @brief Returns the number of pages available for new mappings
+   **/
+  size_t available() const noexcept {
+    return free > reserved ? free - reserved : 0;
+  }
+};
+
 /**
  * @brief A class that gathers static information about the OS
  *        parameters and tools available in runtime
@@ -40,6 +60,7 @@ public:
 
   pow2_t page_size;
   std::optional<pow2_t> big_page_size;
+  std::optional<pow2_t> transparent_page_size;
 
 #if MEMAW_IS(OS, WINDOWS)
   pow2_t granularity;
@@ -48,11 +69,52 @@ public:
 
   uint64_t page_sizes_mask;
 
+  /**
+   * @brief The number of NUMA nodes in the system (or rather, the
+   *        highest node id plus one), always at least 1
+   **/
+  size_t numa_nodes_count;
+
+  /**
+   * @brief Returns the NUMA node of the CPU the calling thread is
+   *        currently running on (0 if that cannot be determined).
+   *        Note that the result may get stale right away, unless the
+   *        thread is pinned to the node
+   **/
+  static inline size_t get_current_numa_node() noexcept;
+
+  /**
+   * @brief Returns the index of the CPU the calling thread is
+   *        currently running on (or an empty optional if that cannot
+   *        be determined cheaply). Same as above, the result may get
+   *        stale right away
+   **/
+  static inline std::optional<size_t> get_current_cpu() noexcept;
+
+  /**
+   * @brief Reads the current counters of the pool of big pages of the
+   *        given size (with no caching). On Linux, parsed from
+   *        /sys/kernel/mm/hugepages/, elsewhere, always an empty
+   *        optional
+   **/
+  static inline std::optional<big_pages_stats>
+    get_big_pages_stats(pow2_t) noexcept;
+
 private:
   static inline std::optional<pow2_t> get_big_page_size() noexcept;
+  static inline std::optional<pow2_t> get_transparent_page_size() noexcept;
+  static inline size_t get_numa_nodes_count() noexcept;
 };
 
-inline static const os_info_t os_info{};
+/**
+ * @brief Returns the information gathered on the first call (rather
+ *        than during the static initialization, so that programs
+ *        that never call the OS don't pay for the parsing)
+ **/
+inline const os_info_t& get_os_info() noexcept {
+  static const os_info_t info{};
+  return info;
+}
 
 std::optional<pow2_t> os_info_t::get_big_page_size() noexcept {
   uint64_t result = 0;
@@ -87,7 +149,130 @@ std::optional<pow2_t> os_info_t::get_big_page_size() noexcept {
   return pow2_t{result, pow2_t::exact};
 }
 
-os_info_t::os_info_t() noexcept: big_page_size(get_big_page_size()) {
+std::optional<pow2_t> os_info_t::get_transparent_page_size() noexcept {
+  uint64_t result = 0;
+
+#if MEMAW_IS(OS, LINUX)
+  /* Transparent huge pages are usable (for us) unless they are
+   * disabled entirely, i.e., the mode is either [always] or
+   * [madvise]. The sysfs files are, again, assumed to be at /sys */
+  constexpr char EnabledPath[] = "/sys/kernel/mm/transparent_hugepage/enabled";
+  constexpr char SizePath[] =
+    "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size";
+
+  char buf[255];
+  bool is_enabled = false;
+  if (const auto enabled_fd = std::fopen(EnabledPath, "r")) {
+    if (std::fgets(buf, sizeof(buf), enabled_fd))
+      is_enabled = !std::strstr(buf, "[never]");
+    std::fclose(enabled_fd);
+  }
+
+  if (is_enabled) {
+    if (const auto size_fd = std::fopen(SizePath, "r")) {
+      long unsigned value;
+      if (std::fscanf(size_fd, "%lu", &value) == 1)
+        result = uint64_t(value);  // This one is in bytes already
+      std::fclose(size_fd);
+    }
+  }
+#endif
+
+  if (!nupp::is_pow2(result)) return {};
+  return pow2_t{result, pow2_t::exact};
+}
+
+size_t os_info_t::get_numa_nodes_count() noexcept {
+  size_t result = 1;
+
+#if MEMAW_IS(OS, LINUX)
+  /* The online nodes are listed in sysfs as ranges, like "0-3,5".
+   * The last number is the highest id, which is all we need */
+  constexpr char NodesPath[] = "/sys/devices/system/node/online";
+
+  char buf[255];
+  if (const auto nodes_fd = std::fopen(NodesPath, "r")) {
+    if (std::fgets(buf, sizeof(buf), nodes_fd)) {
+      const char* last = buf;
+      for (auto p = buf; *p; ++p)
+        if (*p == '-' || *p == ',') last = p + 1;
+
+      long unsigned value;
+      if (std::sscanf(last, "%lu", &value) == 1)
+        result = value + 1;
+    }
+    std::fclose(nodes_fd);
+  }
+#elif MEMAW_IS(OS, WINDOWS)
+  ULONG value;
+  if (GetNumaHighestNodeNumber(&value)) result = value + 1;
+#endif
+
+  return result;
+}
+
+size_t os_info_t::get_current_numa_node() noexcept {
+#if MEMAW_IS(OS, LINUX) && defined(SYS_getcpu)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return node;
+#elif MEMAW_IS(OS, WINDOWS)
+  PROCESSOR_NUMBER cpu;
+  GetCurrentProcessorNumberEx(&cpu);
+
+  USHORT node;
+  if (GetNumaProcessorNodeEx(&cpu, &node)) return node;
+#endif
+  return 0;
+}
+
+std::optional<size_t> os_info_t::get_current_cpu() noexcept {
+#if MEMAW_IS(OS, LINUX)
+  // NB: served by vDSO or rseq (since glibc 2.35) without a syscall
+  if (const int cpu = sched_getcpu(); cpu >= 0) return size_t(cpu);
+#elif MEMAW_IS(OS, WINDOWS)
+  return size_t(GetCurrentProcessorNumber());
+#endif
+  return {};
+}
+
+std::optional<big_pages_stats>
+  os_info_t::get_big_pages_stats(const pow2_t size) noexcept {
+#if MEMAW_IS(OS, LINUX)
+  // Same directories as the ones we enlist in the constructor
+  char path[128];
+  const auto read_counter = [&path, size](const char* const name,
+                                          size_t& result) {
+    std::snprintf(path, sizeof(path),
+                  "/sys/kernel/mm/hugepages/hugepages-%lukB/%s",
+                  static_cast<long unsigned>(size_t(size) >> 10), name);
+
+    const auto fd = std::fopen(path, "r");
+    if (!fd) return false;
+
+    long unsigned value;
+    const bool is_read = std::fscanf(fd, "%lu", &value) == 1;
+    std::fclose(fd);
+
+    if (is_read) result = value;
+    return is_read;
+  };
+
+  big_pages_stats result;
+  if (read_counter("nr_hugepages", result.total)
+      && read_counter("free_hugepages", result.free)
+      && read_counter("resv_hugepages", result.reserved))
+    return result;
+#else
+  (void)size;
+#endif
+
+  return {};
+}
+
+os_info_t::os_info_t() noexcept:
+  big_page_size(get_big_page_size()),
+  transparent_page_size(get_transparent_page_size()),
+  numa_nodes_count(get_numa_nodes_count()) {
   // First load the regular page size
 #if MEMAW_IS(OS, WINDOWS)
   SYSTEM_INFO info;
@@ -104,6 +289,8 @@ os_info_t::os_info_t() noexcept: big_page_size(get_big_page_size()) {
   // Now, we need to get the mask of all pages somehow
   page_sizes_mask = page_size;
   if (big_page_size) page_sizes_mask|= *big_page_size;
+  // NB: the transparent page size is not added, as it cannot be
+  // requested explicitly (unless also listed below for hugetlb)
 
 #if MEMAW_IS(OS, LINUX)
   /* On Linux we will honestly enlist the directories in sysfs (and
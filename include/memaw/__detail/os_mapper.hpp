@@ -1,17 +1,29 @@
 #pragma once
+#include <bit>
 #include <concepts>
+#include <iterator>
 #include <nupp/algorithm.hpp>
 
 #include "base.hpp"
 #include "environment.hpp"
 #include "os_info.hpp"
+#include "os_options.hpp"
+#include "resource_common.hpp"
 
 #if MEMAW_IS(OS, WINDOWS)
 #  include <windows.h>
 #else
 #  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <atomic>
+#  include <cerrno>
+#  include <cstdio>
+#  include <fcntl.h>
 #  include <unistd.h>
-#  if MEMAW_IS(OS, APPLE)
+#  if MEMAW_IS(OS, LINUX)
+#    include <linux/mempolicy.h>
+#    include <sys/syscall.h>
+#  elif MEMAW_IS(OS, APPLE)
 #    include <mach/vm_statistics.h>
 #  endif
 #endif
@@ -30,13 +42,29 @@ class os_mapper {
 public:
   struct regular_pages_tag {};
   struct big_pages_tag {};
+  struct transparent_pages_tag {};
+
+  /**
+   * @brief The handle of a mappable object: a file descriptor on
+   *        Unix-like systems, a file mapping object handle on Windows
+   **/
+#if MEMAW_IS(OS, WINDOWS)
+  using native_handle_t = HANDLE;
+  inline static const native_handle_t invalid_handle = nullptr;
+#else
+  using native_handle_t = int;
+  constexpr static native_handle_t invalid_handle = -1;
+#endif
 
   template <typename PageType>
   static pow2_t get_min_size(const PageType page_type) noexcept {
+    const auto& os_info = get_os_info();
     if constexpr (std::same_as<PageType, regular_pages_tag>)
       return os_info.page_size;
     else if constexpr (std::same_as<PageType, pow2_t>)
       return page_type;
+    else if constexpr (std::same_as<PageType, transparent_pages_tag>)
+      return os_info.transparent_page_size.value_or(os_info.page_size);
     else
       return os_info.big_page_size.value_or(os_info.page_size);
   }
@@ -44,7 +72,9 @@ public:
   template <typename PageType>
   static pow2_t get_guaranteed_alignment(const PageType page_type) noexcept {
 #if MEMAW_IS(OS, WINDOWS)
-    if constexpr (std::same_as<PageType, regular_pages_tag>)
+    const auto& os_info = get_os_info();
+    if constexpr (std::same_as<PageType, regular_pages_tag>
+                  || std::same_as<PageType, transparent_pages_tag>)
       return os_info.granularity;
     else
       return nupp::maximum(get_min_size(page_type), os_info.granularity);
@@ -53,13 +83,146 @@ public:
 #endif
   }
 
+  /**
+   * @brief Checks if the options can be applied on this system at
+   *        all (without actually trying to)
+   **/
+  static bool is_supported(const os_allocation_options& options) noexcept {
+    using enum numa_mode;
+    const auto& numa = options.numa;
+    if (numa.mode == none || numa.mode == local) return true;
+
+#if MEMAW_IS(OS, LINUX)
+    return numa.nodes != 0;
+#elif MEMAW_IS(OS, WINDOWS)
+    return numa.mode != interleave && nupp::is_pow2(numa.nodes);
+#else
+    return false;
+#endif
+  }
+
   template <typename PageType>
-  [[nodiscard]] inline static void* map(size_t, pow2_t, PageType) noexcept;
+  [[nodiscard]] static void* map(const size_t size, const pow2_t alignment,
+                                 const PageType page_type,
+                                 const os_allocation_options& options = {})
+    noexcept {
+    if (!is_supported(options)) return nullptr;
+    return apply_options(map_pages(size, alignment, page_type, options),
+                         size, options);
+  }
 
   inline static void unmap(void*, size_t) noexcept;
 
-#if MEMAW_IS(OS, WINDOWS)
+  /**
+   * @brief Tries to grow or shrink the mapped region (of a size that
+   *        is a multiple of the page size) in place, keeping its
+   *        contents
+   * @return false if the region is left as it was
+   **/
+  inline static bool resize(void*, size_t, size_t) noexcept;
+
+  /**
+   * @brief Moves the mapped region to a new address while resizing it
+   *        without copying the contents (only supported on Linux)
+   * @return nullptr if the region is left as it was
+   **/
+  inline static void* relocate(void*, size_t, size_t) noexcept;
+
+  /**
+   * @brief Makes the OS back the whole (page-aligned) mapped range
+   *        with physical memory right away, so that the first access
+   *        doesn't page fault
+   * @return false if the OS refused to do that (e.g., out of memory)
+   **/
+  inline static bool populate(void*, size_t) noexcept;
+
+  /**
+   * @brief Gives the physical memory behind the (page-aligned) mapped
+   *        range back to the OS, keeping the range accessible (with
+   *        unspecified contents)
+   **/
+  inline static void purge(void*, size_t) noexcept;
+
+  /**
+   * @brief Reserves a range of the address space (of a size that is a
+   *        multiple of the page size) without committing any memory.
+   *        The range is inaccessible until commit() is called on it
+   * @return nullptr on failure
+   **/
+  inline static void* reserve(size_t) noexcept;
+
+  /**
+   * @brief Makes the (page-aligned) sub-range of a reserved range
+   *        accessible. Committing already committed pages is harmless
+   **/
+  inline static bool commit(void*, size_t) noexcept;
+
+  /**
+   * @brief Gives the memory of the (page-aligned) sub-range back to
+   *        the OS, leaving the addresses reserved and inaccessible
+   **/
+  inline static void decommit(void*, size_t) noexcept;
+
+  /**
+   * @brief Releases the whole range previously returned by reserve()
+   **/
+  inline static void release(void*, size_t) noexcept;
+
+  /**
+   * @brief Opens (or creates) the file at the path to be mapped with
+   *        map_object(), extending it to the given size if it is
+   *        shorter, or sets the size to the current file size if it
+   *        is 0
+   * @return invalid_handle on failure
+   **/
+  inline static native_handle_t open_file(const char*, size_t&) noexcept;
+
+  /**
+   * @brief Creates an anonymous shared memory object of the given size
+   *        (backed by the pages of the given type, if supported) to
+   *        be mapped with map_object()
+   * @return invalid_handle on failure
+   **/
+  template <typename PageType>
+  inline static native_handle_t create_shared_memory(size_t, PageType)
+    noexcept;
+
+  /**
+   * @brief Maps the beginning of the object as shared memory, aligned
+   *        by get_guaranteed_alignment(page_type)
+   * @return nullptr on failure
+   **/
+  template <typename PageType>
+  [[nodiscard]] inline static void* map_object(native_handle_t, size_t,
+                                               PageType) noexcept;
+
+  /**
+   * @brief Unmaps the whole range previously returned by map_object()
+   **/
+  inline static void unmap_object(void*, size_t) noexcept;
+
+  /**
+   * @brief Writes the modified pages of the mapped (file) range back
+   *        to the storage, waiting for that to complete
+   **/
+  inline static bool flush(void*, size_t) noexcept;
+
+  inline static void close_handle(native_handle_t) noexcept;
+
 private:
+  template <typename PageType>
+  [[nodiscard]] inline static void*
+    map_pages(size_t, pow2_t, PageType, const os_allocation_options&) noexcept;
+
+  /**
+   * @brief Applies the options that require additional syscalls to
+   *        the mapped memory, unmapping it and returning nullptr on
+   *        failure
+   **/
+  inline static void* apply_options(void*, size_t,
+                                    const os_allocation_options&) noexcept;
+
+#if MEMAW_IS(OS, WINDOWS)
   inline static bool try_acquire_lock_privilege() noexcept;
 
   /* NB: in fact, we only need this for big pages. However, keeping it
@@ -68,38 +231,74 @@ private:
    * was instantiated) */
   template <typename>
   inline static const bool has_lock_privilege = try_acquire_lock_privilege();
+#else
+  /**
+   * @brief Maps the memory with the given flags and alignment bigger
+   *        than the page size by reserving an additional (alignment -
+   *        page size) bytes and unmapping the excess head and tail
+   **/
+  inline static void* map_aligned(size_t, pow2_t, int) noexcept;
 #endif
 };
 
 template <typename PageType>
-[[nodiscard]] void* os_mapper::map(const size_t size, const pow2_t alignment,
-                                   const PageType page_type) noexcept {
+[[nodiscard]] void*
+  os_mapper::map_pages(const size_t size, const pow2_t alignment,
+                       const PageType page_type,
+                       const os_allocation_options& options) noexcept {
   constexpr bool RegularPages = std::same_as<PageType, regular_pages_tag>;
   constexpr bool BigPages = std::same_as<PageType, big_pages_tag>;
   constexpr bool ExplicitPageSize = std::same_as<PageType, pow2_t>;
-  static_assert(RegularPages || BigPages || ExplicitPageSize);
+  constexpr bool TransparentPages =
+    std::same_as<PageType, transparent_pages_tag>;
+  static_assert(RegularPages || BigPages || ExplicitPageSize
+                || TransparentPages);
+
+  const auto& os_info = get_os_info();
 
   // Sanitize the parameters first
   const size_t min_size = get_min_size(page_type);
   if (size < min_size) return nullptr;
 
+  if constexpr (TransparentPages) {
+#if MEMAW_IS(OS, LINUX) && defined(MADV_HUGEPAGE)
+    if (os_info.transparent_page_size) {
+      /* These are regular pages that the kernel may (and with a
+       * properly aligned range, will) back with huge ones. Since
+       * transparent pages are not disabled, the hint can only fail
+       * for a bad range, which is not our case */
+      const auto result =
+        map_aligned(size, nupp::maximum(alignment,
+                                        *os_info.transparent_page_size),
+                    MAP_PRIVATE | MAP_ANON);
+      if (result) madvise(result, size, MADV_HUGEPAGE);
+      return result;
+    }
+#endif
+    // No such thing here, so just fall back to regular pages
+    return map_pages(size, alignment, os_mapper::regular_pages_tag{},
+                     options);
+  }
+
   if constexpr (ExplicitPageSize) {
     if (page_type == os_info.page_size) [[unlikely]]
       // In case the user is messing with us trying to allocate
       // regular pages with this complicated interface
-      return map(size, alignment, os_mapper::regular_pages_tag{});
+      return map_pages(size, alignment, os_mapper::regular_pages_tag{},
+                       options);
   }
 
   // Now, action!
 #if MEMAW_IS(OS, WINDOWS)
-  if constexpr (!RegularPages)
+  if constexpr (BigPages || ExplicitPageSize)
     if (!os_info.big_page_size || !has_lock_privilege<big_pages_tag>)
       return nullptr;
 
   /* We use the VirtualAlloc2 function and the extended parameters for
-   * two things: an explicitly specified page size or the alignment
-   * greater than guaranteed one (by page size) */
-  MEM_EXTENDED_PARAMETER extended_params[2] = {};
+   * three things: an explicitly specified page size, the alignment
+   * greater than guaranteed one (by page size) and the NUMA node
+   * (although the latter alone can be done with VirtualAllocExNuma) */
+  MEM_EXTENDED_PARAMETER extended_params[3] = {};
   ULONG extended_params_count = 0;
 
   // First case first
@@ -134,12 +333,27 @@ template <typename PageType>
   constexpr auto Flags =
     MEM_RESERVE | MEM_COMMIT | (RegularPages ? 0 : MEM_LARGE_PAGES);
 
-  if (!extended_params_count) // Okay, regular alloc
+  // Only a single node is supported here (see is_supported())
+  const bool has_numa_node = options.numa.mode == numa_mode::bind
+    || options.numa.mode == numa_mode::preferred;
+  const auto numa_node = ULONG(std::countr_zero(options.numa.nodes));
+
+  if (!extended_params_count) { // Okay, regular alloc
+    if (has_numa_node)
+      return VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, Flags,
+                                PAGE_READWRITE, numa_node);
     return VirtualAlloc(nullptr, size, Flags, PAGE_READWRITE);
+  }
 
   if (!os_info.extended_alloc)
     return nullptr;  // VirtualAlloc2 requested but not present
 
+  if (has_numa_node) {
+    auto& param = extended_params[extended_params_count++];
+    param.Type = MemExtendedParameterNumaNode;
+    param.ULong = numa_node;
+  }
+
   return os_info.extended_alloc(nullptr, nullptr, size, Flags, PAGE_READWRITE,
                                 extended_params, extended_params_count);
 #else
@@ -151,11 +365,12 @@ template <typename PageType>
     // The only problem we might have with regular pages is the
     // alignment requirement...
     if (alignment > os_info.page_size) {
-      // ... and we only know how to guarantee this on BSD, hehe
+      // ... and only BSD knows how to guarantee it natively, hehe
 #  if MEMAW_IS(OS, BSD) && defined(MAP_ALIGNED)
       extended_flags|= MAP_ALIGNED(alignment.log2());
 #  else
-      return nullptr;
+      // Elsewhere we reserve more and give the excess back
+      return map_aligned(size, alignment, BaseFlags);
 #  endif
     }
   }
@@ -223,6 +438,96 @@ template <typename PageType>
 #endif
 }
 
+#if !MEMAW_IS(OS, WINDOWS)
+void* os_mapper::map_aligned(const size_t size, const pow2_t alignment,
+                             const int flags) noexcept {
+  const auto& os_info = get_os_info();
+  const size_t excess = alignment - nupp::minimum(alignment,
+                                                  os_info.page_size);
+  if (size + excess < size) [[unlikely]] return nullptr;  // Overflow
+
+  void* const ptr =
+    mmap(nullptr, size + excess, PROT_READ | PROT_WRITE, flags,
+         /*fd = */-1, /*offset = */0);
+  if (ptr == MAP_FAILED) return nullptr;
+
+  // The mapping is page-aligned, so both parts are full pages
+  const auto [result, padding] = align_pointer(ptr, alignment);
+  if (padding) munmap(ptr, padding);
+  if (excess > padding)
+    munmap(reinterpret_cast<void*>(result + size), excess - padding);
+
+  return reinterpret_cast<void*>(result);
+}
+#endif
+
+void* os_mapper::apply_options(void* const ptr, const size_t size,
+                               const os_allocation_options& options) noexcept {
+  if (!ptr) return nullptr;
+
+#if MEMAW_IS(OS, LINUX)
+  if (options.numa.mode != numa_mode::none) {
+    int mode;
+    switch (options.numa.mode) {
+    case numa_mode::bind:       mode = MPOL_BIND; break;
+    case numa_mode::preferred:  mode = MPOL_PREFERRED; break;
+    case numa_mode::interleave: mode = MPOL_INTERLEAVE; break;
+    default:                    mode = MPOL_LOCAL; break;
+    }
+
+    // The kernel wants an array of unsigned longs for the mask, which
+    // may be shorter than 64 bits on 32-bit systems
+    constexpr size_t MaskBits = sizeof(unsigned long) * 8;
+    unsigned long mask[64 / MaskBits];
+    for (size_t i = 0; i < std::size(mask); ++i)
+      mask[i] = static_cast<unsigned long>(options.numa.nodes >> i*MaskBits);
+
+    /* MPOL_LOCAL takes an empty mask. Otherwise the kernel drops the
+     * last bit of maxnode for historical reasons, hence the +1 */
+    const bool is_local = mode == MPOL_LOCAL;
+    if (syscall(SYS_mbind, ptr, size, mode, is_local ? nullptr : mask,
+                is_local ? 0ul : 64ul + 1, /*flags = */0u) != 0) {
+      munmap(ptr, size);
+      return nullptr;
+    }
+  }
+#endif
+
+  // Populate last, so that the pages come from the right nodes
+  if (options.populate && !populate(ptr, size)) {
+    unmap(ptr, size);
+    return nullptr;
+  }
+
+  return ptr;
+}
+
+bool os_mapper::populate(void* const ptr, const size_t size) noexcept {
+#if MEMAW_IS(OS, LINUX) && defined(MADV_POPULATE_WRITE)
+  // One syscall instead of a fault per page (since Linux 5.14)
+  if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0) return true;
+  if (errno != EINVAL) return false;  // Otherwise, an older kernel
+#elif MEMAW_IS(OS, WINDOWS)
+  /* Have the pages that are paged out read back in with large I/O
+   * requests. That doesn't fault in the ones never touched though, so
+   * we still go through all of them below */
+  WIN32_MEMORY_RANGE_ENTRY range = { .VirtualAddress = ptr,
+                                     .NumberOfBytes = size };
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+
+  /* Just touch every page then. The memory is either fresh (i.e.,
+   * zero-filled) or owned by the caller, so we write back what we
+   * read. Touching every regular page is not necessary for the big
+   * ones but cheap compared to the faults anyway */
+  const size_t step = get_os_info().page_size;
+  for (auto p = static_cast<volatile std::byte*>(ptr),
+         end = p + size; p < end; p+= step)
+    *p = *p;
+
+  return true;
+}
+
 void os_mapper::unmap(void* ptr, size_t size) noexcept {
   if (!ptr) return;  // Who needs a system call like that...
 
@@ -248,6 +553,331 @@ void os_mapper::unmap(void* ptr, size_t size) noexcept {
 #endif
 }
 
+bool os_mapper::resize(void* const ptr, const size_t old_size,
+                       const size_t new_size) noexcept {
+  if (old_size == new_size) return true;
+
+#if MEMAW_IS(OS, LINUX)
+  return mremap(ptr, old_size, new_size, /*flags = */0) != MAP_FAILED;
+#else
+  const auto tail =
+    static_cast<std::byte*>(ptr) + nupp::minimum(old_size, new_size);
+  const auto tail_size = old_size > new_size
+    ? old_size - new_size : new_size - old_size;
+
+#  if MEMAW_IS(OS, WINDOWS)
+  /* Shrinking decommits the tail, leaving it reserved, so growing back
+   * is possible within the original reservation only (unmap() still
+   * releases the whole of it, since the committed part is a region of
+   * its own then) */
+  if (old_size > new_size)
+    return VirtualFree(tail, tail_size, MEM_DECOMMIT);
+
+  MEMORY_BASIC_INFORMATION info;
+  if (!VirtualQuery(tail, &info, sizeof(info)) || info.AllocationBase != ptr
+      || info.State != MEM_RESERVE || info.RegionSize < tail_size)
+    return false;
+
+  return VirtualAlloc(tail, tail_size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#  else
+  if (old_size > new_size) return munmap(tail, tail_size) == 0;
+
+  /* No mremap() here: try to map the range right after the region,
+   * which only works if it's free (and the system respects the hint).
+   * NB: the new pages are the regular ones */
+  void* const result = mmap(tail, tail_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANON, /*fd = */-1,
+                            /*offset = */0);
+  if (result == MAP_FAILED) return false;
+  if (result == tail) return true;
+
+  munmap(result, tail_size);
+  return false;
+#  endif
+#endif
+}
+
+void* os_mapper::relocate(void* const ptr, const size_t old_size,
+                          const size_t new_size) noexcept {
+#if MEMAW_IS(OS, LINUX)
+  // The kernel just moves the page table entries
+  void* const result = mremap(ptr, old_size, new_size, MREMAP_MAYMOVE);
+  if (result == MAP_FAILED) return nullptr;
+  return result;
+#else
+  (void)ptr;
+  (void)old_size;
+  (void)new_size;
+  return nullptr;
+#endif
+}
+
+void os_mapper::purge(void* const ptr, const size_t size) noexcept {
+#if MEMAW_IS(OS, WINDOWS)
+  /* MEM_RESET tells the system the pages need not be written to the
+   * pagefile and may be dropped. Unlike MEM_DECOMMIT, the range stays
+   * accessible (the protection argument is ignored) */
+  VirtualAlloc(ptr, size, MEM_RESET, PAGE_NOACCESS);
+#elif MEMAW_IS(OS, LINUX)
+  /* MADV_FREE would be lazier, but the pages would then only be
+   * reclaimed under memory pressure (and not show in the RSS drop),
+   * so we want them gone right away */
+  madvise(ptr, size, MADV_DONTNEED);
+#elif defined(MADV_FREE)
+  // Elsewhere MADV_DONTNEED may keep the pages, while MADV_FREE won't
+  madvise(ptr, size, MADV_FREE);
+#else
+  madvise(ptr, size, MADV_DONTNEED);
+#endif
+}
+
+void* os_mapper::reserve(const size_t size) noexcept {
+#if MEMAW_IS(OS, WINDOWS)
+  return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  /* No access means no commit charge as well, but some systems may
+   * still want a hint that we're not going to need all of it */
+#  ifdef MAP_NORESERVE
+  constexpr auto Flags = MAP_PRIVATE | MAP_ANON | MAP_NORESERVE;
+#  else
+  constexpr auto Flags = MAP_PRIVATE | MAP_ANON;
+#  endif
+
+  void* const result =
+    mmap(nullptr, size, PROT_NONE, Flags, /*fd = */-1, /*offset = */0);
+  if (result == MAP_FAILED) return nullptr;
+  return result;
+#endif
+}
+
+bool os_mapper::commit(void* const ptr, const size_t size) noexcept {
+#if MEMAW_IS(OS, WINDOWS)
+  return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+  return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void os_mapper::decommit(void* const ptr, const size_t size) noexcept {
+#if MEMAW_IS(OS, WINDOWS)
+  VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+  /* Mapping a fresh inaccessible range over the old one both drops
+   * the pages and the access in a single call (unlike madvise() plus
+   * mprotect()), while the addresses stay ours */
+#  ifdef MAP_NORESERVE
+  constexpr auto Flags = MAP_PRIVATE | MAP_ANON | MAP_FIXED | MAP_NORESERVE;
+#  else
+  constexpr auto Flags = MAP_PRIVATE | MAP_ANON | MAP_FIXED;
+#  endif
+
+  mmap(ptr, size, PROT_NONE, Flags, /*fd = */-1, /*offset = */0);
+#endif
+}
+
+void os_mapper::release(void* const ptr, const size_t size) noexcept {
+  if (!ptr) return;
+
+#if MEMAW_IS(OS, WINDOWS)
+  (void)size;  // The whole reservation is always released at once
+  VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+  munmap(ptr, size);
+#endif
+}
+
+os_mapper::native_handle_t os_mapper::open_file(const char* const path,
+                                                size_t& size) noexcept {
+#if MEMAW_IS(OS, WINDOWS)
+  const HANDLE file =
+    CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return invalid_handle;
+
+  LARGE_INTEGER file_size;
+  if (!size && GetFileSizeEx(file, &file_size))
+    size = size_t(file_size.QuadPart);
+
+  /* A mapping bigger than the file extends it. The file handle can be
+   * closed right away, the mapping object keeps the reference. NB: an
+   * empty file can't be mapped, so 0 fails here */
+  const auto result =
+    size ? CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                              DWORD(uint64_t(size) >> 32), DWORD(size),
+                              nullptr)
+         : nullptr;
+
+  CloseHandle(file);
+  return result;
+#else
+  const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return invalid_handle;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return invalid_handle;
+  }
+
+  if (!size) size = size_t(info.st_size);
+  else if (size_t(info.st_size) < size && ftruncate(fd, off_t(size)) != 0) {
+    close(fd);
+    return invalid_handle;
+  }
+
+  return fd;
+#endif
+}
+
+template <typename PageType>
+os_mapper::native_handle_t
+  os_mapper::create_shared_memory(const size_t size,
+                                  const PageType page_type) noexcept {
+  constexpr bool BigPages = std::same_as<PageType, big_pages_tag>;
+  constexpr bool ExplicitPageSize = std::same_as<PageType, pow2_t>;
+
+  const auto& os_info = get_os_info();
+
+  // Transparent pages are regular ones here, they are only asked for
+  // on mapping. So are the regular pages of an explicit size
+  bool is_big = BigPages;
+  if constexpr (ExplicitPageSize) is_big = page_type != os_info.page_size;
+
+#if MEMAW_IS(OS, WINDOWS)
+  DWORD protection = PAGE_READWRITE;
+  if (is_big) {
+    // Only the default big (large) pages are supported for sections
+    if (!os_info.big_page_size || !has_lock_privilege<big_pages_tag>)
+      return invalid_handle;
+    if constexpr (ExplicitPageSize)
+      if (page_type != *os_info.big_page_size) return invalid_handle;
+
+    protection|= SEC_COMMIT | SEC_LARGE_PAGES;
+  }
+
+  return CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, protection,
+                            DWORD(uint64_t(size) >> 32), DWORD(size),
+                            nullptr);
+#else
+#  if MEMAW_IS(OS, LINUX) && defined(MFD_CLOEXEC)
+  unsigned flags = MFD_CLOEXEC;
+  if (is_big) {
+    flags|= MFD_HUGETLB;
+
+    // The page size is encoded the same way as for mmap()
+    if constexpr (ExplicitPageSize)
+      flags|= unsigned(page_type.log2()) << MAP_HUGE_SHIFT;
+  }
+
+  const int fd = memfd_create("memaw", flags);
+#  else
+  if (is_big) return invalid_handle;  // Unsupported unfortunately
+
+#    ifdef SHM_ANON
+  const int fd = shm_open(SHM_ANON, O_RDWR | O_CLOEXEC, 0600);
+#    else
+  // Make up a unique name and unlink it right away
+  static std::atomic<unsigned> counter = 0;
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "/memaw.%ld.%u", long(getpid()),
+                counter.fetch_add(1, std::memory_order_relaxed));
+
+  const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd >= 0) shm_unlink(name);
+#    endif
+#  endif
+  if (fd < 0) return invalid_handle;
+
+  if (ftruncate(fd, off_t(size)) != 0) {
+    close(fd);
+    return invalid_handle;
+  }
+
+  return fd;
+#endif
+}
+
+template <typename PageType>
+void* os_mapper::map_object(const native_handle_t handle, const size_t size,
+                            [[maybe_unused]] const PageType page_type)
+  noexcept {
+  if (handle == invalid_handle || !size) return nullptr;
+
+#if MEMAW_IS(OS, WINDOWS)
+  DWORD access = FILE_MAP_ALL_ACCESS;
+#  ifdef FILE_MAP_LARGE_PAGES
+  if constexpr (!std::same_as<PageType, regular_pages_tag>
+                && !std::same_as<PageType, transparent_pages_tag>) {
+    const auto& os_info = get_os_info();
+    if (os_info.big_page_size && get_min_size(page_type) > os_info.page_size)
+      access|= FILE_MAP_LARGE_PAGES;
+  }
+#  endif
+
+  return MapViewOfFile(handle, access, 0, 0, size);
+#else
+  constexpr int Protection = PROT_READ | PROT_WRITE;
+
+  /* Big pages objects are always mapped aligned by their page size,
+   * while the transparent ones need to be aligned manually: put the
+   * object over a (bigger) aligned anonymous mapping */
+  if constexpr (std::same_as<PageType, transparent_pages_tag>) {
+    const auto alignment = get_guaranteed_alignment(page_type);
+    if (alignment > get_os_info().page_size) {
+      void* const range = map_aligned(size, alignment, MAP_PRIVATE | MAP_ANON);
+      if (!range) return nullptr;
+
+      void* const result = mmap(range, size, Protection,
+                                MAP_SHARED | MAP_FIXED, handle, 0);
+      if (result == MAP_FAILED) {
+        munmap(range, size);
+        return nullptr;
+      }
+
+#  if MEMAW_IS(OS, LINUX) && defined(MADV_HUGEPAGE)
+      madvise(result, size, MADV_HUGEPAGE);
+#  endif
+      return result;
+    }
+  }
+
+  void* const result = mmap(nullptr, size, Protection, MAP_SHARED, handle, 0);
+  if (result == MAP_FAILED) return nullptr;
+  return result;
+#endif
+}
+
+void os_mapper::unmap_object(void* const ptr, const size_t size) noexcept {
+  if (!ptr) return;
+
+#if MEMAW_IS(OS, WINDOWS)
+  (void)size;  // The whole view is always unmapped
+  UnmapViewOfFile(ptr);
+#else
+  munmap(ptr, size);
+#endif
+}
+
+bool os_mapper::flush(void* const ptr, const size_t size) noexcept {
+#if MEMAW_IS(OS, WINDOWS)
+  return FlushViewOfFile(ptr, size);
+#else
+  return msync(ptr, size, MS_SYNC) == 0;
+#endif
+}
+
+void os_mapper::close_handle(const native_handle_t handle) noexcept {
+  if (handle == invalid_handle) return;
+
+#if MEMAW_IS(OS, WINDOWS)
+  CloseHandle(handle);
+#else
+  close(handle);
+#endif
+}
+
 #if MEMAW_IS(OS, WINDOWS)
 bool os_mapper::try_acquire_lock_privilege() noexcept {
   /* We don't try to adjust account privileges here, hoping the user
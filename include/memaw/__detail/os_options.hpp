@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+
+#include "base.hpp"
+
+/**
+ * @file
+ * Additional parameters for the OS allocation calls
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+/**
+ * @brief The modes of the NUMA memory policy
+ **/
+enum class numa_mode: uint8_t {
+  none,        // the system default (no policy applied)
+  bind,        // allocate strictly from the nodes in the mask
+  preferred,   // prefer the (lowest) node in the mask
+  interleave,  // interleave the pages over the nodes in the mask
+  local        // prefer the node of the CPU first touching a page
+};
+
+/**
+ * @brief The NUMA memory policy to apply to an allocated region
+ **/
+struct numa_policy {
+  numa_mode mode = numa_mode::none;
+
+  /**
+   * @brief The mask of the nodes (bit i set for the node with id i),
+   *        ignored for numa_mode::none and numa_mode::local
+   **/
+  uint64_t nodes = 0;
+
+  /**
+   * @brief The number of the first nodes that can be put in the mask
+   **/
+  constexpr static size_t max_nodes = 64;
+
+  /**
+   * @brief Returns the policy binding to the single node. If the node
+   *        id is not less than max_nodes, the mask is empty, so the
+   *        allocations with the policy fail
+   **/
+  constexpr static numa_policy bind(const size_t node) noexcept {
+    return { .mode = numa_mode::bind, .nodes = node_mask(node) };
+  }
+
+  /**
+   * @brief Returns the policy preferring the single node (see bind()
+   *        for the node ids not less than max_nodes)
+   **/
+  constexpr static numa_policy prefer(const size_t node) noexcept {
+    return { .mode = numa_mode::preferred, .nodes = node_mask(node) };
+  }
+
+  constexpr static numa_policy interleave(const uint64_t nodes) noexcept {
+    return { .mode = numa_mode::interleave, .nodes = nodes };
+  }
+
+  constexpr static numa_policy local() noexcept {
+    return { .mode = numa_mode::local, .nodes = 0 };
+  }
+
+private:
+  constexpr static uint64_t node_mask(const size_t node) noexcept {
+    return node < max_nodes ? uint64_t(1) << node : 0;
+  }
+};
+
+/**
+ * @brief Additional options for the os_resource allocations (with
+ *        valid defaults)
+ **/
+struct os_allocation_options {
+  /**
+   * @brief The NUMA policy for the allocated pages. On Linux applied
+   *        with the mbind() syscall. On Windows only a single node can
+   *        be requested (as the preferred one, also for
+   *        numa_mode::bind) and numa_mode::interleave is not
+   *        supported. On other systems, only numa_mode::none and
+   *        numa_mode::local (which is then the same) are supported.
+   *        The allocation fails without a syscall if the policy is not
+   *        supported, and fails (with the memory unmapped) if it
+   *        couldn't be applied
+   **/
+  const numa_policy numa = {};
+
+  /**
+   * @brief If set to true, the allocated pages are backed by physical
+   *        memory right away (with MADV_POPULATE_WRITE on Linux 5.14+,
+   *        otherwise by touching every page), moving the page faults
+   *        cost from the first access to the allocation call. The
+   *        allocation fails (with the memory unmapped) if the OS
+   *        refuses to populate the pages
+   **/
+  const bool populate = false;
+};
+
+} // namespace memaw::__detail
@@ -1,12 +1,16 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <bit>
+#include <cstdint>
 #include <nupp/algorithm.hpp>
 #include <type_traits>
+#include <utility>
 
 #include "../resource_traits.hpp"
 #include "resource_common.hpp"
 #include "stack.hpp"
+#include "thread_registry.hpp"
 
 /**
  * @file
@@ -21,7 +25,13 @@ namespace memaw::__detail {
 template <sweeping_resource R, auto _cfg>
 class pool_resource_impl {
 private:
+  // True if chunk sizes are the powers of the multiplier rather than
+  // an explicit list
+  constexpr static bool is_geometric = !_cfg.explicit_chunk_sizes[0];
+
   consteval static auto get_chunk_sizes() noexcept;
+  consteval static auto get_geometric_chunk_sizes() noexcept;
+  consteval static auto get_size_classes() noexcept;
 
 public:
   using upstream_t = R;
@@ -30,6 +40,18 @@ public:
   constexpr static auto thread_safety = _cfg.thread_safe
     ? thread_safe : thread_unsafe;
 
+  constexpr static bool has_thread_cache =
+    _cfg.thread_safe && _cfg.thread_cache_size > 0;
+
+  using large_mode_t = std::remove_cvref_t<decltype(_cfg.large_allocations)>;
+
+  // True if the allocations bigger than max_chunk_size are not split
+  // into chunks
+  constexpr static bool has_large_tier =
+    _cfg.large_allocations != large_mode_t::split;
+  constexpr static bool has_large_cache =
+    _cfg.large_allocations == large_mode_t::cached;
+
   constexpr pool_resource_impl()
     noexcept(std::is_nothrow_default_constructible_v<upstream_t>) = default;
 
@@ -42,10 +64,26 @@ public:
   constexpr pool_resource_impl(pool_resource_impl&& rhs)
     noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
     chunk_stacks_(std::move(rhs.chunk_stacks_)),
+    nonempty_mask_(std::exchange(rhs.nonempty_mask_, 0)),
+    depot_(std::move(rhs.depot_)),
+    magazines_(std::move(rhs.magazines_)),
+    blocks_(std::move(rhs.blocks_)),
+    large_blocks_(std::move(rhs.large_blocks_)),
     upstream_(std::move(rhs.upstream_)) {}
 
   [[nodiscard]] inline void* allocate(size_t, pow2_t) noexcept;
-  inline void deallocate(uintptr_t, size_t) noexcept;
+  inline void deallocate(uintptr_t, size_t, pow2_t) noexcept;
+
+  inline size_t allocate_batch(size_t, size_t, pow2_t, void**) noexcept;
+  inline void deallocate_batch(size_t, size_t, pow2_t, void* const*) noexcept;
+
+  inline size_t release_unused(size_t) noexcept requires(_cfg.trimmable);
+
+  inline std::array<size_t, chunk_sizes.size()> count_free_chunks() noexcept;
+
+  const upstream_t& get_upstream() const noexcept {
+    return upstream_;
+  }
 
   bool operator==(const pool_resource_impl& rhs) const noexcept {
     return this == &rhs;
@@ -68,6 +106,28 @@ private:
     return nupp::minimum(max_pow2_div, get_upstream_alignment());
   }
 
+  /**
+   * @brief A lookup table from a size (in min_chunk_size units, minus
+   *        one) to the id of the smallest chunk that can contain
+   *        it. Empty if the id can be computed with a formula or the
+   *        table would be too big
+   **/
+  constexpr static auto size_classes = get_size_classes();
+
+  /**
+   * @return the id of the smallest chunk that can contain the given
+   *         size (a non-zero multiple of min_chunk_size), or
+   *         chunk_sizes.size() if there is none
+   **/
+  constexpr static size_t get_size_class(size_t) noexcept;
+
+  /**
+   * @return the id of the first stack with chunks that can contain
+   *         the allocation (or chunk_sizes.size() if there is none)
+   **/
+  inline static size_t get_stack_id(size_t, pow2_t) noexcept;
+
+  inline void* allocate_shared(size_t, size_t, pow2_t) noexcept;
   inline void* allocate_from_block(void*, size_t, size_t, pow2_t) noexcept;
 
   struct chunk_t {
@@ -77,13 +137,222 @@ private:
   std::array<stack<chunk_t, thread_safety>,
              chunk_sizes.size()> chunk_stacks_ = {};
 
+  /* A bit is set for every (probably) non-empty stack: a push sets the
+   * bit right after the CAS (unless it is already there), and the bit
+   * is only cleared by a pop that has found the stack empty, which
+   * then checks the stack once again. Both pairs of operations are
+   * seq_cst, so a chunk pushed concurrently with the clearing is
+   * always noticed by one of the two threads, and a stack is never
+   * left non-empty with its bit unset. A set bit of an empty stack is
+   * harmless (just costs a failed pop) */
+  uint64_t nonempty_mask_ = 0;
+
+  static_assert(chunk_sizes.size() <= 64);
+
+  inline void push_shared(size_t, chunk_t*, chunk_t*) noexcept;
+
+  /**
+   * @brief A per-thread cache of chunks with a bounded list for each
+   *        of the chunk sizes. Only accessed by its owner thread (or
+   *        in the destructor)
+   **/
+  struct magazine_t {
+    struct list_t {
+      chunk_t* head;
+      chunk_t* tail;
+      size_t count;
+    };
+
+    std::array<list_t, chunk_sizes.size()> lists;
+  };
+
+  struct no_magazines_t {};
+
+  // The size of memory each magazine record occupies in the pool
+  constexpr static size_t magazine_alloc_size =
+    (sizeof(typename thread_registry<magazine_t>::record_t)
+     + _cfg.min_chunk_size.get_mask()) & ~_cfg.min_chunk_size.get_mask();
+
+  inline magazine_t* get_magazine() noexcept;
+  inline magazine_t* find_magazine() noexcept;
+
+  // Same as get_magazine(), but returns nullptr if there is no thread
+  // cache at all
+  inline magazine_t* try_get_magazine() noexcept;
+
+  inline void push_chunks(magazine_t*, size_t,
+                          chunk_t*, chunk_t*, size_t) noexcept;
+
+  // Returns the cached chunks of all threads (and the depot) to the
+  // shared stacks (not thread safe)
+  inline void flush_magazines() noexcept;
+
+  /**
+   * @brief The header of a batch of chunks flushed from a magazine,
+   *        occupying its first chunk. Full batches are passed between
+   *        threads through the depot, so that the chunks freed by one
+   *        thread (e.g., a consumer) are taken by another one (e.g.,
+   *        the producer) in bulk rather than one by one
+   **/
+  struct batch_t {
+    batch_t* next;
+    chunk_t* rest;  // the chunks after the first one
+    chunk_t* tail;
+    size_t count;
+  };
+
+  constexpr static bool has_depot =
+    has_thread_cache && sizeof(batch_t) <= _cfg.min_chunk_size;
+
+  /**
+   * @brief Puts the list of chunks of the given size id to the depot
+   *        as a single batch (or to the shared stack if there is no
+   *        depot)
+   **/
+  inline void push_batch(size_t, chunk_t*, chunk_t*, size_t) noexcept;
+
+  /**
+   * @brief Takes a batch of chunks of the given size id from the
+   *        depot into the (empty) magazine list. Returns false if
+   *        there is none
+   **/
+  inline bool pop_batch(typename magazine_t::list_t&, size_t) noexcept;
+
+  // Turns the batch back into the list of its chunks
+  inline static typename magazine_t::list_t unpack_batch(batch_t*) noexcept;
+
+  struct no_depot_t {};
+
+  // The stacks of batches of every chunk size
+  [[no_unique_address]] std::conditional_t<has_depot,
+                                           std::array<stack<batch_t,
+                                                            thread_safety>,
+                                                      chunk_sizes.size()>,
+                                           no_depot_t> depot_;
+
+  inline void deallocate_to(magazine_t*, uintptr_t, size_t) noexcept;
+
+  // The records of magazines are allocated from the pool itself and
+  // returned to it in the destructor
+  [[no_unique_address]] std::conditional_t<has_thread_cache,
+                                           thread_registry<magazine_t>,
+                                           no_magazines_t> magazines_;
+
+  /**
+   * @brief The header of an upstream block, occupying its last
+   *        min_chunk_size bytes (trimmable pools only). Since headers
+   *        are never free, merged free regions never span several
+   *        blocks
+   **/
+  struct block_t {
+    block_t* next;
+    size_t size;  // as returned by the upstream
+  };
+
+  constexpr static size_t block_header_size =
+    _cfg.trimmable ? size_t(_cfg.min_chunk_size) : 0;
+
+  /**
+   * @brief Puts the header into the new upstream block and returns
+   *        the size of the rest of it
+   **/
+  inline size_t add_block(void*, size_t) noexcept;
+
+  static uintptr_t get_block_begin(const block_t* const block) noexcept {
+    return uintptr_t(block) + block_header_size
+      - (block->size & ~_cfg.min_chunk_size.get_mask());
+  }
+
+  struct no_blocks_t {};
+
+  // The list of all upstream blocks (push-only, except for the
+  // quiescent release_unused() calls)
+  [[no_unique_address]] std::conditional_t<_cfg.trimmable,
+                                           stack<block_t, thread_safety>,
+                                           no_blocks_t> blocks_;
+
+  static_assert(!_cfg.trimmable || sizeof(block_t) <= _cfg.min_chunk_size);
+
   static_assert(sizeof(chunk_t) <= _cfg.min_chunk_size);
 
+  /**
+   * @brief The header of a free large region kept for reuse (its size
+   *        is determined by the class)
+   **/
+  struct large_block_t {
+    large_block_t* next;
+  };
+
+  struct large_class_t {
+    size_t id;
+    size_t size;
+  };
+
+  constexpr static int large_base_log =
+    std::bit_width(_cfg.max_chunk_size) - 1;
+
+  /**
+   * @return the id and the size of the class of the given large size
+   *         (a multiple of min_chunk_size bigger than max_chunk_size).
+   *         The sizes in (2^k, 2^(k+1)] are ceiled to a multiple of
+   *         2^(k-2), so there are 4 classes per every power of 2
+   **/
+  constexpr static large_class_t get_large_class(size_t) noexcept;
+
+  // The number of the cached classes (some of the first ones may be
+  // unused if max_chunk_size is not a power of 2)
+  constexpr static size_t large_classes_count = has_large_cache
+    ? get_large_class(_cfg.max_cached_large_size).id + 1 : 0;
+
+  inline void* allocate_large(size_t, pow2_t) noexcept;
+  inline void deallocate_large(uintptr_t, size_t, pow2_t) noexcept;
+
+  /**
+   * @brief Returns all the cached large regions to the upstream (not
+   *        thread safe). Returns their total size
+   **/
+  inline size_t release_large_blocks() noexcept;
+
+  struct no_large_blocks_t {};
+
+  // The stacks of free large regions of every cached class
+  [[no_unique_address]] std::conditional_t<has_large_cache,
+                                           std::array<stack<large_block_t,
+                                                            thread_safety>,
+                                                      large_classes_count>,
+                                           no_large_blocks_t> large_blocks_;
+
   upstream_t upstream_;
 };
 
 template <sweeping_resource R, auto _cfg>
 consteval auto pool_resource_impl<R, _cfg>::get_chunk_sizes() noexcept {
+  if constexpr (!is_geometric) {
+    // Take the explicit list up to the first zero
+    constexpr auto& sizes = _cfg.explicit_chunk_sizes;
+    constexpr size_t count = ranges::find(sizes, 0) - sizes.begin();
+
+    constexpr bool is_valid = []() {
+      if (sizes[0] != _cfg.min_chunk_size) return false;
+      for (size_t i = 1; i < count; ++i)
+        if (sizes[i] <= sizes[i-1] || sizes[i] % _cfg.min_chunk_size)
+          return false;
+      return true;
+    }();
+    static_assert(is_valid, "explicit_chunk_sizes must be strictly "
+                  "increasing multiples of min_chunk_size starting "
+                  "with min_chunk_size");
+
+    std::array<size_t, count> result;
+    ranges::copy_n(sizes.begin(), count, result.begin());
+    return result;
+  }
+  else return get_geometric_chunk_sizes();
+}
+
+template <sweeping_resource R, auto _cfg>
+consteval auto pool_resource_impl<R, _cfg>::get_geometric_chunk_sizes()
+  noexcept {
   // Compute log base the multiplier
   static_assert(_cfg.chunk_size_multiplier > 0);
   constexpr auto log_mult = [](const size_t value) noexcept {
@@ -109,6 +378,58 @@ consteval auto pool_resource_impl<R, _cfg>::get_chunk_sizes() noexcept {
   return result;
 }
 
+template <sweeping_resource R, auto _cfg>
+consteval auto pool_resource_impl<R, _cfg>::get_size_classes() noexcept {
+  constexpr size_t max_table_size = 4096;
+  constexpr size_t units = chunk_sizes.back() / _cfg.min_chunk_size;
+
+  // Power of 2 multipliers don't need a table at all
+  if constexpr ((is_geometric
+                 && std::has_single_bit(_cfg.chunk_size_multiplier))
+                || units > max_table_size)
+    return std::array<uint8_t, 0>{};
+  else {
+    std::array<uint8_t, units> result;
+
+    uint8_t id = 0;
+    for (size_t i = 0; i < result.size(); ++i) {
+      if ((i + 1) * _cfg.min_chunk_size > chunk_sizes[id]) ++id;
+      result[i] = id;
+    }
+
+    return result;
+  }
+}
+
+template <sweeping_resource R, auto _cfg>
+constexpr size_t pool_resource_impl<R, _cfg>::get_size_class
+  (const size_t size) noexcept {
+  if (size > chunk_sizes.back()) [[unlikely]] return chunk_sizes.size();
+
+  const size_t units = size >> _cfg.min_chunk_size.log2();
+  if constexpr (!size_classes.empty())
+    return size_classes[units - 1];
+  else if constexpr (is_geometric
+                     && std::has_single_bit(_cfg.chunk_size_multiplier)) {
+    // Just the ceiled logarithm base the multiplier
+    constexpr int log_mult = std::countr_zero(_cfg.chunk_size_multiplier);
+    if constexpr (log_mult == 0) return 0;  // There's only one size
+    else return (std::bit_width(units - 1) + log_mult - 1) / log_mult;
+  }
+  else
+    return ranges::lower_bound(chunk_sizes, size) - chunk_sizes.begin();
+}
+
+template <sweeping_resource R, auto _cfg>
+constexpr auto pool_resource_impl<R, _cfg>::get_large_class
+  (const size_t size) noexcept -> large_class_t {
+  const int log = std::bit_width(size - 1) - 1;
+  const size_t units = ((size - 1) >> (log - 2)) + 1;  // 5 to 8
+
+  return { .id = 4 * size_t(log - large_base_log) + units - 5,
+           .size = units << (log - 2) };
+}
+
 template <sweeping_resource R, auto _cfg>
 void* pool_resource_impl<R, _cfg>::allocate_from_block
   (void* const block_ptr, const size_t block_size,
@@ -119,70 +440,375 @@ void* pool_resource_impl<R, _cfg>::allocate_from_block
 
   // The padding bytes and the tail might be repurposed for further
   // blocks (since size, alignment and padding are all multiples of
-  // min_chunk_size)
+  // min_chunk_size). NB: the magazine is never created here, since
+  // this may be the allocation of the magazine itself
+  const auto magazine = find_magazine();
 
-  if (padding) deallocate(uintptr_t(block_ptr), padding);
+  if (padding) deallocate_to(magazine, uintptr_t(block_ptr), padding);
 
   const auto left = block_size - padding - size;
-  if (left) deallocate(result + size, left);
+  if (left) deallocate_to(magazine, result + size, left);
 
   return reinterpret_cast<void*>(result);
 }
 
+template <sweeping_resource R, auto _cfg>
+size_t pool_resource_impl<R, _cfg>::get_stack_id
+  (const size_t size, const pow2_t alignment) noexcept {
+  for (size_t stack_id = get_size_class(size);
+       stack_id < chunk_sizes.size(); ++stack_id) {
+    // Make sure either the alignment is enough or we can compensate
+    // for it with (reusable) padding
+    const auto chunk_alignment = get_chunk_alignment(stack_id);
+    if (chunk_alignment >= alignment
+        || (alignment - chunk_alignment) <= chunk_sizes[stack_id] - size)
+      [[likely]] return stack_id;
+  }
+
+  return chunk_sizes.size();
+}
+
 template <sweeping_resource R, auto _cfg>
 void* pool_resource_impl<R, _cfg>::allocate(const size_t size,
                                             const pow2_t alignment) noexcept {
   if (size % _cfg.min_chunk_size) [[unlikely]] return nullptr;
 
+  if constexpr (has_large_tier)
+    if (size > _cfg.max_chunk_size) [[unlikely]]
+      return allocate_large(size, alignment);
+
   // First determine the stack we might try to take the memory from
-  for (size_t stack_id = 0; stack_id < chunk_sizes.size(); ++stack_id) {
-    const auto& chunk_size = chunk_sizes[stack_id];
-    if (chunk_size >= size) {
-      // Okay, this looks acceptable, check the alignment
-      const auto chunk_alignment = get_chunk_alignment(stack_id);
-
-      // Make sure either the alignment is enough or we can compensate
-      // for it with (reusable) padding
-      if (chunk_alignment >= alignment
-          || (alignment - chunk_alignment) <= chunk_size - size) {
-        // Okay, we have detirmined minimum stack_id by now. Pick a
-        // non-empty stack now
-        do {
-          if (auto chunk = chunk_stacks_[stack_id].pop()) {
-            // Found our guy
-            chunk->~chunk_t();
-            return allocate_from_block(chunk, chunk_sizes[stack_id],
-                                       size, alignment);
-          }
+  const auto stack_id = get_stack_id(size, alignment);
+
+  if constexpr (has_thread_cache) {
+    // The fast path: take the exact-size chunk from the local cache
+    // without any atomics
+    if (stack_id < chunk_sizes.size()) {
+      if (const auto magazine = get_magazine()) [[likely]] {
+        auto& list = magazine->lists[stack_id];
+        if (list.head || pop_batch(list, stack_id)) {
+          // NB: the tail's next pointer is not maintained
+          const auto chunk = list.head;
+          if (--list.count) list.head = chunk->next;
+          else list = {};
+
+          chunk->~chunk_t();
+          return allocate_from_block(chunk, chunk_sizes[stack_id],
+                                     size, alignment);
         }
-        while (++stack_id < chunk_stacks_.size());
-        break;  // Haven't found a non-empty stack. Proceed.
       }
     }
   }
 
+  return allocate_shared(stack_id, size, alignment);
+}
+
+template <sweeping_resource R, auto _cfg>
+void* pool_resource_impl<R, _cfg>::allocate_shared
+  (size_t stack_id, const size_t size, const pow2_t alignment) noexcept {
+  // We have detirmined minimum stack_id by now. Pick a non-empty
+  // stack according to the mask (see nonempty_mask_)
+  const auto mask_ref = make_mem_ref<thread_safety>(nonempty_mask_);
+  if (stack_id < chunk_sizes.size()) [[likely]] {
+    auto mask = mask_ref.load(mo_t::relaxed) & (~uint64_t(0) << stack_id);
+    while (mask) {
+      const auto id = size_t(std::countr_zero(mask));
+
+      if (const auto chunk = chunk_stacks_[id].pop()) {
+        // Found our guy
+        chunk->~chunk_t();
+        return allocate_from_block(chunk, chunk_sizes[id], size, alignment);
+      }
+
+      // The stack is empty, but something may have been pushed since
+      // the pop without the bit being set again. Look once more after
+      // clearing it, and if so, restore the bit and retry
+      const auto bit = uint64_t(1) << id;
+      mask_ref.fetch_and(~bit, mo_t::seq_cst);
+      if (chunk_stacks_[id].top(mo_t::seq_cst)) [[unlikely]]
+        mask_ref.fetch_or(bit, mo_t::relaxed);
+      else mask&= ~bit;
+    }
+  }
+
   // If got here, we haven't found the proper non-empty
   // stack. Allocate directly from the upstream
   const auto max_padding =
     alignment - nupp::minimum(alignment, get_upstream_alignment());
 
   const auto req_size =
-    nupp::maximum(max_padding + size,
+    nupp::maximum(max_padding + size + block_header_size,
                   _cfg.max_chunk_size * _cfg.chunk_size_multiplier);
 
   const auto [alloc_result, alloc_size] =
     allocate_at_least<exceptions_policy::nothrow>(upstream_, req_size,
                                                   _cfg.min_chunk_size);
   if (!alloc_result) [[unlikely]] return nullptr;
-  return allocate_from_block(alloc_result, alloc_size, size, alignment);
+
+  if constexpr (_cfg.trimmable)
+    return allocate_from_block(alloc_result,
+                               add_block(alloc_result, alloc_size),
+                               size, alignment);
+  else
+    return allocate_from_block(alloc_result, alloc_size, size, alignment);
+}
+
+template <sweeping_resource R, auto _cfg>
+void* pool_resource_impl<R, _cfg>::allocate_large(const size_t size,
+                                                  const pow2_t alignment)
+  noexcept {
+  // Over-aligned regions are never cached since the blocks are always
+  // allocated with the default alignment
+  if (alignment > get_upstream_alignment()) [[unlikely]]
+    return allocate_at_least<exceptions_policy::nothrow>(upstream_, size,
+                                                         alignment).ptr;
+
+  if constexpr (has_large_cache) {
+    const auto [id, class_size] = get_large_class(size);
+    if (id < large_classes_count) {
+      if (const auto block = large_blocks_[id].pop()) {
+        block->~large_block_t();
+        return block;
+      }
+
+      return allocate_at_least<exceptions_policy::nothrow>
+        (upstream_, class_size, _cfg.min_chunk_size).ptr;
+    }
+  }
+
+  return allocate_at_least<exceptions_policy::nothrow>
+    (upstream_, size, _cfg.min_chunk_size).ptr;
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::deallocate_large(const uintptr_t ptr,
+                                                   const size_t size,
+                                                   const pow2_t alignment)
+  noexcept {
+  // NB: the sizes are ceiled the same way allocate_at_least() does
+  if (alignment > get_upstream_alignment()) [[unlikely]] {
+    memaw::deallocate<exceptions_policy::nothrow>
+      (upstream_, reinterpret_cast<void*>(ptr),
+       resource_traits<upstream_t>::ceil_allocation_size(size), alignment);
+    return;
+  }
+
+  if constexpr (has_large_cache) {
+    const auto id = get_large_class(size).id;
+    if (id < large_classes_count) {
+      large_blocks_[id].push(new (reinterpret_cast<void*>(ptr))
+                             large_block_t{ .next = nullptr });
+      return;
+    }
+  }
+
+  memaw::deallocate<exceptions_policy::nothrow>
+    (upstream_, reinterpret_cast<void*>(ptr),
+     resource_traits<upstream_t>::ceil_allocation_size(size),
+     _cfg.min_chunk_size);
+}
+
+template <sweeping_resource R, auto _cfg>
+size_t pool_resource_impl<R, _cfg>::release_large_blocks() noexcept {
+  size_t result = 0;
+
+  if constexpr (has_large_cache) {
+    for (size_t id = 0; id < large_classes_count; ++id) {
+      // The inverse of get_large_class()
+      const int log = int(id / 4) + large_base_log;
+      const auto size = resource_traits<upstream_t>::ceil_allocation_size
+        ((id % 4 + 5) << (log - 2));
+
+      for (auto block = large_blocks_[id].reset(); block;) {
+        const auto next_block = block->next;
+        block->~large_block_t();
+
+        memaw::deallocate<exceptions_policy::nothrow>
+          (upstream_, block, size, _cfg.min_chunk_size);
+        result+= size;
+
+        block = next_block;
+      }
+    }
+  }
+
+  return result;
+}
+
+template <sweeping_resource R, auto _cfg>
+size_t pool_resource_impl<R, _cfg>::add_block(void* const ptr,
+                                              const size_t size) noexcept {
+  const auto usable_size =
+    (size & ~_cfg.min_chunk_size.get_mask()) - block_header_size;
+
+  const auto block = new (reinterpret_cast<std::byte*>(ptr) + usable_size)
+    block_t{ .next = nullptr, .size = size };
+  blocks_.push(block);
+
+  return usable_size;
+}
+
+template <sweeping_resource R, auto _cfg>
+auto pool_resource_impl<R, _cfg>::get_magazine() noexcept -> magazine_t* {
+  return magazines_.get([this](size_t) noexcept {
+    // The record takes some chunks from the pool itself
+    return allocate_shared(get_stack_id(magazine_alloc_size,
+                                        _cfg.min_chunk_size),
+                           magazine_alloc_size, _cfg.min_chunk_size);
+  });
+}
+
+template <sweeping_resource R, auto _cfg>
+auto pool_resource_impl<R, _cfg>::find_magazine() noexcept -> magazine_t* {
+  if constexpr (has_thread_cache) return magazines_.find();
+  else return nullptr;
+}
+
+template <sweeping_resource R, auto _cfg>
+auto pool_resource_impl<R, _cfg>::try_get_magazine() noexcept
+  -> magazine_t* {
+  if constexpr (has_thread_cache) return get_magazine();
+  else return nullptr;
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::push_chunks
+  (magazine_t* const magazine, const size_t id, chunk_t* const first,
+   chunk_t* const last, const size_t count) noexcept {
+  if constexpr (has_thread_cache) {
+    if (magazine) {
+      // Put new chunks in front since they're more likely to be hot
+      auto& list = magazine->lists[id];
+      last->next = list.head;
+      if (!list.head) list.tail = last;
+      list.head = first;
+      list.count+= count;
+
+      if (list.count <= _cfg.thread_cache_size) return;
+
+      // The magazine is full, so flush its colder part to the depot
+      // as a single batch, leaving it half-full
+      constexpr size_t keep = _cfg.thread_cache_size / 2;
+      if constexpr (keep == 0) {
+        push_batch(id, list.head, list.tail, list.count);
+        list = {};
+      }
+      else {
+        auto split = list.head;
+        for (size_t i = 1; i < keep; ++i) split = split->next;
+
+        push_batch(id, split->next, list.tail, list.count - keep);
+        list.tail = split;
+        list.count = keep;
+      }
+      return;
+    }
+  }
+
+  push_shared(id, first, last);
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::push_shared(const size_t id,
+                                              chunk_t* const first,
+                                              chunk_t* const last) noexcept {
+  // NB: seq_cst, so that either the following load sees the bit
+  // cleared or the clearing thread sees the chunks (see nonempty_mask_)
+  chunk_stacks_[id].push(first, last, mo_t::seq_cst);
+
+  // Avoid the (contended) RMW if the bit is already there
+  const auto bit = uint64_t(1) << id;
+  const auto mask_ref = make_mem_ref<thread_safety>(nonempty_mask_);
+  if (!(mask_ref.load(mo_t::seq_cst) & bit)) [[unlikely]]
+    mask_ref.fetch_or(bit, mo_t::relaxed);
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::push_batch(const size_t id,
+                                             chunk_t* const first,
+                                             chunk_t* const last,
+                                             const size_t count) noexcept {
+  if constexpr (has_depot) {
+    // NB: the next pointer of the last chunk is not maintained
+    const auto rest = (count > 1) ? first->next : nullptr;
+    first->~chunk_t();
+
+    depot_[id].push(new (first) batch_t{ .next = nullptr, .rest = rest,
+                                         .tail = last, .count = count });
+  }
+  else push_shared(id, first, last);
+}
+
+template <sweeping_resource R, auto _cfg>
+bool pool_resource_impl<R, _cfg>::pop_batch
+  (typename magazine_t::list_t& list, const size_t id) noexcept {
+  if constexpr (has_depot) {
+    const auto batch = depot_[id].pop();
+    if (!batch) return false;
+
+    list = unpack_batch(batch);
+    return true;
+  }
+  else return false;
+}
+
+template <sweeping_resource R, auto _cfg>
+auto pool_resource_impl<R, _cfg>::unpack_batch(batch_t* const batch)
+  noexcept -> typename magazine_t::list_t {
+  const auto [next, rest, tail, count] = *batch;
+  batch->~batch_t();
+
+  const auto first = new (batch) chunk_t{ .next = rest, .size = 0 };
+  return { .head = first, .tail = (count > 1) ? tail : first,
+           .count = count };
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::flush_magazines() noexcept {
+  if constexpr (has_thread_cache) {
+    magazines_.for_each([this](magazine_t& magazine) noexcept {
+      for (size_t i = 0; i < chunk_stacks_.size(); ++i) {
+        auto& list = magazine.lists[i];
+        if (list.count) push_shared(i, list.head, list.tail);
+        list = {};
+      }
+    });
+  }
+
+  if constexpr (has_depot) {
+    for (size_t i = 0; i < depot_.size(); ++i) {
+      for (auto batch = depot_[i].reset(); batch;) {
+        const auto next_batch = batch->next;
+
+        const auto list = unpack_batch(batch);
+        push_shared(i, list.head, list.tail);
+
+        batch = next_batch;
+      }
+    }
+  }
 }
 
 template <sweeping_resource R, auto _cfg>
 void pool_resource_impl<R, _cfg>::deallocate(const uintptr_t ptr,
-                                             const size_t size) noexcept {
+                                             const size_t size,
+                                             const pow2_t alignment) noexcept {
   if (!ptr || size < _cfg.min_chunk_size) [[unlikely]]
     return;  // Don't bother with bad params
 
+  if constexpr (has_large_tier)
+    if (size > _cfg.max_chunk_size) [[unlikely]]
+      return deallocate_large(ptr, size, alignment);
+
+  // NB: the magazine is created here as well, so that the threads
+  // that only free memory pass it to the others in batches
+  deallocate_to(try_get_magazine(), ptr, size);
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::deallocate_to(magazine_t* const magazine,
+                                                const uintptr_t ptr,
+                                                const size_t size) noexcept {
   // Break the block [ptr, ptr+size) into stack chunks prioritizing
   // bigger ones
   const auto upper_ptr = uintptr_t(ptr);
@@ -220,6 +846,7 @@ void pool_resource_impl<R, _cfg>::deallocate(const uintptr_t ptr,
     // expensive concurrent stack push instruction
     chunk_t* head = nullptr;
     chunk_t* last;
+    size_t count = 0;
 
     // Upper part: go from the bottom
     while (upper_size >= chunk_size) {
@@ -232,6 +859,7 @@ void pool_resource_impl<R, _cfg>::deallocate(const uintptr_t ptr,
         head = new_chunk;
       }
       else head = last = new_chunk;
+      ++count;
     }
 
     // Lower part: go from the top
@@ -246,15 +874,236 @@ void pool_resource_impl<R, _cfg>::deallocate(const uintptr_t ptr,
 
       lower_ptr+= chunk_size;
       lower_size-= chunk_size;
+      ++count;
     }
 
     // Finally push if found
-    if (head) chunk_stacks_[i].push(head, last);
+    if (head) push_chunks(magazine, i, head, last, count);
   }
 }
 
+template <sweeping_resource R, auto _cfg>
+size_t pool_resource_impl<R, _cfg>::allocate_batch
+  (const size_t count, const size_t size, const pow2_t alignment,
+   void** const out) noexcept {
+  if (!size || size % _cfg.min_chunk_size) [[unlikely]] return 0;
+
+  const auto stack_id = get_stack_id(size, alignment);
+  size_t result = 0;
+
+  if (stack_id < chunk_sizes.size()) [[likely]] {
+    const auto take = [&](chunk_t* const chunk) noexcept {
+      chunk->~chunk_t();
+      out[result++] = allocate_from_block(chunk, chunk_sizes[stack_id],
+                                          size, alignment);
+    };
+
+    if constexpr (has_thread_cache) {
+      // Empty the local list first (refilling it from the depot)
+      if (const auto magazine = get_magazine()) [[likely]] {
+        auto& list = magazine->lists[stack_id];
+        while (result < count
+               && (list.count || pop_batch(list, stack_id))) {
+          const auto chunk = list.head;
+          if (--list.count) list.head = chunk->next;
+          else list = {};
+          take(chunk);
+        }
+      }
+    }
+
+    // Then pop the missing chunks off the shared stack one by one,
+    // leaving the rest of it available to the other threads
+    auto& stack = chunk_stacks_[stack_id];
+    while (result < count) {
+      const auto chunk = stack.pop();
+      if (!chunk) break;
+      take(chunk);
+    }
+  }
+
+  // Whatever is missing comes from the other stacks or the upstream
+  for (; result < count; ++result) {
+    out[result] = allocate(size, alignment);
+    if (!out[result]) [[unlikely]] break;
+  }
+
+  return result;
+}
+
+template <sweeping_resource R, auto _cfg>
+void pool_resource_impl<R, _cfg>::deallocate_batch
+  (const size_t count, const size_t size, const pow2_t alignment,
+   void* const* const ptrs) noexcept {
+  if (size < _cfg.min_chunk_size) [[unlikely]] return;
+
+  if constexpr (has_large_tier) {
+    if (size > _cfg.max_chunk_size) [[unlikely]] {
+      for (size_t i = 0; i < count; ++i)
+        if (ptrs[i]) deallocate_large(uintptr_t(ptrs[i]), size, alignment);
+      return;
+    }
+  }
+
+  const auto magazine = try_get_magazine();
+
+  // If the regions are exactly of a chunk size, link the (properly
+  // aligned) ones into a list and push it at once
+  const auto id = get_size_class(size);
+  if (id < chunk_sizes.size() && chunk_sizes[id] == size) {
+    const auto alignment_mask = get_chunk_alignment(id).get_mask();
+
+    chunk_t* head = nullptr;
+    chunk_t* last = nullptr;
+    size_t listed = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+      const auto ptr = uintptr_t(ptrs[i]);
+      if (!ptr) [[unlikely]] continue;
+
+      if (ptr & alignment_mask) [[unlikely]] {
+        deallocate_to(magazine, ptr, size);
+        continue;
+      }
+
+      const auto chunk = new (ptrs[i]) chunk_t;
+      chunk->next = head;
+      head = chunk;
+      if (!listed++) last = chunk;
+    }
+
+    if (head) push_chunks(magazine, id, head, last, listed);
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (ptrs[i]) deallocate_to(magazine, uintptr_t(ptrs[i]), size);
+  }
+}
+
+template <sweeping_resource R, auto _cfg>
+size_t pool_resource_impl<R, _cfg>::release_unused(const size_t keep_bytes)
+  noexcept requires(_cfg.trimmable) {
+  flush_magazines();
+
+  // Sort and merge all the free regions like in the destructor
+  chunk_t* regions = nullptr;
+  for (size_t i = 0; i < chunk_stacks_.size(); ++i)
+    regions = merge_chunks(chunk_stacks_[i].reset(), chunk_sizes[i], regions);
+  make_mem_ref<thread_safety>(nonempty_mask_).store(0, mo_t::relaxed);
+
+  // Returns the first region of the list back to the stacks
+  const auto restore_region = [this, &regions]() noexcept {
+    const auto region = regions;
+    const auto size = region->size;
+    regions = region->next;
+
+    region->~chunk_t();
+    deallocate_to(nullptr, uintptr_t(region), size);
+  };
+
+  // Now go through the blocks in the same order: a block is free iff
+  // there is a region covering all of it but the header
+  block_t* kept_head = nullptr;
+  block_t* kept_tail = nullptr;
+  size_t kept_size = 0, released_size = release_large_blocks();
+
+  for (auto block = sort_list(blocks_.reset()); block;) {
+    const auto next_block = block->next;
+    const auto begin = get_block_begin(block);
+
+    while (regions && uintptr_t(regions) < begin) restore_region();
+
+    const bool is_free = regions && uintptr_t(regions) == begin
+      && uintptr_t(regions) + regions->size == uintptr_t(block);
+
+    if (is_free && kept_size + block->size > keep_bytes) {
+      const auto region = regions;
+      regions = region->next;
+      region->~chunk_t();
+
+      const auto size = block->size;
+      block->~block_t();
+
+      memaw::deallocate<exceptions_policy::nothrow>
+        (upstream_, reinterpret_cast<void*>(begin), size, _cfg.min_chunk_size);
+      released_size+= size;
+    }
+    else {
+      if (is_free) kept_size+= block->size;
+
+      block->next = kept_head;
+      kept_head = block;
+      if (!kept_tail) kept_tail = block;
+    }
+
+    block = next_block;
+  }
+
+  while (regions) restore_region();
+  if (kept_head) blocks_.push(kept_head, kept_tail);
+
+  return released_size;
+}
+
+template <sweeping_resource R, auto _cfg>
+auto pool_resource_impl<R, _cfg>::count_free_chunks() noexcept
+  -> std::array<size_t, chunk_sizes.size()> {
+  std::array<size_t, chunk_sizes.size()> result = {};
+
+  for (size_t i = 0; i < chunk_stacks_.size(); ++i) {
+    for (auto chunk = chunk_stacks_[i].peek(); chunk; chunk = chunk->next)
+      ++result[i];
+  }
+
+  if constexpr (has_thread_cache) {
+    magazines_.for_each([&result](magazine_t& magazine) noexcept {
+      for (size_t i = 0; i < result.size(); ++i)
+        result[i]+= magazine.lists[i].count;
+    });
+  }
+
+  if constexpr (has_depot) {
+    for (size_t i = 0; i < depot_.size(); ++i) {
+      for (auto batch = depot_[i].peek(); batch; batch = batch->next)
+        result[i]+= batch->count;
+    }
+  }
+
+  return result;
+}
+
 template <sweeping_resource R, auto _cfg>
 pool_resource_impl<R, _cfg>::~pool_resource_impl() noexcept {
+  release_large_blocks();
+
+  if constexpr (has_thread_cache) {
+    // Return everything cached by threads, including the magazines
+    // themselves
+    flush_magazines();
+    magazines_.clear([this](void* const ptr) noexcept {
+      deallocate_to(nullptr, uintptr_t(ptr), magazine_alloc_size);
+    });
+  }
+
+  if constexpr (_cfg.trimmable) {
+    // All the chunks must be free by now, so just return the blocks
+    for (auto& stack : chunk_stacks_) stack.reset();
+
+    for (auto block = blocks_.reset(); block;) {
+      const auto next_block = block->next;
+      const auto begin = get_block_begin(block);
+      const auto size = block->size;
+      block->~block_t();
+
+      memaw::deallocate<exceptions_policy::nothrow>
+        (upstream_, reinterpret_cast<void*>(begin), size, _cfg.min_chunk_size);
+
+      block = next_block;
+    }
+    return;
+  }
+
   // First sort and merge all the regions from stacks
   chunk_t* merged_head = nullptr;
   for (size_t i = 0; i < chunk_stacks_.size(); ++i)
@@ -29,12 +29,68 @@ constexpr std::pair<uintptr_t, size_t> align_pointer
   return std::make_pair(result, padding);
 }
 
+/**
+ * @brief The concept of items of an intrusive singly linked list
+ **/
+template <typename T>
+concept list_item = requires(T item) {
+  { item.next } -> std::same_as<T*&>;
+};
+
+/**
+ * @brief Merges two (singly) linked lists sorted by the item
+ *        addresses and returns the head of the resulting list
+ **/
+template <list_item T>
+inline T* merge_sorted_lists(T* lhs, T* rhs) noexcept {
+  T* result;
+  T** tail = &result;
+
+  while (lhs && rhs) {
+    auto& min = (uintptr_t(lhs) < uintptr_t(rhs)) ? lhs : rhs;
+    *tail = min;
+    tail = &min->next;
+    min = min->next;
+  }
+
+  *tail = lhs ? lhs : rhs;
+  return result;
+}
+
+/**
+ * @brief Sorts a (singly) linked list by the item addresses (with the
+ *        bottom-up merge sort) and returns the head of the new list
+ **/
+template <list_item T>
+inline T* sort_list(T* head) noexcept {
+  // bins[i] is either empty or a sorted list of 2^i items
+  T* bins[64] = {};
+
+  while (head) {
+    auto list = head;
+    head = head->next;
+    list->next = nullptr;
+
+    size_t i = 0;
+    for (; bins[i]; ++i) {
+      list = merge_sorted_lists(bins[i], list);
+      bins[i] = nullptr;
+    }
+    bins[i] = list;
+  }
+
+  T* result = nullptr;
+  for (const auto bin : bins)
+    if (bin) result = merge_sorted_lists(bin, result);
+
+  return result;
+}
+
 /**
  * @brief The concept of types used to mark free memory chunks
  **/
 template <typename C>
-concept free_chunk = requires(C chunk) {
-  { chunk.next } -> std::convertible_to<C*>;
+concept free_chunk = list_item<C> && requires(C chunk) {
   { chunk.size } -> std::convertible_to<size_t>;
 };
 
@@ -47,54 +103,30 @@ concept free_chunk = requires(C chunk) {
  *        the list, otherwise the value is read from the C::size field
  * @param sorted the part of the list that already went through the
  *        procedure (if any)
+ * @note  The complexity is O(n log n + m) for the list of n chunks and
+ *        the sorted part of m regions
  **/
 template <free_chunk C>
 inline C* merge_chunks(C* const head, const size_t fixed_size = 0,
                        C* const sorted = nullptr) noexcept {
-  C* turkish_delight = sorted;  // "result", but I couldn't resist
+  if (fixed_size)
+    for (auto chunk = head; chunk; chunk = chunk->next)
+      chunk->size = fixed_size;
 
-  for (auto chunk = head; chunk;) {
-    const auto chunk_begin = uintptr_t(chunk);
+  // The sorted part is already merged, so after the merge of the
+  // lists the adjacent regions can only be neighbours in the result
+  C* const turkish_delight =  // "result", but I couldn't resist
+    merge_sorted_lists(sort_list(head), sorted);
 
-    if (fixed_size) chunk->size = fixed_size;
-    const auto chunk_end = chunk_begin + chunk->size;
+  for (auto region = turkish_delight; region;) {
+    const auto next_region = region->next;
 
-    const auto next_chunk = chunk->next;
-
-    // This works like insertion sort, only we merge the adjacent
-    // regions together
-    C* prev_region = nullptr;          // null or < chunk_begin
-    C* next_region = turkish_delight;  // null or > chunk_begin
-    while (next_region && chunk_begin > uintptr_t(next_region)) {
-      prev_region = next_region;
-      next_region = next_region->next;
-    }
-
-    // We either put chunk between prev and next or merge 2 or 3 of
-    // them together
-
-    if (uintptr_t(next_region) == chunk_end) {
-      // Merge with next (never 0 here)
-      chunk->size+= next_region->size;
-      chunk->next = next_region->next;
+    if (uintptr_t(region) + region->size == uintptr_t(next_region)) {
+      region->size+= next_region->size;
+      region->next = next_region->next;
       next_region->~C();
     }
-    else chunk->next = next_region;
-
-    if (prev_region) {
-      const auto prev_region_end = uintptr_t(prev_region) + prev_region->size;
-
-      if (prev_region_end == chunk_begin) {
-        // Merge with prev
-        prev_region->size+= chunk->size;
-        prev_region->next = chunk->next;
-        chunk->~C();
-      }
-      else prev_region->next = chunk;
-    }
-    else turkish_delight = chunk;  // Put to the front
-
-    chunk = next_chunk;
+    else region = next_region;
   }
 
   return turkish_delight/* on a moonlit night!*/;
@@ -0,0 +1,347 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <new>
+#include <nupp/algorithm.hpp>
+#include <type_traits>
+#include <utility>
+
+#include "../resource_traits.hpp"
+#include "stack.hpp"
+#include "tagged_ptr.hpp"
+
+/**
+ * @file
+ * The implementation of slab_resource
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+template <resource R, size_t _object_size, auto _cfg>
+class slab_resource_impl {
+public:
+  using upstream_t = R;
+
+  constexpr static auto thread_safety = _cfg.thread_safe
+    ? thread_safe : thread_unsafe;
+
+  /**
+   * @brief The alignment of every slot (the biggest power of 2 that
+   *        divides the object size, but not more than the slab size)
+   **/
+  constexpr static pow2_t object_alignment =
+    nupp::minimum(pow2_t{1} << std::countr_zero(_object_size),
+                  _cfg.slab_size);
+
+private:
+  struct slot_t {
+    slot_t* next;
+  };
+
+  /**
+   * @brief The free list of a slab and a flag that is set iff the slab
+   *        is in the list of available ones, changed together with a
+   *        single (DW)CAS. The tag is the ABA counter (incremented by
+   *        2) with the flag in its lowest bit
+   **/
+  using free_list_t = tagged_ptr<slot_t, thread_safety, object_alignment>;
+
+  constexpr static size_t listed_flag = 1;
+
+  /**
+   * @brief The header of an upstream block, occupying the beginning
+   *        of its first slab
+   **/
+  struct block_t {
+    block_t* next;
+    size_t size;  // as returned by the upstream
+  };
+
+  /**
+   * @brief The header of a slab, occupying its beginning (the slots
+   *        follow it, aligned by object_alignment). Since slabs are
+   *        aligned by their size, it is found by the slot address
+   **/
+  struct slab_t {
+    slab_t* next;
+    block_t block;  // only used in the first slab of a block
+    free_list_t free_list;
+  };
+
+public:
+  constexpr static size_t slots_offset =
+    (sizeof(slab_t) + object_alignment.get_mask())
+    & ~object_alignment.get_mask();
+
+  constexpr static size_t slots_per_slab =
+    (_cfg.slab_size - nupp::minimum(slots_offset, size_t(_cfg.slab_size)))
+    / _object_size;
+
+  constexpr slab_resource_impl()
+    noexcept(std::is_nothrow_default_constructible_v<upstream_t>) = default;
+
+  constexpr slab_resource_impl(upstream_t&& upstream)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    upstream_(std::move(upstream)) {}
+
+  inline ~slab_resource_impl() noexcept;
+
+  constexpr slab_resource_impl(slab_resource_impl&& rhs)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    available_slabs_(std::move(rhs.available_slabs_)),
+    fresh_slabs_(std::move(rhs.fresh_slabs_)),
+    blocks_(std::move(rhs.blocks_)),
+    upstream_(std::move(rhs.upstream_)) {}
+
+  [[nodiscard]] inline void* allocate() noexcept;
+  inline void deallocate(void*) noexcept;
+
+  inline size_t count_free_slots() noexcept;
+
+  const upstream_t& get_upstream() const noexcept {
+    return upstream_;
+  }
+
+  bool operator==(const slab_resource_impl& rhs) const noexcept {
+    return this == &rhs;
+  }
+
+private:
+  static slab_t* get_slab(const void* const ptr) noexcept {
+    return reinterpret_cast<slab_t*>(uintptr_t(ptr)
+                                     & ~_cfg.slab_size.get_mask());
+  }
+
+  static slot_t* get_slot(slab_t* const slab, const size_t id) noexcept {
+    return reinterpret_cast<slot_t*>(reinterpret_cast<std::byte*>(slab)
+                                     + slots_offset + id * _object_size);
+  }
+
+  /**
+   * @brief Takes a slot off the free list of the slab (or returns
+   *        nullptr if it is empty)
+   **/
+  inline static slot_t* pop_slot(slab_t*) noexcept;
+
+  /**
+   * @brief Puts the slot to the free list of its slab, setting the
+   *        listed flag. Returns the old value of the flag
+   **/
+  inline static bool push_slot(slab_t*, slot_t*) noexcept;
+
+  /**
+   * @brief Resets the listed flag of the slab iff its free list is
+   *        empty. Returns true on success
+   **/
+  inline static bool try_unlist(slab_t*) noexcept;
+
+  /**
+   * @brief Fills the free list of the slab with all of its slots but
+   *        the first one, which is returned
+   **/
+  inline static slot_t* init_slab(slab_t*) noexcept;
+
+  /**
+   * @brief Allocates a new block from the upstream, puts all of its
+   *        slabs but the first one to the fresh list. Returns the
+   *        first slab (or nullptr on failure)
+   **/
+  inline slab_t* allocate_block() noexcept;
+
+  /* The slabs that (probably) have free slots. A slab is in the stack
+   * iff its listed flag is set, except for the moments when a thread
+   * has popped it to check if it is full */
+  stack<slab_t, thread_safety> available_slabs_;
+
+  // The slabs that have never been used (and whose memory hasn't been
+  // touched), taken when there are no available ones
+  stack<slab_t, thread_safety> fresh_slabs_;
+
+  // The list of all the upstream blocks (push-only)
+  stack<block_t, thread_safety> blocks_;
+
+  upstream_t upstream_;
+};
+
+template <resource R, size_t _object_size, auto _cfg>
+auto slab_resource_impl<R, _object_size, _cfg>::pop_slot
+  (slab_t* const slab) noexcept -> slot_t* {
+  // Acquire the head since we're reading the next pointer from it
+  auto old_list = free_list_t::load(slab->free_list, mo_t::acquire);
+
+  free_list_t new_list;
+  const auto list_ref = make_mem_ref<thread_safety>(slab->free_list);
+  do {
+    if (!old_list.ptr()) return nullptr;
+
+    // NB: the slot might have been allocated by another thread by now,
+    // but its memory is still accessible and the tag will change
+    new_list = {
+      make_mem_ref<thread_safety>(old_list.ptr()->next).load(mo_t::relaxed),
+      old_list.tag() + 2
+    };
+  }
+  while (!list_ref.compare_exchange_weak(old_list, new_list,
+                                         mo_t::acquire, mo_t::acquire));
+
+  return old_list.ptr();
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+bool slab_resource_impl<R, _object_size, _cfg>::push_slot
+  (slab_t* const slab, slot_t* const slot) noexcept {
+  auto old_list = free_list_t::load(slab->free_list, mo_t::relaxed);
+  free_list_t new_list;
+
+  const auto next_ref = make_mem_ref<thread_safety>(slot->next);
+  const auto list_ref = make_mem_ref<thread_safety>(slab->free_list);
+  do {
+    next_ref.store(old_list.ptr(), mo_t::relaxed);
+    new_list = { slot, (old_list.tag() + 2) | listed_flag };
+  }
+  while (!list_ref.compare_exchange_weak(old_list, new_list,
+                                         mo_t::release, mo_t::relaxed));
+
+  return old_list.tag() & listed_flag;
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+bool slab_resource_impl<R, _object_size, _cfg>::try_unlist
+  (slab_t* const slab) noexcept {
+  auto old_list = free_list_t::load(slab->free_list, mo_t::relaxed);
+
+  const auto list_ref = make_mem_ref<thread_safety>(slab->free_list);
+  do {
+    if (old_list.ptr()) return false;
+  }
+  while (!list_ref.compare_exchange_weak
+         (old_list, { nullptr, (old_list.tag() + 2) & ~listed_flag },
+          mo_t::relaxed, mo_t::relaxed));
+
+  return true;
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+auto slab_resource_impl<R, _object_size, _cfg>::init_slab
+  (slab_t* const slab) noexcept -> slot_t* {
+  // Link the slots in the address order, so that the new slab is
+  // allocated sequentially
+  slot_t* head = nullptr;
+  for (size_t i = slots_per_slab - 1; i > 0; --i)
+    head = new (get_slot(slab, i)) slot_t{ .next = head };
+
+  slab->free_list = { head, listed_flag };
+  return get_slot(slab, 0);
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+auto slab_resource_impl<R, _object_size, _cfg>::allocate_block() noexcept
+  -> slab_t* {
+  const auto [ptr, alloc_size] =
+    allocate_at_least<exceptions_policy::nothrow>(upstream_, _cfg.block_size,
+                                                  _cfg.slab_size);
+  if (!ptr) [[unlikely]] return nullptr;
+
+  const auto begin = reinterpret_cast<std::byte*>(ptr);
+  const auto count = alloc_size >> _cfg.slab_size.log2();
+
+  const auto first = new (begin) slab_t{};
+  first->block = { .next = nullptr, .size = alloc_size };
+  blocks_.push(&first->block);
+
+  if (count > 1) {
+    // NB: only the headers are written, the rest of the memory is
+    // touched when the slab is taken
+    const auto get_ptr = [begin](const size_t id) noexcept {
+      return begin + (id << _cfg.slab_size.log2());
+    };
+
+    slab_t* head = nullptr;
+    for (size_t i = count - 1; i > 0; --i)
+      head = new (get_ptr(i)) slab_t{ .next = head, .block = {},
+                                      .free_list = {} };
+
+    fresh_slabs_.push(head, reinterpret_cast<slab_t*>(get_ptr(count - 1)));
+  }
+
+  return first;
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+void* slab_resource_impl<R, _object_size, _cfg>::allocate() noexcept {
+  while (true) {
+    if (const auto slab = available_slabs_.top()) [[likely]] {
+      // The slab may still be popped (and even become full) by now,
+      // but its memory is never released, so just try it
+      if (const auto slot = pop_slot(slab)) [[likely]] {
+        slot->~slot_t();
+        return slot;
+      }
+
+      // The slab is full. Take it (or whatever is on the top now) off
+      // the stack unless someone has freed a slot in the meantime
+      if (const auto popped = available_slabs_.pop())
+        if (!try_unlist(popped)) available_slabs_.push(popped);
+
+      continue;
+    }
+
+    // No slabs with free slots, so take a new one
+    auto slab = fresh_slabs_.pop();
+    if (!slab) {
+      slab = allocate_block();
+      if (!slab) [[unlikely]] return nullptr;
+    }
+
+    const auto result = init_slab(slab);
+    available_slabs_.push(slab);
+    return result;
+  }
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+void slab_resource_impl<R, _object_size, _cfg>::deallocate
+  (void* const ptr) noexcept {
+  const auto slab = get_slab(ptr);
+
+  // If the slab has been full, we're the ones to make it available
+  if (!push_slot(slab, new (ptr) slot_t)) available_slabs_.push(slab);
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+size_t slab_resource_impl<R, _object_size, _cfg>::count_free_slots()
+  noexcept {
+  size_t result = 0;
+
+  for (auto slab = available_slabs_.peek(); slab; slab = slab->next)
+    for (auto slot = slab->free_list.ptr(); slot; slot = slot->next)
+      ++result;
+
+  for (auto slab = fresh_slabs_.peek(); slab; slab = slab->next)
+    result+= slots_per_slab;
+
+  return result;
+}
+
+template <resource R, size_t _object_size, auto _cfg>
+slab_resource_impl<R, _object_size, _cfg>::~slab_resource_impl() noexcept {
+  // All the slots must be free by now, so just return the blocks
+  available_slabs_.reset();
+  fresh_slabs_.reset();
+
+  for (auto block = blocks_.reset(); block;) {
+    const auto next_block = block->next;
+    const auto size = block->size;
+    block->~block_t();
+
+    memaw::deallocate<exceptions_policy::nothrow>
+      (upstream_, get_slab(block), size, _cfg.slab_size);
+
+    block = next_block;
+  }
+}
+
+} // namespace memaw::__detail
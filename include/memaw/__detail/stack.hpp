@@ -3,6 +3,7 @@
 
 #include "base.hpp"
 #include "mem_ref.hpp"
+#include "tagged_ptr.hpp"
 
 /**
  * @file
@@ -20,7 +21,10 @@ concept stackable = requires(T item) {
 };
 
 /**
- * @brief A simple lock-free stack of pointers
+ * @brief A simple lock-free stack of pointers. The head is a tagged
+ *        pointer with the ABA counter, so the thread safe stack uses
+ *        DWCAS if available and packs the counter into the pointer
+ *        otherwise
  **/
 template <stackable T, thread_safety_t _ts>
 class stack {
@@ -31,80 +35,91 @@ public:
   stack& operator=(const stack&) = delete;
   stack& operator=(stack&&) = delete;
 
-  stack(stack&& rhs): head_{ .ptr = rhs.reset(), .aba_counter = 0 } {}
+  stack(stack&& rhs): head_{ rhs.reset(), 0 } {}
 
-  inline void push(T* first, T* last) noexcept;
+  /**
+   * @brief Pushes a list of items (linked from first to last). The
+   *        memory order of the CAS (release by default) can be made
+   *        stronger, e.g., to order it with the following operations
+   *        on other atomics
+   **/
+  inline void push(T* first, T* last, mo_t = mo_t::release) noexcept;
   inline void push(T* const ptr) noexcept {
     push(ptr, ptr);
   }
 
   inline T* pop() noexcept;
 
+  /**
+   * @brief Returns the head of the stack without taking it off
+   * @note  Not thread safe (the items may only be walked while there
+   *        are no concurrent pops)
+   **/
+  T* peek() const noexcept {
+    return head_.ptr();
+  }
+
+  /**
+   * @brief Returns the head of the stack without taking it off, but,
+   *        unlike peek(), with an atomic read (acquire by default)
+   * @note  The item may be popped concurrently at any moment, so the
+   *        caller must make sure its memory stays accessible anyway
+   **/
+  T* top(const mo_t mo = mo_t::acquire) noexcept {
+    return head_t::load_ptr(head_, mo);
+  }
+
   /**
    * @brief Clears the stack and returns the old stack head
    **/
   T* reset() noexcept {
     const auto old_head = make_mem_ref<_ts>(head_).exchange({}, mo_t::acquire);
-    return old_head.ptr;
+    return old_head.ptr();
   }
 
 private:
-  struct alignas(16) head_t {
-    T* ptr;
-    size_t aba_counter;
-
-    bool operator==(const head_t&) const noexcept = default;
-  };
+  using head_t = tagged_ptr<T, _ts>;
   head_t head_;
 };
 
 template <stackable T, thread_safety_t _ts>
-void stack<T, _ts>::push(T* const first, T* const last) noexcept {
+void stack<T, _ts>::push(T* const first, T* const last,
+                         const mo_t mo) noexcept {
   // Since we don't really access the head pointer, relaxed reads are
   // perfectly fine here (and in case of CAS failure)
-  head_t old_head{
-    .ptr = make_mem_ref<_ts>(head_.ptr).load(mo_t::relaxed),
-    .aba_counter = make_mem_ref<_ts>(head_.aba_counter).load(mo_t::relaxed)
-  };
-
+  auto old_head = head_t::load(head_, mo_t::relaxed);
   head_t new_head;
-  new_head.ptr = first;
 
   const auto next_ref = make_mem_ref<_ts>(last->next);
   const auto head_ref = make_mem_ref<_ts>(head_);
   do {
-    next_ref.store(old_head.ptr, mo_t::relaxed);
-    new_head.aba_counter = old_head.aba_counter + 1;
+    next_ref.store(old_head.ptr(), mo_t::relaxed);
+    new_head = { first, old_head.tag() + 1 };
   }
   while (!head_ref.compare_exchange_weak(old_head, new_head,
-                                         mo_t::release,
-                                         mo_t::relaxed));
+                                         mo, mo_t::relaxed));
 }
 
 template <stackable T, thread_safety_t _ts>
 T* stack<T, _ts>::pop() noexcept {
   // We need to always acquire the head since we're planning to read
   // from the corresponding pointer
-  head_t old_head{
-    .ptr = make_mem_ref<_ts>(head_.ptr).load(mo_t::acquire),
-    .aba_counter = make_mem_ref<_ts>(head_.aba_counter).load(mo_t::relaxed)
-  };
+  auto old_head = head_t::load(head_, mo_t::acquire);
 
   head_t new_head;
   const auto head_ref = make_mem_ref<_ts>(head_);
   do {
-    if (!old_head.ptr) return nullptr;  // Empty stack
+    if (!old_head.ptr()) return nullptr;  // Empty stack
 
     new_head = {
-      .ptr = make_mem_ref<_ts>(old_head.ptr->next).load(mo_t::relaxed),
-      .aba_counter = old_head.aba_counter + 1
+      make_mem_ref<_ts>(old_head.ptr()->next).load(mo_t::relaxed),
+      old_head.tag() + 1
     };
   }
   while (!head_ref.compare_exchange_weak(old_head, new_head,
-                                         mo_t::relaxed,
-                 /* C++20 allows this: */mo_t::acquire));
+                                         mo_t::acquire, mo_t::acquire));
 
-  return old_head.ptr;
+  return old_head.ptr();
 }
 
 } // namespace memaw::__detail
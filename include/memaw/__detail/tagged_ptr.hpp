@@ -0,0 +1,128 @@
+#pragma once
+#include <bit>
+#include <cassert>
+#include <cstdint>
+
+#include "base.hpp"
+#include "mem_ref.hpp"
+
+/**
+ * @file
+ * A pointer paired with a tag that can be changed together with a
+ * single CAS, with or without DWCAS
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+/**
+ * @brief A pointer to T (aligned by _alignment) and an unsigned tag
+ *        (e.g., an ABA counter) that are loaded and compared
+ *        together. Unless packed, the two are separate words (and
+ *        the CAS requires DWCAS). The packed version keeps the tag in
+ *        the upper bits of the pointer that are unused by the
+ *        address space, together with the ones zeroed by the
+ *        alignment, so the tag only has tag_bits bits and wraps
+ *        around
+ * @note  The packed representation requires all the addresses to fit
+ *        into 48 bits (on 64-bit targets), which is true for the user
+ *        space of every mainstream system by default (but not, e.g.,
+ *        with 5-level paging enabled for the process or with the top
+ *        byte of pointers tagged). That is only checked by an
+ *        assertion, hence the mode is opt-in (see MEMAW_USE_DWCAS)
+ **/
+template <typename T, thread_safety_t _ts, size_t _alignment = alignof(T),
+          bool _packed = (_ts == thread_safe && !use_dwcas)>
+class tagged_ptr;
+
+template <typename T, thread_safety_t _ts, size_t _alignment>
+class alignas(16) tagged_ptr<T, _ts, _alignment, false> {
+public:
+  constexpr static bool is_packed = false;
+  constexpr static size_t max_tag = ~size_t(0);
+
+  constexpr tagged_ptr() noexcept = default;
+  constexpr tagged_ptr(T* const ptr, const size_t tag) noexcept:
+    ptr_(ptr), tag_(tag) {}
+
+  T* ptr() const noexcept {
+    return ptr_;
+  }
+
+  size_t tag() const noexcept {
+    return tag_;
+  }
+
+  /**
+   * @brief Loads the value with two separate reads: of the pointer
+   *        with the given memory order and of the tag with the
+   *        relaxed one. The result may thus be inconsistent, which is
+   *        fine for the CAS loops (that fix it on failure)
+   **/
+  static tagged_ptr load(tagged_ptr& ref, const mo_t mo) noexcept {
+    return {
+      make_mem_ref<_ts>(ref.ptr_).load(mo),
+      make_mem_ref<_ts>(ref.tag_).load(mo_t::relaxed)
+    };
+  }
+
+  static T* load_ptr(tagged_ptr& ref, const mo_t mo) noexcept {
+    return make_mem_ref<_ts>(ref.ptr_).load(mo);
+  }
+
+  bool operator==(const tagged_ptr&) const noexcept = default;
+
+private:
+  T* ptr_ = nullptr;
+  size_t tag_ = 0;
+};
+
+template <typename T, thread_safety_t _ts, size_t _alignment>
+class tagged_ptr<T, _ts, _alignment, true> {
+  constexpr static int align_bits = std::countr_zero(_alignment);
+  constexpr static int ptr_bits = (sizeof(void*) < 8 ? 32 : 48) - align_bits;
+
+  constexpr static uint64_t ptr_mask = (uint64_t(1) << ptr_bits) - 1;
+
+public:
+  static_assert(std::has_single_bit(_alignment));
+
+  constexpr static bool is_packed = true;
+  constexpr static size_t tag_bits = 64 - ptr_bits;
+  constexpr static size_t max_tag = size_t(~uint64_t(0) >> ptr_bits);
+
+  constexpr tagged_ptr() noexcept = default;
+  tagged_ptr(T* const ptr, const size_t tag) noexcept:
+    value_((uint64_t(uintptr_t(ptr)) >> align_bits)
+           | (uint64_t(tag) << ptr_bits)) {
+    assert((uint64_t(uintptr_t(ptr)) >> (ptr_bits + align_bits)) == 0);
+  }
+
+  T* ptr() const noexcept {
+    return reinterpret_cast<T*>(uintptr_t((value_ & ptr_mask)
+                                          << align_bits));
+  }
+
+  size_t tag() const noexcept {
+    return size_t(value_ >> ptr_bits);
+  }
+
+  static tagged_ptr load(tagged_ptr& ref, const mo_t mo) noexcept {
+    tagged_ptr result;
+    result.value_ = make_mem_ref<_ts>(ref.value_).load(mo);
+    return result;
+  }
+
+  static T* load_ptr(tagged_ptr& ref, const mo_t mo) noexcept {
+    return load(ref, mo).ptr();
+  }
+
+  bool operator==(const tagged_ptr&) const noexcept = default;
+
+private:
+  uint64_t value_ = 0;
+};
+
+} // namespace memaw::__detail
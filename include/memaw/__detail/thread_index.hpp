@@ -0,0 +1,37 @@
+#pragma once
+#include "base.hpp"
+#include "mem_ref.hpp"
+
+/**
+ * @file
+ * The helpers for spreading threads among several copies of data
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+/**
+ * @brief The alignment that puts the data written by different threads
+ *        onto different cache lines (64 bytes is the cache line size
+ *        on all our target platforms)
+ **/
+constexpr size_t cache_line_size = 64;
+
+/**
+ * @brief Returns the index of the calling thread. The threads are
+ *        assigned indices round-robin on their first call, with a
+ *        separate counter for every Tag (e.g., the type calling it),
+ *        so that the indices used by each type stay evenly spread
+ **/
+template <typename Tag>
+inline size_t get_thread_index() noexcept {
+  constinit static size_t last_index = 0;
+  static thread_local const size_t index =
+    make_mem_ref<thread_safe>(last_index).fetch_add(1, mo_t::relaxed);
+
+  return index;
+}
+
+} // namespace memaw::__detail
@@ -0,0 +1,174 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+#include "base.hpp"
+#include "mem_ref.hpp"
+
+/**
+ * @file
+ * A lock-free registry of per-thread records bound to a specific
+ * resource instance
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw::__detail {
+
+/**
+ * @brief A push-only lock-free list of records of type T, one per
+ *        thread using the registry. The record of the calling thread
+ *        is found with a single thread-local lookup in the common case
+ *        (including a thread alternating between several registries,
+ *        e.g., of different pool shards, as long as their ids don't
+ *        collide in the thread-local cache)
+ * @note  Records are never removed until clear() is called, but the
+ *        record of an exited thread is adopted by the next thread that
+ *        gets the same id (which is safe since ids are only unique
+ *        among running threads anyway)
+ **/
+template <typename T>
+class thread_registry {
+public:
+  struct record_t {
+    record_t* next;
+    std::thread::id owner;
+    T data;
+  };
+
+  thread_registry() noexcept: id_(get_next_id()) {}
+
+  thread_registry(const thread_registry&) = delete;
+  thread_registry& operator=(const thread_registry&) = delete;
+  thread_registry& operator=(thread_registry&&) = delete;
+
+  /**
+   * @brief Takes over the records of rhs. The thread-local lookups
+   *        stay valid for the new instance, while rhs gets a new id
+   **/
+  thread_registry(thread_registry&& rhs) noexcept:
+    head_(rhs.head_), id_(rhs.id_) {
+    rhs.head_ = nullptr;
+    rhs.id_ = get_next_id();
+  }
+
+  /**
+   * @brief Returns the record of the calling thread or nullptr if it
+   *        has not been created yet
+   **/
+  inline T* find() noexcept;
+
+  /**
+   * @brief Returns the record of the calling thread, creating it in
+   *        the memory returned by alloc(sizeof(record_t)) if necessary
+   * @return nullptr if there was no record and alloc() failed
+   **/
+  template <typename F>
+  inline T* get(F&& alloc) noexcept;
+
+  /**
+   * @brief Calls f(data) for every record in the registry
+   * @note  Not thread safe
+   **/
+  template <typename F>
+  void for_each(F&& f) noexcept {
+    for (auto rec = head_; rec; rec = rec->next) f(rec->data);
+  }
+
+  /**
+   * @brief Destroys all the records, calling release(ptr) with the
+   *        memory every one of them occupied
+   * @note  Not thread safe
+   **/
+  template <typename F>
+  inline void clear(F&& release) noexcept;
+
+private:
+  static uint64_t get_next_id() noexcept {
+    return last_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  struct cache_entry_t {
+    uint64_t registry_id;
+    T* data;
+  };
+
+  // A small direct-mapped cache: the ids of the registries are
+  // sequential, so the ones created together get different entries
+  constexpr static size_t cache_size = 8;
+
+  cache_entry_t& get_cache_entry() const noexcept {
+    return cache_[id_ % cache_size];
+  }
+
+  // Every registry id is unique (for the same T), so the cache can
+  // never point to a record of a destroyed or moved-from instance
+  inline static thread_local cache_entry_t cache_[cache_size] = {};
+  inline static std::atomic<uint64_t> last_id_ = 0;
+
+  record_t* head_ = nullptr;
+  uint64_t id_;
+};
+
+template <typename T>
+T* thread_registry<T>::find() noexcept {
+  auto& entry = get_cache_entry();
+  if (entry.registry_id == id_) [[likely]] return entry.data;
+
+  // Slow path: look for (or adopt) the record with our id
+  const auto me = std::this_thread::get_id();
+  for (auto rec = make_mem_ref<thread_safe>(head_).load(mo_t::acquire);
+       rec; rec = rec->next) {
+    if (rec->owner == me) {
+      entry = { .registry_id = id_, .data = &rec->data };
+      return &rec->data;
+    }
+  }
+
+  return nullptr;
+}
+
+template <typename T>
+template <typename F>
+T* thread_registry<T>::get(F&& alloc) noexcept {
+  if (const auto result = find()) [[likely]] return result;
+
+  const auto memory = alloc(sizeof(record_t));
+  if (!memory) [[unlikely]] return nullptr;
+
+  const auto rec = new (memory) record_t{
+    .next = nullptr,
+    .owner = std::this_thread::get_id(),
+    .data = {}
+  };
+
+  // Records are never popped, so no ABA problem here. Release to
+  // publish the record initialization
+  const auto head_ref = make_mem_ref<thread_safe>(head_);
+  rec->next = head_ref.load(mo_t::relaxed);
+  while (!head_ref.compare_exchange_weak(rec->next, rec,
+                                         mo_t::release, mo_t::relaxed));
+
+  get_cache_entry() = { .registry_id = id_, .data = &rec->data };
+  return &rec->data;
+}
+
+template <typename T>
+template <typename F>
+void thread_registry<T>::clear(F&& release) noexcept {
+  auto rec = head_;
+  head_ = nullptr;
+  id_ = get_next_id();  // Invalidates all the thread-local caches
+
+  while (rec) {
+    const auto next = rec->next;
+    rec->~record_t();
+    release(static_cast<void*>(rec));
+    rec = next;
+  }
+}
+
+} // namespace memaw::__detail
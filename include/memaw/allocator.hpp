@@ -0,0 +1,173 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "concepts.hpp"
+#include "resource_traits.hpp"
+
+/**
+ * @file
+ * A standard allocator on top of a resource
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+namespace __detail {
+
+/**
+ * @brief A resource that needs not be stored in an allocator since
+ *        any (default-constructed) instance of it is as good as any
+ *        other
+ **/
+template <typename R>
+concept stateless_resource = std::is_empty_v<R>
+  && std::default_initializable<R> && interchangeable_resource_with<R, R>;
+
+template <typename R>
+struct allocator_storage {
+  R& get() const noexcept {
+    return *resource;
+  }
+
+  R* resource;
+};
+
+template <stateless_resource R>
+struct allocator_storage<R> {
+  static R get() noexcept {
+    return {};
+  }
+};
+
+} // namespace __detail
+
+/**
+ * @brief An allocator satisfying the standard Allocator requirements
+ *        that allocates memory for objects of type T from a resource
+ *        of type R, throwing std::bad_alloc on failures
+ *
+ * If R is an empty default-constructible resource with all the
+ * instances interchangeable (e.g., pages_resource), the allocator is
+ * stateless (and always equal). Otherwise it stores a pointer to the
+ * resource, which must outlive all the allocator copies.
+ *
+ * The sizes are ceiled with resource_traits<R>::ceil_allocation_size()
+ * and allocate_at_least() (available since C++23) returns the number
+ * of objects that fit into the whole ceiled region, so e.g., the
+ * containers can make use of all of the granule of a granular
+ * resource. The alignment passed to the resource is always alignof(T)
+ **/
+template <typename T, resource R>
+class allocator {
+public:
+  using value_type = T;
+  using resource_t = R;
+
+  /**
+   * @brief Specifies if the allocator doesn't store a reference to
+   *        the resource (see above)
+   **/
+  constexpr static bool is_stateless = __detail::stateless_resource<R>;
+
+  using is_always_equal = std::bool_constant<is_stateless>;
+
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  constexpr allocator() noexcept requires(is_stateless) = default;
+
+  constexpr allocator(resource_t& resource) noexcept
+    requires(!is_stateless): storage_{&resource} {}
+
+  template <typename U>
+  constexpr allocator(const allocator<U, R>& rhs) noexcept:
+    storage_(rhs.storage_) {}
+
+  /**
+   * @brief Returns the resource the allocator is using (or a new
+   *        instance of it if the allocator is stateless)
+   **/
+  constexpr decltype(auto) resource() const noexcept {
+    return storage_.get();
+  }
+
+  /**
+   * @brief Returns the maximum number of objects that can
+   *        theoretically be allocated at once
+   **/
+  constexpr size_t max_size() const noexcept {
+    return std::numeric_limits<size_t>::max() / sizeof(T);
+  }
+
+  /**
+   * @brief Allocates memory for n objects of type T
+   * @throws std::bad_array_new_length if n > max_size() or
+   *         std::bad_alloc if the resource fails to allocate
+   **/
+  [[nodiscard]] T* allocate(const size_t n) {
+    return static_cast<T*>(allocate_bytes(n));
+  }
+
+#ifdef __cpp_lib_allocate_at_least
+  /**
+   * @brief Allocates memory for at least n objects of type T,
+   *        returning the actual number (that corresponds to the ceiled
+   *        allocation size)
+   **/
+  [[nodiscard]] std::allocation_result<T*> allocate_at_least(const size_t n) {
+    return { static_cast<T*>(allocate_bytes(n)), get_size(n) / sizeof(T) };
+  }
+#endif
+
+  /**
+   * @brief Deallocates memory allocated for n objects (where n is
+   *        either the number requested for allocate() or
+   *        allocate_at_least(), or the count returned by the latter)
+   **/
+  void deallocate(T* const ptr, const size_t n)
+    noexcept(__detail::has_nothrow_deallocate<R>) {
+    storage_.get().deallocate(ptr, get_size(n), alignof(T));
+  }
+
+  /**
+   * @brief Checks if the allocators can deallocate the memory
+   *        allocated by each other, i.e., if the resources are
+   *        interchangeable or the instances are equal
+   **/
+  template <typename U>
+  constexpr bool operator==(const allocator<U, R>& rhs) const
+    noexcept(__detail::nothrow_equality_comparable<R>) {
+    if constexpr (interchangeable_resource_with<R, R>) return true;
+    else return storage_.resource == rhs.storage_.resource
+           || *storage_.resource == *rhs.storage_.resource;
+  }
+
+private:
+  template <typename, memaw::resource> friend class allocator;
+
+  constexpr static size_t get_size(const size_t n) noexcept {
+    return resource_traits<R>::ceil_allocation_size(n * sizeof(T));
+  }
+
+  void* allocate_bytes(const size_t n) const {
+#ifdef __cpp_exceptions
+    if (n > max_size()) [[unlikely]] throw std::bad_array_new_length{};
+#endif
+
+    decltype(auto) res = storage_.get();
+    return memaw::allocate<exceptions_policy::throw_bad_alloc>
+      (res, get_size(n), alignof(T));
+  }
+
+  [[no_unique_address]] __detail::allocator_storage<R> storage_;
+};
+
+} // namespace memaw
@@ -0,0 +1,228 @@
+#pragma once
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "resource_traits.hpp"
+
+#include "__detail/adaptor_base.hpp"
+#include "__detail/base.hpp"
+#include "__detail/mem_ref.hpp"
+
+/**
+ * @file
+ * A resource adaptor that stops calling the underlying resource for a
+ * while after it has failed to allocate
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Configuration parameters for backoff_resource with valid
+ *        defaults
+ **/
+struct backoff_resource_config {
+  /**
+   * @brief The number of allocate() calls (of the same size class) to
+   *        fail right away after an upstream allocation failure. Zero
+   *        means there is no limit by the number of calls
+   **/
+  const size_t skip_calls = 64;
+
+  /**
+   * @brief The time (in microseconds) to fail the allocate() calls (of
+   *        the same size class) right away after an upstream
+   *        allocation failure. Zero means there is no time limit
+   * @note  If both limits are set, the upstream is probed again as
+   *        soon as either of them is reached
+   **/
+  const uint64_t skip_microseconds = 0;
+};
+
+/**
+ * @brief Memory resource adaptor that remembers allocation failures of
+ *        the underlying resource and, for the configured number of
+ *        calls or amount of time, fails allocations of the same size
+ *        class (i.e., with the same ceiled power of 2 of the size)
+ *        without calling it. Then the upstream is probed again
+ *
+ * Intended for the links of chain_resource that are expected to fail
+ * for extended periods of time (e.g., big_pages_resource once the
+ * system pool of big pages is exhausted), so that every allocation
+ * from the chain doesn't pay for a failing upstream call:
+ *
+ *   chain_resource<backoff_resource<big_pages_resource>,
+ *                  regular_pages_resource>
+ *
+ * The adaptor is interchangeable with (and substitutable for) all the
+ * resources the upstream is, so the deallocation dispatch of the
+ * chain is not affected. The failures are tracked with relaxed
+ * atomics (if the upstream is thread safe), so a few extra calls may
+ * reach (or skip) the upstream under contention
+ **/
+template <resource R, backoff_resource_config _config = {}>
+class backoff_resource: public __detail::adaptor_base<R> {
+  using base_t = __detail::adaptor_base<R>;
+
+public:
+  static_assert(_config.skip_calls > 0 || _config.skip_microseconds > 0);
+
+  using typename base_t::upstream_t;
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const backoff_resource_config& config = _config;
+
+  constexpr backoff_resource()
+    noexcept(std::is_nothrow_default_constructible_v<upstream_t>)
+    requires(std::default_initializable<upstream_t>) {}
+
+  constexpr backoff_resource(upstream_t&& upstream)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    base_t(std::move(upstream)) {}
+
+  backoff_resource(const backoff_resource&) = delete;
+  backoff_resource& operator=(const backoff_resource&) = delete;
+  backoff_resource& operator=(backoff_resource&&) = delete;
+
+  /**
+   * @brief Move constructs the resource (with the upstream moved and
+   *        the failures history copied)
+   * @note  The operation is not thread safe
+   **/
+  constexpr backoff_resource(backoff_resource&& rhs)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>) = default;
+
+  /**
+   * @brief Forwards the call to the upstream allocate() unless its
+   *        previous call for the same size class has failed recently
+   *        (in which case returns nullptr right away). If the upstream
+   *        throws, that is also remembered as a failure
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size, const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_allocate<upstream_t>) {
+    auto& slot = slots_[get_size_class(size)];
+    if (should_skip(slot)) return nullptr;
+
+    void* result;
+#ifdef __cpp_exceptions
+    if constexpr (!__detail::has_nothrow_allocate<upstream_t>) {
+      try {
+        result = upstream_.allocate(size, alignment);
+      } catch (...) {
+        on_failure(slot);
+        throw;
+      }
+    }
+    else
+#endif
+      result = upstream_.allocate(size, alignment);
+
+    if (!result) [[unlikely]] on_failure(slot);
+    else on_success(slot);
+    return result;
+  }
+
+  /**
+   * @brief Forwards the call to the upstream deallocate()
+   **/
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_deallocate<upstream_t>) {
+    upstream_.deallocate(ptr, size, alignment);
+  }
+
+private:
+  using base_t::upstream_;
+
+  constexpr static auto thread_safety =
+    base_t::is_thread_safe ? __detail::thread_safe : __detail::thread_unsafe;
+
+  constexpr static bool has_calls_limit = _config.skip_calls > 0;
+  constexpr static bool has_time_limit = _config.skip_microseconds > 0;
+
+  struct slot_t {
+    size_t calls_left = 0;  // Number of calls to skip
+    uint64_t deadline = 0;  // Time to skip until (0 if none)
+  };
+
+  constexpr static size_t size_classes_count =
+    std::numeric_limits<size_t>::digits + 1;
+
+  static size_t get_size_class(const size_t size) noexcept {
+    return size ? std::bit_width(size - 1) : 0;
+  }
+
+  static uint64_t now() noexcept {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now()
+                                       .time_since_epoch()).count();
+  }
+
+  static bool should_skip(slot_t& slot) noexcept {
+    if constexpr (has_calls_limit) {
+      const auto calls_ref = __detail::make_mem_ref<thread_safety>
+        (slot.calls_left);
+
+      auto calls_left = calls_ref.load(__detail::mo_t::relaxed);
+      do {
+        if (!calls_left) [[likely]] return false;
+      } while (!calls_ref.compare_exchange_weak(calls_left, calls_left - 1,
+                                                __detail::mo_t::relaxed,
+                                                __detail::mo_t::relaxed));
+    }
+
+    if constexpr (has_time_limit) {
+      const auto deadline = __detail::make_mem_ref<thread_safety>
+        (slot.deadline).load(__detail::mo_t::relaxed);
+
+      // NB: don't query the clock unless there has been a failure
+      if (!deadline || deadline <= now()) return false;
+    }
+
+    return true;
+  }
+
+  static void on_failure(slot_t& slot) noexcept {
+    if constexpr (has_calls_limit)
+      __detail::make_mem_ref<thread_safety>(slot.calls_left)
+        .store(_config.skip_calls, __detail::mo_t::relaxed);
+
+    if constexpr (has_time_limit)
+      __detail::make_mem_ref<thread_safety>(slot.deadline)
+        .store(now() + _config.skip_microseconds, __detail::mo_t::relaxed);
+  }
+
+  static void on_success(slot_t& slot) noexcept {
+    // Reset both limits (only writing if needed to keep the cache line
+    // shared). NB: the calls counter is not zero here if the deadline
+    // has expired first
+    if constexpr (has_calls_limit && has_time_limit) {
+      const auto calls_ref =
+        __detail::make_mem_ref<thread_safety>(slot.calls_left);
+      if (calls_ref.load(__detail::mo_t::relaxed)) [[unlikely]]
+        calls_ref.store(0, __detail::mo_t::relaxed);
+    }
+
+    if constexpr (has_time_limit) {
+      const auto deadline_ref =
+        __detail::make_mem_ref<thread_safety>(slot.deadline);
+      if (deadline_ref.load(__detail::mo_t::relaxed)) [[unlikely]]
+        deadline_ref.store(0, __detail::mo_t::relaxed);
+    }
+  }
+
+  slot_t slots_[size_classes_count] = {};
+};
+
+} // namespace memaw
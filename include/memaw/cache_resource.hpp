@@ -20,6 +20,34 @@
 
 namespace memaw {
 
+/**
+ * @brief The ways cache_resource can allocate the next upstream block
+ *        ahead of time (see cache_resource_config::refill_watermark)
+ **/
+enum class refill_mode {
+  /**
+   * @brief The thread whose allocation has crossed the watermark
+   *        allocates the next block right after that
+   **/
+  caller,
+
+  /**
+   * @brief A helper thread owned by the cache (started on the first
+   *        refill and joined in the destructor) allocates the next
+   *        block. Requires a thread safe cache and a thread safe
+   *        upstream (which the helper thread calls concurrently with
+   *        the others)
+   **/
+  background,
+
+  /**
+   * @brief The cache never refills by itself: refill() is expected to
+   *        be called by the user (e.g., from an executor of their
+   *        own, once needs_refill() returns true)
+   **/
+  manual
+};
+
 /**
  * @brief Configuration parameters for cache_resource with valid
  *        defaults
@@ -72,39 +100,123 @@ struct cache_resource_config {
   /**
    * @brief Thread safety policy: if set to true, the implementation
    *        will use atomic instructions to manage its internal
-   *        structures (requires DWCAS). The thread safe
+   *        structures (DWCAS, or packed tagged pointers if
+   *        MEMAW_USE_DWCAS is defined as 0). The thread safe
    *        implementation is lock-free
    * @note  If the upstream resource is not thread safe, setting this
    *        parameter to true will change the type of instructions
    *        used but won't make the cache thread safe either
+   * @note  With packed tagged pointers (MEMAW_USE_DWCAS defined as
+   *        0), the size of the current block is kept in granules in
+   *        the spare bits of its pointer: the upstream allocations are
+   *        then ceiled to multiples of granularity, and only the first
+   *        2^(16 + log2(granularity)) granules of a block are ever
+   *        taken as the current one, while the rest of it is just
+   *        marked free
    **/
   const bool thread_safe = true;
+
+  /**
+   * @brief The maximum size of a deallocated chunk that can be reused
+   *        by subsequent allocations. If non-zero (must be a multiple
+   *        of granularity), freed chunks are kept in size-segregated
+   *        lock-free lists, one for every multiple of granularity up
+   *        to this value, and allocate() first looks for a chunk of
+   *        the exact requested size there. Bigger chunks are still
+   *        only released in the destructor
+   * @note  The lists are kept inside the resource object, so its size
+   *        grows by 16 bytes per max_reused_size / granularity
+   **/
+  const size_t max_reused_size = 0;
+
+  /**
+   * @brief The size of the per-thread arenas (must be a multiple of
+   *        granularity). If non-zero (and thread_safe is true), every
+   *        thread claims a sub-range of this size from the current
+   *        block with a single atomic operation and then services
+   *        its allocations from it without any atomics. Allocations
+   *        that (with the possible alignment padding) are bigger than
+   *        a half of the arena are made from the shared block directly
+   * @note  When the arena runs out, its remainder is freed (as the
+   *        remainder of an old block would be). Every thread also
+   *        takes one granularity-aligned chunk from the cache for the
+   *        arena bookkeeping
+   **/
+  const size_t thread_arena_size = 0;
+
+  /**
+   * @brief If set to true, the cache keeps track of its upstream
+   *        blocks (in a header occupying the first granule of each),
+   *        so that all the allocations can be dropped at once with
+   *        reset() or rewind() and the blocks reused by the following
+   *        ones without calling the upstream. Can't be used together
+   *        with thread_arena_size
+   * @note  Then deallocate() only passes the chunks to the reuse
+   *        lists (if configured), everything else is reclaimed by
+   *        reset(), rewind() or the destructor
+   **/
+  const bool resettable = false;
+
+  /**
+   * @brief If non-zero, the next upstream block is allocated ahead of
+   *        time (see refill) once an allocation leaves less than this
+   *        many bytes in the current block. That block is kept aside
+   *        and becomes the current one when the latter runs out, so
+   *        the allocations at the block boundary don't wait for the
+   *        upstream. Can't be used together with resettable
+   * @note  Only one refill is in flight (or kept aside) at a time. If
+   *        the upstream fails, the next refill is only attempted once
+   *        a new block becomes the current one
+   **/
+  const size_t refill_watermark = 0;
+
+  /**
+   * @brief The way the refills ahead of time are made (ignored if
+   *        refill_watermark is 0)
+   **/
+  const refill_mode refill = refill_mode::caller;
 };
 
 /**
  * @brief Memory resource that allocates big blocks from an upstream
  *        resource and uses those blocks for (smaller) allocation
  *        requests. Memory is not freed until the resource is
- *        destructed (as in std::pmr::monotonic_buffer_resource)
+ *        destructed (as in std::pmr::monotonic_buffer_resource),
+ *        although small chunks can optionally be reused (see
+ *        cache_resource_config::max_reused_size) and a resettable
+ *        cache can drop all its allocations at once (see
+ *        cache_resource_config::resettable)
  **/
 template <sweeping_resource R,
           cache_resource_config _config = cache_resource_config{
             .thread_safe = thread_safe_resource<R>
           }>
 class cache_resource {
+  using impl_t = __detail::cache_resource_impl<R, _config>;
+
 public:
   /**
    * @brief The minimum value for the granularity parameter. Normally
    *        equals 32 bytes. Always >= alignof(std::max_align_t).
    **/
-  constexpr static pow2_t min_granularity =
-    __detail::cache_resource_impl<R, _config>::min_granularity;
+  constexpr static pow2_t min_granularity = impl_t::min_granularity;
 
   static_assert(_config.granularity >= min_granularity);
   static_assert(_config.min_block_size >= _config.granularity);
   static_assert(_config.max_block_size >= _config.min_block_size);
   static_assert(_config.max_block_size == _config.min_block_size
                 || _config.block_size_multiplier > 1);
+  static_assert(_config.max_reused_size % _config.granularity == 0);
+  static_assert(_config.thread_arena_size % _config.granularity == 0);
+  static_assert(!_config.resettable || _config.thread_arena_size == 0,
+                "Thread arenas are not supported by the resettable cache");
+  static_assert(!_config.resettable || _config.refill_watermark == 0,
+                "Refills are not supported by the resettable cache");
+  static_assert(_config.refill_watermark == 0
+                || _config.refill != refill_mode::background
+                || (_config.thread_safe && thread_safe_resource<R>),
+                "Background refills require a thread safe cache "
+                "over a thread safe upstream");
 
   /**
    * @brief The underlying resource to cache (a template parameter)
@@ -183,16 +295,134 @@ public:
   /**
    * @brief Deallocates previously allocated memory. The deallocate()
    *        call on the upstream resource happens only on destruction
+   *        (or reset() of a resettable cache)
    **/
   void deallocate(void* const ptr, const size_t size,
                   const size_t alignment = alignof(std::max_align_t)) noexcept {
     impl_.deallocate(ptr, size, pow2_t{alignment, pow2_t::exact});
   }
 
+  /**
+   * @brief Tries to grow or shrink a previously allocated region in
+   *        place. Growing is only possible for the most recent
+   *        allocation from the current block (or the calling thread's
+   *        arena), if there's enough space left in it. Shrinking
+   *        always succeeds (giving the tail back to the block or just
+   *        freeing it)
+   * @param new_size must be a multiple of the configured granularity
+   * @return true if the region has been resized, after which it must
+   *         be deallocated with new_size
+   **/
+  bool expand(void* const ptr, const size_t old_size,
+              const size_t new_size) noexcept {
+    return impl_.expand(ptr, old_size, new_size);
+  }
+
+  /**
+   * @brief Allocates count regions of the same size and alignment,
+   *        writing the pointers to out. Reusable chunks of the size are
+   *        popped off their list (only as many as needed) and, if the
+   *        alignment is not greater than the granularity, the rest
+   *        is allocated as one region of count * size bytes (i.e.,
+   *        with one move of the head), otherwise one by one
+   * @return the number of allocated regions (less than count only on
+   *         failure)
+   **/
+  size_t allocate_batch(const size_t count, const size_t size,
+                        const size_t alignment, void** const out) noexcept {
+    return impl_.allocate_batch(count, size,
+                                pow2_t{alignment, pow2_t::ceil}, out);
+  }
+
+  /**
+   * @brief Deallocates count regions of the same size and alignment
+   *        (skipping null pointers), linking them together to be put
+   *        to the corresponding free list with a single CAS
+   **/
+  void deallocate_batch(const size_t count, const size_t size,
+                        const size_t alignment,
+                        void* const* const ptrs) noexcept {
+    impl_.deallocate_batch(count, size, pow2_t{alignment, pow2_t::exact},
+                           ptrs);
+  }
+
+  /**
+   * @brief Returns true if the current block has less than
+   *        config.refill_watermark bytes left and no next block is
+   *        allocated ahead of time (or being allocated) yet
+   **/
+  bool needs_refill() const noexcept
+    requires(_config.refill_watermark > 0) {
+    return impl_.needs_refill();
+  }
+
+  /**
+   * @brief Allocates the next upstream block ahead of time to be taken
+   *        when the current one runs out, unless such block is already
+   *        allocated or being allocated by another thread. Can be
+   *        called regardless of the watermark, e.g., to warm the cache
+   *        up, and with any refill_mode (but is the only way to refill
+   *        with refill_mode::manual)
+   * @return true if this call has allocated the block
+   **/
+  bool refill() noexcept requires(_config.refill_watermark > 0) {
+    return impl_.refill();
+  }
+
+  /**
+   * @brief An opaque position of a resettable cache to rewind to
+   **/
+  using marker_t = typename impl_t::marker_t;
+
+  /**
+   * @brief Returns the current position of the resettable cache to
+   *        be passed to rewind() later
+   * @note  Not thread safe: must only be called at quiescent points,
+   *        i.e., with no other calls on the resource in progress
+   **/
+  marker_t marker() const noexcept requires(_config.resettable) {
+    return impl_.get_marker();
+  }
+
+  /**
+   * @brief Frees everything allocated since the marker was taken (in
+   *        the LIFO order of the markers), keeping the upstream
+   *        blocks allocated since then for reuse. Also empties the
+   *        lists of reusable chunks
+   * @note  Not thread safe (see marker()). The marker must not be
+   *        older than the last reset() or than a marker that has
+   *        already been rewound to
+   **/
+  void rewind(const marker_t& marker) noexcept
+    requires(_config.resettable) {
+    impl_.rewind(marker);
+  }
+
+  /**
+   * @brief Frees everything allocated from the cache, returning all
+   *        the upstream blocks (the most recent first) but the ones
+   *        that fit into max_retained_size bytes in total, which are
+   *        kept for reuse by the following allocations
+   * @note  Not thread safe (see marker())
+   **/
+  void reset(const size_t max_retained_size = ~size_t(0)) noexcept
+    requires(_config.resettable) {
+    impl_.reset(max_retained_size);
+  }
+
+  /**
+   * @brief Returns the underlying resource (e.g., to get the
+   *        statistics of the upstream allocations if it is a
+   *        stats_resource)
+   **/
+  const upstream_t& upstream() const noexcept {
+    return impl_.get_upstream();
+  }
+
   bool operator==(const cache_resource&) const noexcept = default;
 
 private:
-  __detail::cache_resource_impl<R, _config> impl_;
+  impl_t impl_;
 };
 
 /**
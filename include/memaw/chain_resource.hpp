@@ -32,7 +32,12 @@ namespace memaw {
  * exists, the default deallocate() method will be unavailable (thus,
  * the chain won't model the resource concept) and one should use the
  * deallocate_with() method (that takes an additional index argument)
- * instead
+ * instead.
+ *
+ * Every allocate() call tries the resources starting from the first
+ * one. A resource that is expected to keep failing for a while (e.g.,
+ * big_pages_resource on an exhausted system pool) can be wrapped into
+ * backoff_resource to skip the failing calls
  **/
 template <resource... Rs> requires(sizeof...(Rs) > 0)
 class chain_resource {
@@ -165,6 +165,48 @@ constexpr bool enable_thread_safe_resource = requires {
 template <typename R>
 concept thread_safe_resource = resource<R> && enable_thread_safe_resource<R>;
 
+/**
+ * @brief The concept of a resource that can give the physical memory
+ *        behind an allocated region back to the system without
+ *        deallocating the region. Such resources must define a
+ *        noexcept method purge(ptr, size)
+ *
+ * The semantic requirements are: if [ptr, ptr + size) is (a part of)
+ * a region returned from an allocate() call that has not been
+ * deallocated yet, with both ptr and size being multiples of
+ * R::min_size() (if R is bound), then after the call r.purge(ptr,
+ * size) the range stays accessible, but its contents become
+ * unspecified. The region must still be deallocated as usual.
+ **/
+template <typename R>
+concept purging_resource = resource<R>
+  && requires(R res, void* ptr, size_t size) {
+  { res.purge(ptr, size) } noexcept;
+};
+
+/**
+ * @brief The concept of a resource that can try to grow or shrink an
+ *        allocated region in place. Such resources must define a
+ *        noexcept method expand(ptr, old_size, new_size) returning
+ *        bool
+ *
+ * The semantic requirements are: if ptr has been returned from an
+ * allocate() call with the size old_size (or from a successful
+ * expand() call with the new_size equal to old_size) and has not been
+ * deallocated yet, and new_size is a valid allocation size for R
+ * (see resource_traits::ceil_allocation_size()), then r.expand(ptr,
+ * old_size, new_size) either returns false leaving the region intact
+ * or returns true, after which the region [ptr, ptr + new_size) is
+ * allocated instead (with the contents of the first min(old_size,
+ * new_size) bytes preserved) and must be deallocated with the size
+ * new_size.
+ **/
+template <typename R>
+concept expanding_resource = resource<R>
+  && requires(R res, void* ptr, size_t old_size, size_t new_size) {
+  { res.expand(ptr, old_size, new_size) } noexcept -> std::same_as<bool>;
+};
+
 /**
  * @brief The concept of a resource whose allocation, deallocation and
  *        equality testing methods don't throw exceptions. Such
@@ -0,0 +1,270 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "os_resource.hpp"
+
+#include "__detail/mapped_resource_impl.hpp"
+
+/**
+ * @file
+ * Resources that allocate memory from a mapped file or an anonymous
+ * shared memory object, which can be shared between processes or
+ * persisted
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Configuration parameters for mapped_file_resource and
+ *        shared_memory_resource with valid defaults
+ **/
+struct mapped_resource_config {
+  /**
+   * @brief Thread safety policy: if set to true, the implementation
+   *        will use atomic instructions to advance the (lock-free)
+   *        allocation offset
+   **/
+  const bool thread_safe = true;
+};
+
+namespace __detail {
+
+/**
+ * @brief The common part of mapped_file_resource and
+ *        shared_memory_resource: everything but the constructors
+ *        (creating or opening the mapped object) and flush()
+ **/
+template <page_type auto _type, mapped_resource_config _config>
+class mapped_resource_base {
+protected:
+  using impl_t = mapped_resource_impl<_type, _config.thread_safe
+                                             ? thread_safe : thread_unsafe>;
+
+public:
+  using page_type_t = std::remove_const_t<decltype(_type)>;
+
+  /**
+   * @brief The handle of the mapped object. A file descriptor on
+   *        Unix-like systems and a file mapping handle on Windows
+   **/
+  using native_handle_t = typename impl_t::native_handle_t;
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const mapped_resource_config& config = _config;
+
+  constexpr static bool is_granular = true;
+  constexpr static bool is_sweeping = true;
+  constexpr static bool is_thread_safe = _config.thread_safe;
+
+  /**
+   * @brief Returns the size of a minimum allocation (the size of a
+   *        page of the type, as returned by os_resource::min_size()):
+   *        any allocation can only request a size that is a multiple
+   *        of this value
+   **/
+  static pow2_t min_size() noexcept {
+    return impl_t::min_size();
+  }
+
+  /**
+   * @brief Returns the minimal alignment of any allocated address
+   *        (see os_resource::guaranteed_alignment())
+   **/
+  static pow2_t guaranteed_alignment() noexcept {
+    return impl_t::guaranteed_alignment();
+  }
+
+  mapped_resource_base(const mapped_resource_base&) = delete;
+  mapped_resource_base& operator=(const mapped_resource_base&) = delete;
+  mapped_resource_base& operator=(mapped_resource_base&&) = delete;
+
+  /**
+   * @brief Move constructs the resource leaving rhs with no mapping
+   * @note  The operation is not thread safe even if the resources are
+   *        configured as such
+   **/
+  mapped_resource_base(mapped_resource_base&&) noexcept = default;
+
+  /**
+   * @brief Returns the handle of the mapped object (invalid if the
+   *        mapping has failed), which remains owned by the resource
+   **/
+  native_handle_t native_handle() const noexcept {
+    return impl_.native_handle();
+  }
+
+  /**
+   * @brief Returns the beginning of the mapping (nullptr if the
+   *        mapping has failed)
+   **/
+  void* range_begin() const noexcept {
+    return impl_.range_begin();
+  }
+
+  /**
+   * @brief Returns the size of the mapping (0 if the mapping has
+   *        failed)
+   **/
+  size_t mapped_size() const noexcept {
+    return impl_.mapped_size();
+  }
+
+  /**
+   * @brief Returns the size of the beginning part of the mapping that
+   *        has already been given out by allocate() calls (including
+   *        the used_size passed to the constructor)
+   **/
+  size_t used_size() const noexcept {
+    return impl_.used_size();
+  }
+
+  /**
+   * @brief Allocates the next region of the mapped object
+   * @param size must be a multiple of min_size(), otherwise the
+   *        allocation will fail
+   * @param alignment must be a power of 2. If it is greater than
+   *        guaranteed_alignment(), the addresses before the result
+   *        are skipped
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size,
+     const size_t alignment = alignof(std::max_align_t)) noexcept {
+    return impl_.allocate(size, alignment);
+  }
+
+  /**
+   * @brief Does nothing: the region stays mapped (with its contents
+   *        preserved in the object) until the destruction, and its
+   *        addresses are not reused
+   **/
+  void deallocate(void*, size_t, size_t = 1) noexcept {}
+
+  /**
+   * @brief Every instance has its own mapping, so different instances
+   *        are never equal
+   **/
+  bool operator==(const mapped_resource_base& rhs) const noexcept {
+    return this == &rhs;
+  }
+
+protected:
+  mapped_resource_base(impl_t&& impl) noexcept: impl_(std::move(impl)) {}
+
+  impl_t impl_;
+};
+
+} // namespace __detail
+
+/**
+ * @brief Memory resource that maps a file (as shared memory) once on
+ *        construction and then allocates from it sequentially. The
+ *        regions are never unmapped or reused before the destruction,
+ *        and their contents are written back to the file, so the
+ *        memory can be seen by other processes that map the same
+ *        file or by the next instance on the restart (see used_size
+ *        in the constructor). The destructor unmaps the file (the
+ *        modified pages are still written back by the OS eventually,
+ *        see flush()) and closes it
+ *
+ * The page type must match the file system the file is on: e.g., a
+ * file on a hugetlbfs mount (on Linux) must be mapped with big pages
+ * of the size of the mount. With page_types::transparent, the mapping
+ * is aligned and marked for transparent big pages (which only works
+ * for some file systems, like tmpfs).
+ *
+ * @note  Subsequent allocations are adjacent (unless padded for
+ *        alignment), which makes the resource a good upstream for
+ *        cache_resource
+ **/
+template <page_type auto _type = page_types::regular,
+          mapped_resource_config _config = {}>
+class mapped_file_resource:
+    public __detail::mapped_resource_base<_type, _config> {
+  using base_t = __detail::mapped_resource_base<_type, _config>;
+  using typename base_t::impl_t;
+
+public:
+  /**
+   * @brief Opens the file at the path (creating it if necessary) and
+   *        maps its first size bytes (ceiled to min_size()),
+   *        extending the file if it is shorter. If size is 0, the
+   *        current size of the file (floored to min_size()) is used.
+   *        If that fails, all allocations will fail as well (see
+   *        range_begin())
+   * @param used_size the size of the beginning of the file that is
+   *        already in use (e.g., by a previous instance), allocations
+   *        start after it
+   **/
+  explicit mapped_file_resource(const char* const path, const size_t size = 0,
+                                const size_t used_size = 0) noexcept:
+    base_t(impl_t::from_file(path, size, used_size)) {}
+
+  /**
+   * @brief Writes the modified pages of the mapping back to the file,
+   *        waiting for that to complete
+   * @return false on failure (or if the mapping has failed)
+   **/
+  bool flush() const noexcept {
+    return this->impl_.flush();
+  }
+};
+
+/**
+ * @brief Memory resource that creates an anonymous shared memory
+ *        object (with memfd_create() on Linux, shm_open() on other
+ *        Unix-like systems and CreateFileMapping() on Windows), maps
+ *        it once on construction and then allocates from it
+ *        sequentially. The regions are never unmapped or reused
+ *        before the destruction. The object can be passed to another
+ *        process by its native handle (e.g., over a Unix socket or
+ *        with DuplicateHandle()) and mapped there by another instance
+ *        of this resource, so that the memory is shared without
+ *        copying. The destructor unmaps the object and closes its
+ *        handle (the memory is freed by the OS when no other process
+ *        has it mapped or open)
+ *
+ * With page_types::big (or an explicit size of big pages), the object
+ * is backed by preallocated big pages (MFD_HUGETLB on Linux,
+ * SEC_LARGE_PAGES on Windows, unsupported elsewhere). With
+ * page_types::transparent, the mapping is aligned and marked for
+ * transparent big pages (on Linux, if enabled for shared memory).
+ **/
+template <page_type auto _type = page_types::regular,
+          mapped_resource_config _config = {}>
+class shared_memory_resource:
+    public __detail::mapped_resource_base<_type, _config> {
+  using base_t = __detail::mapped_resource_base<_type, _config>;
+  using typename base_t::impl_t;
+
+public:
+  using typename base_t::native_handle_t;
+
+  /**
+   * @brief Creates and maps a new shared memory object of the given
+   *        size (ceiled to min_size()). If that fails, all allocations
+   *        will fail as well (see range_begin())
+   **/
+  explicit shared_memory_resource(const size_t size) noexcept:
+    base_t(impl_t::from_shared_memory(size)) {}
+
+  /**
+   * @brief Maps the first size bytes of an existing shared memory
+   *        object (e.g., received from another process), taking the
+   *        ownership of its handle
+   * @param used_size the size of the beginning of the object that is
+   *        already in use, allocations start after it
+   **/
+  shared_memory_resource(const native_handle_t handle, const size_t size,
+                         const size_t used_size = 0) noexcept:
+    base_t(impl_t{handle, size, used_size}) {}
+};
+
+} // namespace memaw
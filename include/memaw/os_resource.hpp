@@ -1,12 +1,17 @@
 #pragma once
+#include <atomic>
+#include <cstddef>
 #include <nupp/mask_iterator.hpp>
 #include <optional>
 #include <ranges>
+#include <thread>
+#include <vector>
 
 #include "__detail/base.hpp"
 #include "__detail/concepts_impl.hpp"
 #include "__detail/os_info.hpp"
 #include "__detail/os_mapper.hpp"
+#include "__detail/os_options.hpp"
 
 /**
  * @file
@@ -25,9 +30,11 @@ namespace memaw {
 struct page_types {
   using regular_t = __detail::os_mapper::regular_pages_tag;
   using big_t = __detail::os_mapper::big_pages_tag;
+  using transparent_t = __detail::os_mapper::transparent_pages_tag;
 
   constexpr static regular_t regular{};
   constexpr static big_t big{};
+  constexpr static transparent_t transparent{};
 };
 
 /**
@@ -37,7 +44,29 @@ struct page_types {
  **/
 template <typename T>
 concept page_type =
-  __detail::same_as_either<T, page_types::regular_t, page_types::big_t, pow2_t>;
+  __detail::same_as_either<T, page_types::regular_t, page_types::big_t,
+                           page_types::transparent_t, pow2_t>;
+
+/**
+ * @brief The NUMA policy (and its mode) to apply to the allocated
+ *        memory. Constructed with the static methods
+ *        numa_policy::bind(node), numa_policy::prefer(node),
+ *        numa_policy::interleave(nodes_mask) and numa_policy::local()
+ **/
+using numa_mode = __detail::numa_mode;
+using numa_policy = __detail::numa_policy;
+
+/**
+ * @brief Additional parameters of an os_resource allocation. Can be
+ *        used as a template parameter (e.g., of pages_resource)
+ **/
+using os_allocation_options = __detail::os_allocation_options;
+
+/**
+ * @brief The current counters of the system pool of big pages of a
+ *        particular size (see os_resource::get_big_pages_stats())
+ **/
+using big_pages_stats = __detail::big_pages_stats;
 
 /**
  * @brief Memory resource that always allocates and frees memory via
@@ -58,7 +87,7 @@ public:
    *        4KiB)
    **/
   static pow2_t get_page_size() noexcept {
-    return __detail::os_info.page_size;
+    return __detail::get_os_info().page_size;
   }
 
   /**
@@ -76,7 +105,63 @@ public:
    *        must be available etc.)
    **/
   static std::optional<pow2_t> get_big_page_size() noexcept {
-    return __detail::os_info.big_page_size;
+    return __detail::get_os_info().big_page_size;
+  }
+
+  /**
+   * @brief Get the current counters of the (preallocated) system pool
+   *        of big pages of the given size: the total number of pages,
+   *        the number of free ones and how many of those are reserved
+   *        for existing mappings (see big_pages_stats::available())
+   *
+   * On Linux, read from /sys/kernel/mm/hugepages/ on every call (so
+   * the result is live but the call is not cheap). This can be used
+   * to skip a big pages allocation that cannot succeed (e.g., in a
+   * chain_resource). On other systems (or if the size is not
+   * supported) returns an empty optional.
+   *
+   * @note  The counters may change right after the call, so a non-zero
+   *        number of available pages does not guarantee a successful
+   *        allocation. Transparent big pages are not counted here
+   **/
+  static std::optional<big_pages_stats>
+    get_big_pages_stats(const pow2_t page_size) noexcept {
+    return __detail::os_info_t::get_big_pages_stats(page_size);
+  }
+
+  /**
+   * @brief Get the size of a transparent big page if transparent big
+   *        pages are available on the system
+   *
+   * On Linux, returns the transparent huge page size (as given in
+   * /sys/kernel/mm/transparent_hugepage/hpage_pmd_size) unless those
+   * are disabled (i.e., the mode is "never"). On other systems always
+   * returns an empty optional.
+   **/
+  static std::optional<pow2_t> get_transparent_page_size() noexcept {
+    return __detail::get_os_info().transparent_page_size;
+  }
+
+  /**
+   * @brief Get the number of NUMA nodes in the system (or rather the
+   *        highest node id plus one), always at least 1
+   *
+   * On Linux, parsed from /sys/devices/system/node/online, on Windows
+   * requested with GetNumaHighestNodeNumber(). On other systems
+   * always returns 1.
+   **/
+  static size_t get_numa_nodes_count() noexcept {
+    return __detail::get_os_info().numa_nodes_count;
+  }
+
+  /**
+   * @brief Get the NUMA node of the CPU the calling thread is
+   *        currently running on (or 0 if that cannot be determined)
+   * @note  Unless the thread is pinned to the node, the result may
+   *        get stale right after the call
+   **/
+  static size_t get_current_numa_node() noexcept {
+    return __detail::os_info_t::get_current_numa_node();
   }
 
   /**
@@ -93,11 +178,13 @@ public:
    *
    * @note  This method enlisting a value does not guarantee a
    *        successful big page allocation of that size
+   * @note  The result of get_transparent_page_size() is not included
+   *        (unless it is also a supported huge page size), as
+   *        transparent pages can't be requested by size
    **/
   static ranges::range auto get_available_page_sizes() noexcept {
-    return
-      ranges::subrange{nupp::mask_iterator(__detail::os_info.page_sizes_mask),
-                       std::default_sentinel};
+    const auto mask = __detail::get_os_info().page_sizes_mask;
+    return ranges::subrange{nupp::mask_iterator(mask), std::default_sentinel};
   }
 
   /**
@@ -106,6 +193,8 @@ public:
    * @return * for page_types::regular, get_page_size();
    *         * for page_types::big, *get_big_page_size() if it's
    *           defined, or of get_page_size() if it's not;
+   *         * for page_types::transparent, the same with
+   *           get_transparent_page_size();
    *         * for explicitly specified page size, its value.
    **/
   template <page_type P = page_types::regular_t>
@@ -141,6 +230,14 @@ public:
    *   to use (and may even use several at a time) depending on the
    *   size and alignment values. For other systems, no promises of
    *   the real page type(s) are made;
+   * - page_types::transparent to request regular pages that the OS
+   *   may transparently back with big ones. On Linux (if
+   *   get_transparent_page_size() is defined), the region is aligned
+   *   by the transparent huge page size (trimming the excess of a
+   *   bigger reservation) and marked with MADV_HUGEPAGE, so that no
+   *   preallocated pages are required. On other systems (or if
+   *   transparent huge pages are disabled) same as
+   *   page_types::regular;
    * - pow2_t with the exact page size value. On Linux (with procfs
    *   mounted at /proc) and Windows 10+ (or Server 2016+) must be one
    *   of the values returned from get_available_page_sizes(). On
@@ -156,12 +253,15 @@ public:
    * The alignment of the resulting address is at least as big as
    * guaranteed_alignment(page_type). If the requested alignment is
    * greater than that value, then note that:
-   * - on Linux the allocation result is always aligned by the page
-   *   size used (i.e., get_page_size() for page_types::regular,
-   *   *get_big_page_size() for page_types::big and the value of
-   *   page_type otherwise), and the allocation with bigger alignment
-   *   will fail since we choose to not implicitly allocate additional
-   *   memory in that case;
+   * - on Unix-like systems, any alignment can be requested for
+   *   page_types::regular and page_types::transparent: a bigger
+   *   region is reserved and the excess is unmapped right away (on
+   *   BSD, MAP_ALIGNED is used for regular pages instead);
+   * - otherwise, on Linux the allocation result is always aligned by
+   *   the page size used (i.e., *get_big_page_size() for
+   *   page_types::big and the value of page_type for explicit
+   *   sizes), and the allocation with bigger alignment will fail
+   *   since big pages are too expensive to over-reserve;
    * - on latest versions of Windows (10+, Server 2016+), any
    *   alignment can be requested independent of the page_type (but
    *   the allocation may still fail if no matching address is
@@ -179,15 +279,29 @@ public:
    * @param alignment must be a power of 2. On some systems (see
    *        above) the allocation will fail if this value is greater
    *        than guaranteed_alignment(page_type)
-   * @param page_type can be page_types::regular, page_types::big or
-   *        pow2_t with the exact page size value (see above for the
-   *        detailed description and limitations)
+   * @param page_type can be page_types::regular, page_types::big,
+   *        page_types::transparent or pow2_t with the exact page size
+   *        value (see above for the detailed description and
+   *        limitations)
+   * @param options the additional parameters of the allocation. The
+   *        numa field sets the NUMA policy of the pages: on Linux,
+   *        any numa_policy is applied with the mbind() syscall; on
+   *        Windows a single node can be requested (for both bind and
+   *        prefer, it becomes the preferred node of the allocation)
+   *        and interleave is not supported; on other systems, only
+   *        local() (which is then the default behaviour) is
+   *        supported. Unsupported policies make the allocation fail
+   *        without a system call. If the populate field is set, the
+   *        pages are backed by physical memory before the call returns
+   *        (see also prefault())
    **/
   template <page_type P = page_types::regular_t>
   [[nodiscard]] static void* allocate
     (const size_t size, const size_t alignment = alignof(std::max_align_t),
-     const P page_type = {}) noexcept {
-    return __detail::os_mapper::map(size, pow2_t{alignment}, page_type);
+     const P page_type = {},
+     const os_allocation_options& options = {}) noexcept {
+    return __detail::os_mapper::map(size, pow2_t{alignment}, page_type,
+                                    options);
   }
 
   /**
@@ -196,11 +310,124 @@ public:
    *        detailed description
    **/
   template <__detail::same_as_either<page_types::regular_t,
-                                     page_types::big_t> P>
+                                     page_types::big_t,
+                                     page_types::transparent_t> P>
   [[nodiscard]] static void* allocate(const size_t size, const P) noexcept {
     return allocate<P>(size);
   }
 
+  /**
+   * @brief  Backs the (previously allocated) region with physical
+   *         memory right away, so that the first access doesn't page
+   *         fault. On Linux 5.14+ uses MADV_POPULATE_WRITE, otherwise
+   *         touches every page (on Windows, after reading the paged
+   *         out ones back in with PrefetchVirtualMemory). The work can
+   *         be split between several threads (the calling one
+   *         included), which speeds up the prefaulting of multi-GiB
+   *         regions
+   * @param  ptr must be aligned by the page size
+   * @param  size must be a multiple of the page size
+   * @param  threads_count the maximum number of threads to use. If a
+   *         thread cannot be started, its part is done by the calling
+   *         thread instead (with exceptions disabled, the failure to
+   *         start a thread terminates the program as usual)
+   * @return false if the OS refused to populate (some of) the pages
+   *         (e.g., out of memory)
+   * @note   The contents of the memory are preserved
+   **/
+  static bool prefault(void* const ptr, const size_t size,
+                       const size_t threads_count = 1) noexcept {
+    using __detail::os_mapper;
+
+    // The parts must stay page-aligned
+    const auto mask = get_page_size().get_mask();
+    const size_t part_size = threads_count > 1
+      ? ((size / threads_count + mask) & ~mask) : size;
+    if (part_size >= size) return os_mapper::populate(ptr, size);
+
+    std::atomic<bool> result = true;
+    std::vector<std::thread> threads;
+
+    auto begin = static_cast<std::byte*>(ptr);
+    const auto end = begin + size;
+#ifdef __cpp_exceptions
+    try {
+#endif
+      threads.reserve(threads_count - 1);
+      for (; size_t(end - begin) > part_size; begin+= part_size)
+        threads.emplace_back([&result, begin, part_size]() {
+          if (!os_mapper::populate(begin, part_size))
+            result.store(false, std::memory_order_relaxed);
+        });
+#ifdef __cpp_exceptions
+    }
+    catch (...) {}  // Whatever is left is done by this thread
+#endif
+
+    const bool last_result = os_mapper::populate(begin, end - begin);
+    for (auto& thread : threads) thread.join();
+
+    return last_result && result.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief  Tries to grow or shrink a previously allocated region in
+   *         place, keeping its contents. On Linux uses mremap() (that
+   *         fails to grow if the following addresses are taken). On
+   *         Windows, a region can only be shrunk (by decommitting the
+   *         tail) and then grown back up to its original size. Other
+   *         Unix-like systems unmap the tail to shrink and try to map
+   *         the following addresses to grow (with regular pages)
+   * @param  ptr must be the pointer to the beginning of the region
+   * @param  old_size must be the current size of the region
+   * @param  new_size must be a multiple of the page size used for the
+   *         region
+   * @return true if the region has been resized, after which it must
+   *         be deallocated with new_size
+   * @note   Growing the regions of big pages is only supported on
+   *         Linux (and only by recent kernels)
+   **/
+  static bool expand(void* const ptr, const size_t old_size,
+                     const size_t new_size) noexcept {
+    return __detail::os_mapper::resize(ptr, old_size, new_size);
+  }
+
+  /**
+   * @brief  Resizes a previously allocated region, moving it to a new
+   *         address if it can't be resized in place, without copying
+   *         the contents (the pages are remapped with MREMAP_MAYMOVE).
+   *         Only supported on Linux and for the alignment of at most
+   *         get_page_size() (use memaw::reallocate() to fall back to
+   *         copying otherwise)
+   * @return the new address of the region, or nullptr if it is left
+   *         as it was
+   **/
+  static void* reallocate(void* const ptr, const size_t old_size,
+                          const size_t new_size,
+                          const size_t alignment = alignof(std::max_align_t))
+    noexcept {
+    if (expand(ptr, old_size, new_size)) return ptr;
+    if (alignment > get_page_size()) return nullptr;
+    return __detail::os_mapper::relocate(ptr, old_size, new_size);
+  }
+
+  /**
+   * @brief Gives the physical memory behind (a part of) a previously
+   *        allocated region back to the OS, keeping the addresses
+   *        mapped and accessible. The contents become unspecified: on
+   *        Linux, the pages are dropped with MADV_DONTNEED right away
+   *        (and zero-filled on the next access); on Windows, they are
+   *        marked with MEM_RESET to be discarded when needed; other
+   *        Unix-like systems use MADV_FREE if available
+   * @param ptr must be aligned by the page size used for the region
+   * @param size must be a multiple of the page size used for the
+   *        region
+   * @note  The region must still be deallocated as usual
+   **/
+  static void purge(void* const ptr, const size_t size) noexcept {
+    __detail::os_mapper::purge(ptr, size);
+  }
+
   /**
    * @brief   Deallocates the previously allocated region or several
    *          adjacent regions of memory
@@ -20,8 +20,10 @@ namespace memaw {
 /**
  * @brief A wrapper around os_resource, allocating memory directly
  *        from the OS using pages of the statically specified size
+ *        (and, optionally, with the given additional options, e.g.,
+ *        a NUMA policy)
  **/
-template <page_type auto _type>
+template <page_type auto _type, os_allocation_options _options = {}>
 class pages_resource {
 public:
   using page_type_t = std::remove_const_t<decltype(_type)>;
@@ -37,6 +39,8 @@ public:
 
   constexpr static bool explicit_size = std::same_as<page_type_t, pow2_t>;
 
+  constexpr static os_allocation_options options = _options;
+
   constexpr pages_resource() noexcept = default;
 
   /**
@@ -70,7 +74,62 @@ public:
   [[nodiscard]] static void* allocate
     (const size_t size,
      const size_t alignment = alignof(std::max_align_t)) noexcept {
-    return os_resource::allocate(size, alignment, _type);
+    return os_resource::allocate(size, alignment, _type, _options);
+  }
+
+  /**
+   * @brief Try to grow or shrink a previously allocated region in
+   *        place (see os_resource::expand() for details). The grown
+   *        part is populated if the options require that
+   **/
+  static bool expand(void* const ptr, const size_t old_size,
+                     const size_t new_size) noexcept {
+    if (!os_resource::expand(ptr, old_size, new_size)) return false;
+
+    if constexpr (_options.populate)
+      if (new_size > old_size)
+        os_resource::prefault(static_cast<std::byte*>(ptr) + old_size,
+                              new_size - old_size);
+
+    return true;
+  }
+
+  /**
+   * @brief Resize a previously allocated region, moving it without
+   *        copying the contents if necessary (see
+   *        os_resource::reallocate() for details)
+   **/
+  static void* reallocate(void* const ptr, const size_t old_size,
+                          const size_t new_size,
+                          const size_t alignment = alignof(std::max_align_t))
+    noexcept {
+    if (expand(ptr, old_size, new_size)) return ptr;
+
+    // The remapped region is only aligned by the page size used (the
+    // big one for big pages), which is not enough for transparent ones
+    if constexpr (std::same_as<page_type_t, page_types::transparent_t>)
+      if (guaranteed_alignment() > os_resource::get_page_size())
+        return nullptr;
+
+    if (alignment > guaranteed_alignment()) return nullptr;
+
+    const auto result =
+      __detail::os_mapper::relocate(ptr, old_size, new_size);
+    if constexpr (_options.populate)
+      if (result && new_size > old_size)
+        os_resource::prefault(static_cast<std::byte*>(result) + old_size,
+                              new_size - old_size);
+
+    return result;
+  }
+
+  /**
+   * @brief Give the physical memory behind (a part of) a previously
+   *        allocated region back to the OS (see os_resource::purge()
+   *        for details)
+   **/
+  static void purge(void* const ptr, const size_t size) noexcept {
+    os_resource::purge(ptr, size);
   }
 
   /**
@@ -83,9 +142,10 @@ public:
   }
 };
 
-template <page_type auto _ltype, page_type auto _rtype>
-constexpr bool enable_interchangeable_resources<pages_resource<_ltype>,
-                                                pages_resource<_rtype>> = true;
+template <page_type auto _ltype, os_allocation_options _loptions,
+          page_type auto _rtype, os_allocation_options _roptions>
+constexpr bool enable_interchangeable_resources
+  <pages_resource<_ltype, _loptions>, pages_resource<_rtype, _roptions>> = true;
 
 /**
  * @brief A resource that allocates pages of regular system size
@@ -99,6 +159,13 @@ using regular_pages_resource = pages_resource<page_types::regular>;
  **/
 using big_pages_resource = pages_resource<page_types::big>;
 
+/**
+ * @brief A resource that allocates regular pages directly from the OS
+ *        asking it to transparently back them with big ones (falls
+ *        back to regular_pages_resource if that is not supported)
+ **/
+using transparent_pages_resource = pages_resource<page_types::transparent>;
+
 /**
  * @brief A resource that allocates pages of the given fixed size
  *        directly from the OS
@@ -106,4 +173,16 @@ using big_pages_resource = pages_resource<page_types::big>;
 template <size_t _size> requires(nupp::is_pow2(_size))
 using fixed_pages_resource = pages_resource<pow2_t(_size, pow2_t::exact)>;
 
+/**
+ * @brief A resource that allocates pages of the given type directly
+ *        from the OS, binding them to the specified NUMA node (see
+ *        os_resource::allocate() for the limitations on different
+ *        systems)
+ **/
+template <size_t _node, page_type auto _type = page_types::regular>
+  requires(_node < numa_policy::max_nodes)
+using numa_pages_resource =
+  pages_resource<_type, os_allocation_options{
+                          .numa = numa_policy::bind(_node) }>;
+
 } // namespace memaw
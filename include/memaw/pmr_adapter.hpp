@@ -0,0 +1,96 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "resource_traits.hpp"
+
+/**
+ * @file
+ * An adapter exposing a resource as a standard polymorphic one
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief An implementation of std::pmr::memory_resource that owns a
+ *        resource of type R and forwards all the calls to it, throwing
+ *        std::bad_alloc on allocation failures (as required by the
+ *        standard interface)
+ *
+ * The class is final, so the calls to allocate() and deallocate()
+ * made through a reference to pmr_adapter<R> (and not to its base)
+ * can be devirtualized and inlined by the compiler. The (arbitrary)
+ * sizes passed by the standard containers are ceiled with
+ * resource_traits<R>::ceil_allocation_size(), so any granular or
+ * bound resource can be used directly
+ **/
+template <resource R>
+class pmr_adapter final: public std::pmr::memory_resource {
+public:
+  using resource_t = R;
+
+  pmr_adapter() noexcept(std::is_nothrow_default_constructible_v<resource_t>)
+    requires(std::default_initializable<resource_t>) {}
+
+  explicit pmr_adapter(resource_t&& resource)
+    noexcept(std::is_nothrow_move_constructible_v<resource_t>)
+    requires(std::move_constructible<resource_t>):
+    resource_(std::move(resource)) {}
+
+  pmr_adapter(const pmr_adapter&) = delete;
+  pmr_adapter& operator=(const pmr_adapter&) = delete;
+
+  /**
+   * @brief Returns the underlying resource
+   **/
+  resource_t& resource() noexcept {
+    return resource_;
+  }
+
+  /**
+   * @brief Returns the underlying resource
+   **/
+  const resource_t& resource() const noexcept {
+    return resource_;
+  }
+
+private:
+  void* do_allocate(const size_t size, const size_t alignment) override {
+    return memaw::allocate<exceptions_policy::throw_bad_alloc>
+      (resource_, resource_traits<R>::ceil_allocation_size(size), alignment);
+  }
+
+  void do_deallocate(void* const ptr, const size_t size,
+                     const size_t alignment) override {
+    resource_.deallocate(ptr, resource_traits<R>::ceil_allocation_size(size),
+                         alignment);
+  }
+
+  /**
+   * @brief Checks if the other resource is a pmr_adapter of the same
+   *        type with the underlying resource interchangeable with this
+   *        one (i.e., always, if R has equal instances, or if the
+   *        resources are equal otherwise)
+   **/
+  bool do_is_equal(const std::pmr::memory_resource& other)
+    const noexcept override {
+    if (this == &other) return true;
+
+    const auto rhs = dynamic_cast<const pmr_adapter*>(&other);
+    if (!rhs) return false;
+
+    if constexpr (interchangeable_resource_with<R, R>) return true;
+    else return resource_ == rhs->resource_;
+  }
+
+  resource_t resource_;
+};
+
+} // namespace memaw
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <concepts>
 #include <ranges>
 #include <type_traits>
@@ -20,6 +21,34 @@
 
 namespace memaw {
 
+/**
+ * @brief The ways pool_resource can handle the allocations bigger than
+ *        its max_chunk_size
+ **/
+enum class large_allocation_mode {
+  /**
+   * @brief Allocate a region from the upstream and break it into
+   *        chunks on deallocation (so that it can only be reused by
+   *        the smaller allocations)
+   **/
+  split,
+
+  /**
+   * @brief Allocate the region from the upstream and return it to the
+   *        upstream right on deallocation
+   **/
+  pass_through,
+
+  /**
+   * @brief Keep the deallocated regions whole in free lists indexed by
+   *        size class (4 classes per every power of 2), so that they
+   *        are reused by the following large allocations of the same
+   *        class. The regions bigger than max_cached_large_size are
+   *        passed through
+   **/
+  cached
+};
+
 /**
  * @brief Configuration parameters for pool_resource with valid
  *        defaults
@@ -37,7 +66,8 @@ struct pool_resource_config {
 
   /**
    * @brief The maximum size of a chunk. Must equal min_chunk_size *
-   *        chunk_size_multiplier^n for some n
+   *        chunk_size_multiplier^n for some n (unless the sizes are
+   *        listed explicitly, see below)
    **/
   const size_t max_chunk_size = 16_KiB;
 
@@ -49,23 +79,86 @@ struct pool_resource_config {
    **/
   const size_t chunk_size_multiplier = 2;
 
+  /**
+   * @brief The explicit list of chunk sizes to use instead of the
+   *        powers of chunk_size_multiplier, terminated by the first
+   *        zero (the default all-zeros value means no list). The
+   *        sizes must be strictly increasing multiples of
+   *        min_chunk_size, starting with min_chunk_size and ending
+   *        with max_chunk_size
+   * @note  chunk_size_multiplier is still used to determine the size
+   *        of allocations from the upstream
+   **/
+  const std::array<size_t, 64> explicit_chunk_sizes = {};
+
   /**
    * @brief Thread safety policy: if set to true, the implementation
    *        will use atomic instructions to manage its internal
-   *        structures (requires DWCAS). The thread safe
+   *        structures (DWCAS, or packed tagged pointers if
+   *        MEMAW_USE_DWCAS is defined as 0). The thread safe
    *        implementation is lock-free
    * @note  If the underlying resource is not thread safe, setting this
    *        parameter to true will change the type of instructions
    *        used but won't make the pool thread safe either
    **/
   const bool thread_safe = true;
+
+  /**
+   * @brief The maximum number of chunks of each size a thread can
+   *        keep in its local cache. If non-zero (and thread_safe is
+   *        true), every thread gets a small magazine of chunks that
+   *        serves most of its (de-)allocations without atomic
+   *        instructions. When a magazine overflows, its colder half
+   *        is put to the shared depot as a single batch, and a thread
+   *        that has run out of the chunks of some size takes a whole
+   *        batch at once. Thus, the memory freed by (consumer) threads
+   *        other than the one that has allocated it comes back to the
+   *        (producer) threads in bulk, with a single atomic operation
+   *        per batch
+   * @note  The magazines are allocated from the pool itself (also on
+   *        the first deallocation by a thread). The chunks cached by
+   *        a thread that has exited are not reused until another
+   *        thread with the same id comes along or the pool is
+   *        destroyed
+   **/
+  const size_t thread_cache_size = 0;
+
+  /**
+   * @brief If set to true, the pool keeps track of the blocks
+   *        allocated from the upstream, so that the free ones can be
+   *        returned with release_unused() before the destruction
+   * @note  Every block then loses min_chunk_size bytes at its end to
+   *        the header. The blocks are never merged when returned to
+   *        the upstream
+   **/
+  const bool trimmable = false;
+
+  /**
+   * @brief The way the allocations bigger than max_chunk_size are
+   *        handled (see large_allocation_mode)
+   * @note  With any mode but split, the pool is not sweeping (a large
+   *        region must be deallocated exactly as it was allocated,
+   *        with the same alignment)
+   **/
+  const large_allocation_mode large_allocations = large_allocation_mode::split;
+
+  /**
+   * @brief The maximum size of a large region to keep for reuse if
+   *        large_allocations is cached. The sizes of such regions are
+   *        ceiled to their size class (wasting less than 1/5 of the
+   *        allocated memory)
+   **/
+  const size_t max_cached_large_size = 1_MiB;
 };
 
 /**
  * @brief Memory resource that maintains lists of chunks of fixed
  *        sizes allocated from the upstream resource. Chunks are
  *        reused upon deallocation but are not returned to the
- *        upstream until this resource is destructed
+ *        upstream until this resource is destructed (or, if
+ *        configured as trimmable, release_unused() is called). The
+ *        allocations bigger than the maximum chunk size can also be
+ *        handled separately (see large_allocation_mode)
  **/
 template <sweeping_resource R,
           pool_resource_config _config = pool_resource_config{
@@ -79,7 +172,11 @@ public:
   static_assert(_config.max_chunk_size % _config.min_chunk_size == 0);
   static_assert(impl_t::chunk_sizes.back() == _config.max_chunk_size,
                 "max_chunk_size must equal min_chunk_size * "
-                "chunk_size_multiplier^n for some n");
+                "chunk_size_multiplier^n for some n or be the last of "
+                "the explicit_chunk_sizes");
+  static_assert(_config.large_allocations != large_allocation_mode::cached
+                || _config.max_cached_large_size > _config.max_chunk_size,
+                "max_cached_large_size must be greater than max_chunk_size");
 
   /**
    * @brief The underlying resource to allocate memory from
@@ -97,7 +194,15 @@ public:
   constexpr static const ranges::range auto& chunk_sizes = impl_t::chunk_sizes;
 
   constexpr static bool is_granular = true;
-  constexpr static bool is_sweeping = true;
+
+  /**
+   * @brief Specifies if the pool is sweeping, which is only true if
+   *        the large allocations are split into chunks (see
+   *        pool_resource_config::large_allocations)
+   **/
+  constexpr static bool is_sweeping =
+    _config.large_allocations == large_allocation_mode::split;
+
   constexpr static bool is_thread_safe =
     _config.thread_safe && thread_safe_resource<upstream_t>;
 
@@ -158,11 +263,78 @@ public:
   /**
    * @brief Deallocates previously allocated chunks and marks them for
    *        reuse. The deallocate() call on the upstream resource
-   *        happens only on destruction
+   *        happens only on destruction (except for the large regions
+   *        passed through, see pool_resource_config::large_allocations)
+   * @param alignment is only used for the large regions passed through
    **/
   void deallocate(void* const ptr, const size_t size,
-                  const size_t = alignof(std::max_align_t)) noexcept {
-    impl_.deallocate(uintptr_t(ptr), size); // NB: alignment param is ignored
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept {
+    impl_.deallocate(uintptr_t(ptr), size, pow2_t{alignment, pow2_t::ceil});
+  }
+
+  /**
+   * @brief Allocates count regions of the same size and alignment,
+   *        writing the pointers to out. The suitable chunks are taken
+   *        from the thread cache first and then popped off the shared
+   *        list (only as many as needed, leaving the rest to the other
+   *        threads), the rest are allocated as with allocate()
+   * @return the number of allocated regions (less than count only on
+   *         failure)
+   **/
+  size_t allocate_batch(const size_t count, const size_t size,
+                        const size_t alignment, void** const out) noexcept {
+    return impl_.allocate_batch(count, size,
+                                pow2_t{alignment, pow2_t::ceil}, out);
+  }
+
+  /**
+   * @brief Deallocates count regions of the same size (skipping null
+   *        pointers). If the size is one of chunk_sizes, the chunks are
+   *        linked together and put to the thread cache or the shared
+   *        list with a single operation
+   **/
+  void deallocate_batch(const size_t count, const size_t size,
+                        const size_t alignment,
+                        void* const* const ptrs) noexcept {
+    impl_.deallocate_batch(count, size, pow2_t{alignment, pow2_t::ceil},
+                           ptrs);
+  }
+
+  /**
+   * @brief Deallocates the upstream blocks with no chunks in use,
+   *        except for the (lowest addressed) ones with the total size
+   *        of up to keep_bytes, which stay for further allocations,
+   *        as well as all the cached large regions (if any). Returns
+   *        the total size of the deallocated memory
+   * @note  Not thread safe: must only be called at quiescent points,
+   *        i.e., with no other calls on the pool in progress. The
+   *        chunks cached by threads are moved to the shared lists
+   *        before the search
+   **/
+  size_t release_unused(const size_t keep_bytes = 0) noexcept
+    requires(_config.trimmable) {
+    return impl_.release_unused(keep_bytes);
+  }
+
+  /**
+   * @brief Returns the number of free chunks of every size (in the
+   *        order of chunk_sizes), including the ones cached by threads
+   * @note  Not thread safe: must only be called at quiescent points,
+   *        i.e., with no other calls on the pool in progress
+   **/
+  std::array<size_t, impl_t::chunk_sizes.size()> count_free_chunks()
+    noexcept {
+    return impl_.count_free_chunks();
+  }
+
+  /**
+   * @brief Returns the underlying resource (e.g., to get the
+   *        statistics of the upstream allocations if it is a
+   *        stats_resource)
+   **/
+  const upstream_t& upstream() const noexcept {
+    return impl_.get_upstream();
   }
 
   bool operator==(const pool_resource&) const noexcept = default;
@@ -0,0 +1,350 @@
+#pragma once
+#include <cstdint>
+#include <nupp/algorithm.hpp>
+#include <thread>
+#include <utility>
+
+#include "concepts.hpp"
+#include "literals.hpp"
+#include "os_resource.hpp"
+
+#include "__detail/base.hpp"
+#include "__detail/mem_ref.hpp"
+#include "__detail/os_mapper.hpp"
+#include "__detail/resource_common.hpp"
+
+/**
+ * @file
+ * A resource that reserves a big contiguous range of addresses from
+ * the OS upfront and commits memory from it on demand
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Configuration parameters for reserved_range_resource with
+ *        valid defaults
+ **/
+struct reserved_range_resource_config {
+  /**
+   * @brief The size of the address range to reserve on construction
+   *        (ceiled to the page size at runtime). No memory is
+   *        committed by the reservation itself, so this value is only
+   *        limited by the available address space
+   **/
+  const size_t reserve_size = 64_GiB;
+
+  /**
+   * @brief The minimum size of memory to commit at once (ceiled to
+   *        the page size at runtime) when the allocations advance past
+   *        the committed part of the range. Bigger values mean fewer
+   *        system calls
+   * @note  Committing only makes the pages accessible: physical memory
+   *        is still only used when the pages are touched
+   **/
+  const size_t commit_size = 2_MiB;
+
+  /**
+   * @brief Thread safety policy: if set to true, the implementation
+   *        will use atomic instructions to advance the (lock-free)
+   *        allocation offset and the commit offset (which only one
+   *        thread at a time can advance, with the others that need
+   *        more memory committed waiting for it)
+   **/
+  const bool thread_safe = true;
+};
+
+/**
+ * @brief Memory resource that reserves a contiguous range of the
+ *        address space once on construction and then allocates from
+ *        it sequentially, committing the memory on demand.
+ *        Deallocated regions are decommitted (given back to the OS)
+ *        right away, but their addresses are never reused, i.e., the
+ *        resource can allocate at most reserve_size bytes (including
+ *        the alignment padding) in total over its lifetime
+ * @note  Subsequent allocations are adjacent (unless padded for
+ *        alignment), which makes the resource a good upstream for
+ *        cache_resource: its blocks then form a single contiguous
+ *        growing arena
+ **/
+template <reserved_range_resource_config _config = {}>
+class reserved_range_resource {
+public:
+  static_assert(_config.reserve_size > 0);
+  static_assert(_config.commit_size > 0);
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const reserved_range_resource_config& config = _config;
+
+  constexpr static bool is_granular = true;
+  constexpr static bool is_sweeping = true;
+  constexpr static bool is_thread_safe = _config.thread_safe;
+
+  /**
+   * @brief Returns the size of a minimum allocation (the regular page
+   *        size): any allocation can only request a size that is a
+   *        multiple of this value
+   **/
+  static pow2_t min_size() noexcept {
+    return os_resource::get_page_size();
+  }
+
+  /**
+   * @brief Returns the minimal alignment of any allocated address
+   *        (the regular page size)
+   **/
+  static pow2_t guaranteed_alignment() noexcept {
+    return os_resource::get_page_size();
+  }
+
+  /**
+   * @brief Reserves the address range of the configured size. If the
+   *        reservation fails, all allocations will fail as well (see
+   *        range_begin())
+   **/
+  reserved_range_resource() noexcept:
+    size_(ceil_to_page(_config.reserve_size)),
+    begin_(uintptr_t(__detail::os_mapper::reserve(size_))) {
+    if (!begin_) size_ = 0;
+  }
+
+  reserved_range_resource(const reserved_range_resource&) = delete;
+  reserved_range_resource& operator=(const reserved_range_resource&) = delete;
+  reserved_range_resource& operator=(reserved_range_resource&&) = delete;
+
+  /**
+   * @brief Move constructs the resource leaving rhs with no range
+   * @note  The operation is not thread safe even if the resources are
+   *        configured as such. All memory allocated by the rhs
+   *        resource and not deallocated before the move must be
+   *        deallocated through the new instance
+   **/
+  reserved_range_resource(reserved_range_resource&& rhs) noexcept:
+    size_(std::exchange(rhs.size_, 0)),
+    begin_(std::exchange(rhs.begin_, 0)),
+    offset_(std::exchange(rhs.offset_, 0)),
+    committed_(std::exchange(rhs.committed_, 0)) {}
+
+  /**
+   * @brief Releases the whole reserved range back to the OS
+   **/
+  ~reserved_range_resource() noexcept {
+    __detail::os_mapper::release(reinterpret_cast<void*>(begin_), size_);
+  }
+
+  /**
+   * @brief Returns the beginning of the reserved range (nullptr if the
+   *        reservation has failed)
+   **/
+  void* range_begin() const noexcept {
+    return reinterpret_cast<void*>(begin_);
+  }
+
+  /**
+   * @brief Returns the size of the reserved range (0 if the
+   *        reservation has failed)
+   **/
+  size_t reserved_size() const noexcept {
+    return size_;
+  }
+
+  /**
+   * @brief Returns the size of the (beginning) part of the range that
+   *        has already been given out by allocate() calls
+   **/
+  size_t used_size() const noexcept {
+    return __detail::make_mem_ref<thread_safety>(offset_)
+      .load(__detail::mo_t::relaxed);
+  }
+
+  /**
+   * @brief Allocates the next region of the range, committing memory
+   *        if necessary
+   * @param size must be a multiple of min_size(), otherwise the
+   *        allocation will fail
+   * @param alignment must be a power of 2. If it is greater than the
+   *        page size, the addresses before the result are skipped (and
+   *        not committed, unless they already were, ahead of time)
+   **/
+  [[nodiscard]] inline void* allocate
+    (size_t size, size_t alignment = alignof(std::max_align_t)) noexcept;
+
+  /**
+   * @brief Gives the physical memory behind (a part of) a previously
+   *        allocated region back to the OS, keeping the region
+   *        committed (see os_resource::purge() for details)
+   **/
+  static void purge(void* const ptr, const size_t size) noexcept {
+    __detail::os_mapper::purge(ptr, size);
+  }
+
+  /**
+   * @brief Decommits the memory of a previously allocated region (or
+   *        several adjacent regions). The addresses are not reused
+   **/
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t /*alignment, ignored */= 1) noexcept {
+    if (!ptr) return;
+    __detail::os_mapper::decommit(ptr, size);
+  }
+
+  /**
+   * @brief Every instance has its own range, so different instances
+   *        are never equal
+   **/
+  bool operator==(const reserved_range_resource& rhs) const noexcept {
+    return this == &rhs;
+  }
+
+private:
+  constexpr static auto thread_safety =
+    _config.thread_safe ? __detail::thread_safe : __detail::thread_unsafe;
+
+  static size_t ceil_to_page(const size_t size) noexcept {
+    const auto mask = os_resource::get_page_size().get_mask();
+    return (size + mask) & ~mask;
+  }
+
+  struct placement_t {
+    uintptr_t ptr;
+    size_t end = 0;  // The new allocation offset, 0 if it doesn't fit
+  };
+
+  /**
+   * @brief Places the region of the size with the alignment at the
+   *        offset of the range
+   **/
+  inline placement_t place(size_t, size_t, pow2_t) const noexcept;
+
+  /**
+   * @brief Allocates the region that doesn't fit the committed part of
+   *        the range, committing the memory beyond it (but not the
+   *        padding) before publishing the region
+   **/
+  inline void* allocate_committing(size_t, pow2_t) noexcept;
+
+  // Set in the committed offset while a thread is advancing it (the
+  // offset itself is always a multiple of the page size)
+  constexpr static size_t commit_lock = 1;
+
+  size_t size_;
+  uintptr_t begin_;
+
+  size_t offset_ = 0;     // The end of the allocated part of the range
+  size_t committed_ = 0;  // The end of the committed part of the range
+};
+
+template <reserved_range_resource_config _config>
+auto reserved_range_resource<_config>::place
+  (const size_t offset, const size_t size, const pow2_t alignment)
+  const noexcept -> placement_t {
+  const auto [ptr, padding] = __detail::align_pointer(begin_ + offset,
+                                                      alignment);
+
+  // Compare with the space left to avoid overflows
+  const size_t left = size_ - offset;
+  if (padding > left || size > left - padding) return {};
+
+  return { .ptr = ptr, .end = offset + padding + size };
+}
+
+template <reserved_range_resource_config _config>
+void* reserved_range_resource<_config>::allocate
+  (const size_t size, const size_t alignment) noexcept {
+  if (!size || (size & min_size().get_mask())) [[unlikely]] return nullptr;
+
+  const auto real_alignment =
+    nupp::maximum(pow2_t{alignment, pow2_t::ceil}, guaranteed_alignment());
+
+  const auto offset_ref = __detail::make_mem_ref<thread_safety>(offset_);
+  const auto committed_ref = __detail::make_mem_ref<thread_safety>(committed_);
+  auto offset = offset_ref.load(__detail::mo_t::relaxed);
+
+  placement_t placement;
+  do {
+    placement = place(offset, size, real_alignment);
+    if (!placement.end) [[unlikely]] return nullptr;
+
+    // NB: the end is a multiple of the page size, so the lock bit of
+    // the committed offset does not affect the comparison
+    if (placement.end > committed_ref.load(__detail::mo_t::acquire))
+      return allocate_committing(size, real_alignment);
+  } while (!offset_ref.compare_exchange_weak(offset, placement.end,
+                                             __detail::mo_t::relaxed,
+                                             __detail::mo_t::relaxed));
+
+  return reinterpret_cast<void*>(placement.ptr);
+}
+
+template <reserved_range_resource_config _config>
+void* reserved_range_resource<_config>::allocate_committing
+  (const size_t size, const pow2_t alignment) noexcept {
+  const auto offset_ref = __detail::make_mem_ref<thread_safety>(offset_);
+  const auto committed_ref = __detail::make_mem_ref<thread_safety>(committed_);
+
+  auto committed = committed_ref.load(__detail::mo_t::acquire);
+  for (;;) {
+    if (committed & commit_lock) {
+      std::this_thread::yield();
+      committed = committed_ref.load(__detail::mo_t::acquire);
+    }
+    else if (committed_ref.compare_exchange_weak(committed,
+                                                 committed | commit_lock,
+                                                 __detail::mo_t::acquire,
+                                                 __detail::mo_t::acquire))
+      break;
+  }
+
+  /* Now only this thread moves the committed offset, so the memory
+   * from it on has never been allocated (committing from a stale
+   * offset instead could make the regions deallocated in the meantime
+   * accessible again). The others can still allocate below it, so the
+   * region is placed again on every CAS failure */
+  auto offset = offset_ref.load(__detail::mo_t::relaxed);
+  auto new_committed = committed;
+  uintptr_t result = 0;
+
+  for (;;) {
+    const auto placement = place(offset, size, alignment);
+    if (!placement.end) [[unlikely]] break;
+
+    new_committed = committed;
+    if (placement.end > committed) {
+      // The padding past the committed offset is skipped: no region
+      // can be placed there once the offset is published
+      const size_t from =
+        nupp::maximum(committed, size_t(placement.ptr - begin_));
+      new_committed =
+        nupp::minimum(ceil_to_page(nupp::maximum(placement.end,
+                                                 from + _config.commit_size)),
+                      size_);
+
+      // NB: on a retry, some pages may be committed again, which is
+      // harmless as they have never been allocated
+      if (!__detail::os_mapper::commit(reinterpret_cast<void*>(begin_ + from),
+                                       new_committed - from))
+        [[unlikely]] break;
+    }
+
+    /* The committed offset is only published after the region, so
+     * that a failure leaves both intact, and no other thread can place
+     * a region in the skipped padding */
+    if (offset_ref.compare_exchange_weak(offset, placement.end,
+                                         __detail::mo_t::relaxed,
+                                         __detail::mo_t::relaxed)) {
+      result = placement.ptr;
+      break;
+    }
+  }
+
+  committed_ref.store(result ? new_committed : committed,
+                      __detail::mo_t::release);
+  return reinterpret_cast<void*>(result);
+}
+
+} // namespace memaw
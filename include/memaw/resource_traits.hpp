@@ -1,4 +1,6 @@
 #pragma once
+#include <cstring>
+
 #include "concepts.hpp"
 
 #include "__detail/resource_traits_impl.hpp"
@@ -52,6 +54,20 @@ struct resource_traits {
    **/
   constexpr static bool is_thread_safe = thread_safe_resource<R>;
 
+  /**
+   * @brief True iff the resource can release the physical memory of
+   *        an allocated region while keeping it (see the
+   *        purging_resource concept for details)
+   **/
+  constexpr static bool is_purging = purging_resource<R>;
+
+  /**
+   * @brief True iff the resource can try to resize an allocated
+   *        region in place (see the expanding_resource concept for
+   *        details)
+   **/
+  constexpr static bool is_expanding = expanding_resource<R>;
+
   /**
    * @brief True iff the resource's methods don't throw exceptions
    *        (see the nothrow_resource concept for details)
@@ -147,6 +163,127 @@ inline void deallocate(R& resource, void* const ptr, const size_t size,
   __detail::deallocate_impl<_policy>(resource, ptr, size, alignment);
 }
 
+/**
+ * @brief Allocates count regions of the same size and alignment from
+ *        the given resource, writing the pointers to out. Forwards
+ *        the call to R::allocate_batch() if it is defined (and
+ *        noexcept), otherwise calls allocate() with the nothrow
+ *        policy until the first failure
+ * @return the number of allocated regions, i.e., the number of the
+ *         first elements of out that have been set (less than count
+ *         only on failure)
+ **/
+template <resource R>
+inline size_t allocate_batch(R& resource, const size_t count,
+                             const size_t size, const size_t alignment,
+                             void** const out) noexcept {
+  if constexpr (__detail::has_batch_allocate<R>)
+    return resource.allocate_batch(count, size, alignment, out);
+  else {
+    size_t result = 0;
+    for (; result < count; ++result) {
+      out[result] = allocate<exceptions_policy::nothrow>(resource, size,
+                                                         alignment);
+      if (!out[result]) break;
+    }
+    return result;
+  }
+}
+
+/**
+ * @brief Deallocates count regions of the same size and alignment
+ *        (skipping null pointers) to the given resource. Forwards the
+ *        call to R::deallocate_batch() if it is defined (and
+ *        noexcept), otherwise calls deallocate() with the nothrow
+ *        policy for every region
+ **/
+template <resource R>
+inline void deallocate_batch(R& resource, const size_t count,
+                             const size_t size, const size_t alignment,
+                             void* const* const ptrs) noexcept {
+  if constexpr (__detail::has_batch_deallocate<R>)
+    resource.deallocate_batch(count, size, alignment, ptrs);
+  else {
+    for (size_t i = 0; i < count; ++i) {
+      if (ptrs[i])
+        deallocate<exceptions_policy::nothrow>(resource, ptrs[i], size,
+                                               alignment);
+    }
+  }
+}
+
+/**
+ * @brief Releases the physical memory behind (a part of) an allocated
+ *        region with R::purge() if R models purging_resource (see its
+ *        description for the requirements), otherwise does nothing
+ * @return true iff the purge() call has been made
+ **/
+template <resource R>
+inline bool purge(R& resource, void* const ptr, const size_t size) noexcept {
+  if constexpr (purging_resource<R>) {
+    resource.purge(ptr, size);
+    return true;
+  }
+  else return false;
+}
+
+/**
+ * @brief Tries to resize an allocated region in place with
+ *        R::expand() if R models expanding_resource (see its
+ *        description for the requirements)
+ * @return true iff the region has been resized (always false for the
+ *         other resources, unless the sizes are equal)
+ **/
+template <resource R>
+inline bool expand(R& resource, void* const ptr, const size_t old_size,
+                   const size_t new_size) noexcept {
+  if (old_size == new_size) return true;
+
+  if constexpr (expanding_resource<R>)
+    return resource.expand(ptr, old_size, new_size);
+  else return false;
+}
+
+/**
+ * @brief Resizes an allocated region with the chosen exception
+ *        policy, moving it if necessary. Tries expand() first, then
+ *        R::reallocate() if it is defined (a resource may move the
+ *        region there without copying the contents, e.g., by
+ *        remapping the pages), and finally allocates a new region,
+ *        copies min(old_size, new_size) bytes to it and deallocates
+ *        the old one
+ * @return the pointer to the resized region or nullptr (unless the
+ *         policy throws) on failure, in which case the old region
+ *         stays intact
+ **/
+template <exceptions_policy _policy = exceptions_policy::original,
+          resource R>
+[[nodiscard]] inline void* reallocate
+  (R& resource, void* const ptr, const size_t old_size,
+   const size_t new_size, const size_t alignment = alignof(std::max_align_t))
+  noexcept(__detail::is_nothrow_with<_policy,
+                                     __detail::has_nothrow_allocate<R>>
+           && __detail::is_nothrow_with<_policy,
+                                        __detail::has_nothrow_deallocate<R>>) {
+  if (expand(resource, ptr, old_size, new_size)) return ptr;
+
+  if constexpr (__detail::has_reallocate<R>)
+    if (const auto result =
+          resource.reallocate(ptr, old_size, new_size, alignment))
+      return result;
+
+  const auto result = allocate<_policy>(resource, new_size, alignment);
+  if (!result) return nullptr;
+
+  std::memcpy(result, ptr, nupp::minimum(old_size, new_size));
+
+  constexpr auto dealloc_policy = _policy == exceptions_policy::nothrow
+    ? exceptions_policy::nothrow : exceptions_policy::original;
+  deallocate<dealloc_policy>(resource, ptr, old_size, alignment);
+
+  return result;
+}
+
 /**
  * @brief The structure used to return resource allocation result of
  *        the implementation defined real size (e.g. from
@@ -0,0 +1,192 @@
+#pragma once
+#include <concepts>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "resource_traits.hpp"
+
+#include "__detail/chain_resource_impl.hpp"
+
+/**
+ * @file
+ * A resource adaptor that routes allocations to one of two resources
+ * depending on the size
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Memory resource adaptor that forwards every allocate() and
+ *        deallocate() call with the size not greater than the given
+ *        threshold to the Small resource, and all the others to the
+ *        Large one. The choice is made by the size only, so, unlike
+ *        chain_resource, it never tries a resource that is going to
+ *        fail and doesn't require any of them to be substitutable for
+ *        the other
+ *
+ * More buckets can be made by nesting the segregators, e.g.:
+ *
+ *   segregator_resource<256, pool_resource<...>,
+ *                       segregator_resource<16_MiB, cache_resource<...>,
+ *                                           os_resource>>
+ *
+ * @note  A region of memory is always deallocated by the same resource
+ *        that has allocated it, thus the segregator is not sweeping
+ *        (since adjacent regions may come from different resources)
+ **/
+template <size_t _threshold, resource Small, resource Large>
+class segregator_resource {
+public:
+  /**
+   * @brief The maximum size of the allocations forwarded to the Small
+   *        resource (a template parameter)
+   **/
+  constexpr static size_t threshold = _threshold;
+
+  using small_t = Small;
+  using large_t = Large;
+
+  /**
+   * @brief Specifies if the segregator is granular (i.e., its Small
+   *        resource is granular, see min_size())
+   **/
+  constexpr static bool is_granular = granular_resource<small_t>;
+
+  /**
+   * @brief Specifies if the segregator is thread_safe (i.e., both of
+   *        its resources are thread_safe)
+   **/
+  constexpr static bool is_thread_safe =
+    thread_safe_resource<small_t> && thread_safe_resource<large_t>;
+
+  /**
+   * @brief Specifies if the segregator is interchangeable with the
+   *        given resource (i.e., both of its resources are
+   *        interchangeable with it)
+   **/
+  template <resource R>
+  constexpr static bool is_interchangeable_with =
+    interchangeable_resource_with<R, small_t>
+    && interchangeable_resource_with<R, large_t>;
+
+  /**
+   * @brief Specifies if the segregator is substitutable for the given
+   *        resource (i.e., both of its resources are substitutable for
+   *        it, since any of them can get the deallocation call)
+   **/
+  template <resource R>
+  constexpr static bool is_substitutable_for =
+    substitutable_resource_for<small_t, R>
+    && substitutable_resource_for<large_t, R>;
+
+  /**
+   * @brief Specifies if all the instances of the segregator are equal
+   *        (i.e., both of its resources have equal_instances)
+   **/
+  constexpr static bool has_equal_instances =
+    __detail::equal_instances<small_t> && __detail::equal_instances<large_t>;
+
+  constexpr segregator_resource()
+    noexcept(std::is_nothrow_default_constructible_v<small_t>
+             && std::is_nothrow_default_constructible_v<large_t>)
+    requires(std::default_initializable<small_t>
+             && std::default_initializable<large_t>) {}
+
+  constexpr segregator_resource(small_t&& small, large_t&& large)
+    noexcept(std::is_nothrow_move_constructible_v<small_t>
+             && std::is_nothrow_move_constructible_v<large_t>)
+    requires(std::move_constructible<small_t>
+             && std::move_constructible<large_t>):
+    small_(std::move(small)), large_(std::move(large)) {}
+
+  /**
+   * @brief Returns the minimum allocation size of the Small resource
+   *        (is only defined if it is bound)
+   * @note  The sizes forwarded to the Large resource are ceiled with
+   *        its resource_traits by the segregator itself, so that a big
+   *        min_size() of it (e.g., the page size) doesn't apply to the
+   *        small allocations
+   **/
+  constexpr static size_t min_size() noexcept
+    requires(bound_resource<small_t>) {
+    return small_t::min_size();
+  }
+
+  /**
+   * @brief Returns the guaranteed alignment of all the memory
+   *        addresses allocated by the segregator, defined iff both of
+   *        the resources are overaligning (and equals the minimum of
+   *        their guaranteed_alignment()s)
+   **/
+  constexpr static pow2_t guaranteed_alignment() noexcept
+    requires(overaligning_resource<small_t>
+             && overaligning_resource<large_t>) {
+    return __detail::resource_list<small_t, large_t>
+      ::get_guaranteed_alignment();
+  }
+
+  /**
+   * @brief Returns the resource that services the allocations not
+   *        greater than the threshold
+   **/
+  small_t& small() noexcept {
+    return small_;
+  }
+
+  /**
+   * @brief Returns the resource that services the allocations greater
+   *        than the threshold
+   **/
+  large_t& large() noexcept {
+    return large_;
+  }
+
+  /**
+   * @brief Forwards the call to the Small resource if the size is not
+   *        greater than the threshold, and to the Large one otherwise
+   *        (with the size ceiled by resource_traits<Large>)
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size,
+     const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_allocate<small_t>
+             && __detail::has_nothrow_allocate<large_t>) {
+    if (size <= _threshold) return small_.allocate(size, alignment);
+    else return large_.allocate(ceil_large_size(size), alignment);
+  }
+
+  /**
+   * @brief Forwards the call to the same resource allocate() with
+   *        this size would be forwarded to
+   **/
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_deallocate<small_t>
+             && __detail::has_nothrow_deallocate<large_t>) {
+    if (size <= _threshold) small_.deallocate(ptr, size, alignment);
+    else large_.deallocate(ptr, ceil_large_size(size), alignment);
+  }
+
+  constexpr bool operator==(const segregator_resource& rhs) const
+    noexcept(__detail::nothrow_equality_comparable<small_t>
+             && __detail::nothrow_equality_comparable<large_t>)
+    requires(!has_equal_instances) {
+    // NB: not defaulted, since the resources' operators may not be
+    // constexpr (e.g., the pools compare the addresses)
+    return small_ == rhs.small_ && large_ == rhs.large_;
+  }
+
+private:
+  constexpr static size_t ceil_large_size(const size_t size) noexcept {
+    return resource_traits<large_t>::ceil_allocation_size(size);
+  }
+
+  [[no_unique_address]] small_t small_;
+  [[no_unique_address]] large_t large_;
+};
+
+} // namespace memaw
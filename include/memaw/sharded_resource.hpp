@@ -0,0 +1,315 @@
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "resource_traits.hpp"
+
+#include "__detail/base.hpp"
+#include "__detail/chain_resource_impl.hpp"
+#include "__detail/mem_ref.hpp"
+#include "__detail/os_info.hpp"
+#include "__detail/thread_index.hpp"
+
+/**
+ * @file
+ * A resource adaptor that spreads the calls among several instances
+ * of a resource
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief The ways sharded_resource can pick a shard for a call
+ **/
+enum class shard_selection {
+  /**
+   * @brief By the index of the CPU the calling thread is running on
+   *        (with sched_getcpu() on Linux and GetCurrentProcessorNumber()
+   *        on Windows), so that the threads running on different CPUs
+   *        at the same time never share a shard (unless there are
+   *        more CPUs than shards). Falls back to per_thread on the
+   *        systems with no cheap way to get the current CPU
+   **/
+  current_cpu,
+
+  /**
+   * @brief By the calling thread: threads are assigned shards
+   *        round-robin on their first call and stick to them
+   **/
+  per_thread
+};
+
+/**
+ * @brief Configuration parameters for sharded_resource with valid
+ *        defaults
+ **/
+struct sharded_resource_config {
+  /**
+   * @brief The way the shard for an allocate() call is picked (see
+   *        shard_selection)
+   **/
+  const shard_selection selection = shard_selection::current_cpu;
+};
+
+/**
+ * @brief Memory resource adaptor that holds a number of instances
+ *        (shards) of a thread safe resource, each on its own cache
+ *        line, and forwards every allocation to one of them picked
+ *        by the current CPU or thread (see sharded_resource_config).
+ *        Thus concurrent threads mostly work with different instances
+ *        and don't contend on the same memory
+ *
+ * If the resource is interchangeable with itself (i.e., any instance
+ * can deallocate the memory allocated by another), the deallocate()
+ * calls are also forwarded to the shard of the calling CPU or thread.
+ * Otherwise, the region must be returned to the shard that has
+ * allocated it: a dispatch_deallocate(const sharded_resource&, void*,
+ * size_t, size_t) function returning its index can be declared (to be
+ * found by ADL), e.g., to find the shard by the address if every one
+ * allocates from its own range. If no such function exists, the
+ * default deallocate() method will be unavailable (thus, the adaptor
+ * won't model the resource concept) and one should use do_allocate()
+ * and deallocate_with() (that take and return the shard index)
+ * instead.
+ **/
+template <resource R, size_t _shards_count,
+          sharded_resource_config _config = {}>
+  requires(thread_safe_resource<R> && _shards_count > 0)
+class sharded_resource {
+public:
+  /**
+   * @brief The type of the shards (a template parameter)
+   **/
+  using shard_t = R;
+
+  /**
+   * @brief The number of the shards (a template parameter)
+   **/
+  constexpr static size_t shards_count = _shards_count;
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const sharded_resource_config& config = _config;
+
+  /**
+   * @brief Specifies if any shard can deallocate the memory allocated
+   *        by the others (in which case the deallocations are spread
+   *        among the shards the same way the allocations are)
+   **/
+  constexpr static bool has_interchangeable_shards =
+    interchangeable_resource_with<shard_t, shard_t>;
+
+  constexpr static bool is_granular = granular_resource<shard_t>;
+  constexpr static bool is_thread_safe = true;
+
+  /**
+   * @brief Specifies if the adaptor is sweeping. Adjacent regions may
+   *        come from different shards, so this requires the shards
+   *        to be interchangeable as well
+   **/
+  constexpr static bool is_sweeping =
+    sweeping_resource<shard_t> && has_interchangeable_shards;
+
+  constexpr static bool has_equal_instances =
+    __detail::equal_instances<shard_t>;
+
+  template <resource T>
+  constexpr static bool is_interchangeable_with =
+    has_interchangeable_shards && interchangeable_resource_with<shard_t, T>;
+
+  template <resource T>
+  constexpr static bool is_substitutable_for =
+    has_interchangeable_shards && substitutable_resource_for<shard_t, T>;
+
+  /**
+   * @brief Returns the minimum allocation size of the shards (is only
+   *        defined if they are bound)
+   **/
+  constexpr static size_t min_size() noexcept
+    requires(bound_resource<shard_t>) {
+    return shard_t::min_size();
+  }
+
+  /**
+   * @brief Returns the guaranteed alignment of the shards (is only
+   *        defined if they are overaligning)
+   **/
+  constexpr static pow2_t guaranteed_alignment() noexcept
+    requires(overaligning_resource<shard_t>) {
+    return shard_t::guaranteed_alignment();
+  }
+
+  /**
+   * @brief Default constructs all the shards
+   **/
+  constexpr sharded_resource()
+    noexcept(std::is_nothrow_default_constructible_v<shard_t>)
+    requires(std::default_initializable<shard_t>) {}
+
+  /**
+   * @brief Constructs every shard from the result of make(i), where i
+   *        is its index (e.g., to give each one its own upstream)
+   **/
+  template <std::invocable<size_t> F>
+    requires(std::same_as<std::invoke_result_t<F&, size_t>, shard_t>)
+  explicit constexpr sharded_resource(F&& make)
+    noexcept(std::is_nothrow_invocable_v<F&, size_t>):
+    sharded_resource(make, std::make_index_sequence<shards_count>{}) {}
+
+  sharded_resource(const sharded_resource&) = delete;
+  sharded_resource& operator=(const sharded_resource&) = delete;
+  sharded_resource& operator=(sharded_resource&&) = delete;
+
+  /**
+   * @brief Move constructs all the shards
+   * @note  The operation is not thread safe
+   **/
+  constexpr sharded_resource(sharded_resource&&)
+    noexcept(std::is_nothrow_move_constructible_v<shard_t>) = default;
+
+  /**
+   * @brief Returns the shard at the given index
+   **/
+  shard_t& shard(const size_t idx) noexcept {
+    return shards_[idx].resource;
+  }
+
+  const shard_t& shard(const size_t idx) const noexcept {
+    return shards_[idx].resource;
+  }
+
+  /**
+   * @brief Returns the index of the shard the calling thread would
+   *        use right now
+   **/
+  inline static size_t current_shard() noexcept;
+
+  /**
+   * @brief Forwards the call to the shard of the calling CPU or thread
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size, const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_allocate<shard_t>) {
+    return shard(current_shard()).allocate(size, alignment);
+  }
+
+  /**
+   * @brief Same as allocate() but returns a pair of the resulting
+   *        pointer and the index of the shard that performed the
+   *        allocation (to be passed to deallocate_with() later)
+   **/
+  [[nodiscard]] std::pair<void*, size_t> do_allocate
+    (const size_t size, const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_allocate<shard_t>) {
+    const auto idx = current_shard();
+    return { shard(idx).allocate(size, alignment), idx };
+  }
+
+  /**
+   * @brief Forwards the call to the allocate_batch() of the shard of
+   *        the calling CPU or thread (is only defined if the shards
+   *        have the method)
+   **/
+  size_t allocate_batch(const size_t count, const size_t size,
+                        const size_t alignment, void** const out) noexcept
+    requires(__detail::has_batch_allocate<shard_t>) {
+    return shard(current_shard()).allocate_batch(count, size, alignment, out);
+  }
+
+  /**
+   * @brief Deallocates memory previously allocated by the adaptor. If
+   *        the shards are interchangeable, forwards the call to the
+   *        shard of the calling CPU or thread. Otherwise, uses the
+   *        dispatch_deallocate() function to get the index of the
+   *        shard, and is only defined if such function is declared
+   **/
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_deallocate<shard_t>
+             && (has_interchangeable_shards
+                 || __detail::has_nothrow_dispatcher<sharded_resource>))
+    requires(has_interchangeable_shards
+             || __detail::has_dispatcher<sharded_resource>) {
+    if constexpr (has_interchangeable_shards)
+      shard(current_shard()).deallocate(ptr, size, alignment);
+    else
+      deallocate_with(dispatch_deallocate(*this, ptr, size, alignment),
+                      ptr, size, alignment);
+  }
+
+  /**
+   * @brief Deallocates memory previously allocated by the adaptor by
+   *        forwarding the call to the shard at the given index
+   **/
+  void deallocate_with(const size_t idx, void* const ptr, const size_t size,
+                       const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_deallocate<shard_t>) {
+    shard(idx).deallocate(ptr, size, alignment);
+  }
+
+  /**
+   * @brief Forwards the call to the deallocate_batch() of the shard of
+   *        the calling CPU or thread (is only defined if the shards
+   *        have the method and are interchangeable)
+   **/
+  void deallocate_batch(const size_t count, const size_t size,
+                        const size_t alignment,
+                        void* const* const ptrs) noexcept
+    requires(__detail::has_batch_deallocate<shard_t>
+             && has_interchangeable_shards) {
+    shard(current_shard()).deallocate_batch(count, size, alignment, ptrs);
+  }
+
+  /**
+   * @brief Forwards the call to the purge() of the shard of the
+   *        calling CPU or thread (is only defined if the shards are
+   *        purging and interchangeable)
+   **/
+  void purge(void* const ptr, const size_t size) noexcept
+    requires(purging_resource<shard_t> && has_interchangeable_shards) {
+    shard(current_shard()).purge(ptr, size);
+  }
+
+  constexpr bool operator==(const sharded_resource& rhs) const
+    noexcept(__detail::nothrow_equality_comparable<shard_t>)
+    requires(!has_equal_instances) {
+    for (size_t i = 0; i < shards_count; ++i)
+      if (!(shards_[i].resource == rhs.shards_[i].resource)) return false;
+    return true;
+  }
+
+private:
+  struct alignas(__detail::cache_line_size) padded_shard_t {
+    shard_t resource;
+  };
+
+  template <typename F, size_t... Is>
+  constexpr sharded_resource(F& make, std::index_sequence<Is...>):
+    shards_{ padded_shard_t{ make(Is) }... } {}
+
+  std::array<padded_shard_t, shards_count> shards_;
+};
+
+template <resource R, size_t _shards_count, sharded_resource_config _config>
+  requires(thread_safe_resource<R> && _shards_count > 0)
+size_t sharded_resource<R, _shards_count, _config>::current_shard() noexcept {
+  if constexpr (shards_count == 1) return 0;
+  else {
+    if constexpr (_config.selection == shard_selection::current_cpu)
+      if (const auto cpu = __detail::os_info_t::get_current_cpu())
+        [[likely]] return *cpu % shards_count;
+
+    // NB: the thread indices are shared among all instances of the type
+    return __detail::get_thread_index<sharded_resource>() % shards_count;
+  }
+}
+
+} // namespace memaw
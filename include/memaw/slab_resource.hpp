@@ -0,0 +1,203 @@
+#pragma once
+#include <concepts>
+#include <type_traits>
+
+#include "concepts.hpp"
+#include "literals.hpp"
+
+#include "__detail/slab_resource_impl.hpp"
+
+/**
+ * @file
+ * A resource for small objects of a fixed size that allocates aligned
+ * slabs from the underlying resource and keeps the free slots of each
+ * slab in its own list
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Configuration parameters for slab_resource with valid
+ *        defaults
+ **/
+struct slab_resource_config {
+  /**
+   * @brief The size of a slab, which is also its alignment (so that
+   *        the slab header can be found by an object address)
+   **/
+  const pow2_t slab_size = pow2_t{64_KiB};
+
+  /**
+   * @brief The size of a block requested from the upstream (with the
+   *        alignment of slab_size) at once. Must be a multiple of
+   *        slab_size
+   * @note  Only the first slab of a block is touched right away, the
+   *        rest are initialized when they are needed
+   **/
+  const size_t block_size = 1_MiB;
+
+  /**
+   * @brief Thread safety policy: if set to true, the implementation
+   *        will use atomic instructions to manage its internal
+   *        structures (DWCAS, or packed tagged pointers if
+   *        MEMAW_USE_DWCAS is defined as 0). The thread safe
+   *        implementation is lock-free
+   * @note  If the underlying resource is not thread safe, setting this
+   *        parameter to true will change the type of instructions
+   *        used but won't make the slab resource thread safe either
+   **/
+  const bool thread_safe = true;
+};
+
+/**
+ * @brief Memory resource that allocates objects of (up to) a single
+ *        fixed size densely packed in slabs. The slabs are allocated
+ *        from the upstream resource in blocks, aligned by their size,
+ *        and have a header with the list of their free slots, so
+ *        there is no per-object overhead (unlike with pool_resource,
+ *        the object size only needs to be a multiple of
+ *        alignof(std::max_align_t)). A deallocated slot goes back to
+ *        its own slab, which keeps the live objects close to each
+ *        other. As with pool_resource, the memory is not returned to
+ *        the upstream until this resource is destructed
+ *
+ * Objects of several sizes can be served by a tree of segregators,
+ * e.g.:
+ *
+ *   segregator_resource<32, slab_resource<R, 32>,
+ *                       segregator_resource<64, slab_resource<R, 64>,
+ *                                           pool_resource<R>>>
+ *
+ * @note  The thread safe implementation takes the slots from the
+ *        slab on the top of the shared list of the ones with free
+ *        space, so every allocation and deallocation is one (DW)CAS
+ **/
+template <resource R, size_t _object_size,
+          slab_resource_config _config = slab_resource_config{
+            .thread_safe = thread_safe_resource<R>
+          }>
+class slab_resource {
+  using impl_t = __detail::slab_resource_impl<R, _object_size, _config>;
+
+public:
+  static_assert(_object_size > 0
+                && _object_size % alignof(std::max_align_t) == 0,
+                "The object size must be a multiple of "
+                "alignof(std::max_align_t)");
+  static_assert(_config.block_size % _config.slab_size == 0);
+  static_assert(impl_t::slots_per_slab > 0,
+                "The slab is too small for an object");
+
+  /**
+   * @brief The underlying resource to allocate memory from
+   **/
+  using upstream_t = R;
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const slab_resource_config& config = _config;
+
+  /**
+   * @brief The (maximum) size of an object (a template parameter)
+   **/
+  constexpr static size_t object_size = _object_size;
+
+  /**
+   * @brief The number of objects that fit into a slab
+   **/
+  constexpr static size_t slots_per_slab = impl_t::slots_per_slab;
+
+  constexpr static bool is_thread_safe =
+    _config.thread_safe && thread_safe_resource<upstream_t>;
+
+  /**
+   * @brief Returns the alignment of every object: the biggest power
+   *        of 2 that divides the object size (if that is more than
+   *        alignof(std::max_align_t))
+   **/
+  constexpr static pow2_t guaranteed_alignment() noexcept
+    requires(impl_t::object_alignment > alignof(std::max_align_t)) {
+    return impl_t::object_alignment;
+  }
+
+  constexpr slab_resource()
+    noexcept(std::is_nothrow_default_constructible_v<upstream_t>)
+    requires(std::default_initializable<upstream_t>) {}
+
+  constexpr slab_resource(upstream_t&& upstream)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    impl_(std::move(upstream)) {}
+
+  slab_resource(const slab_resource&) = delete;
+  slab_resource& operator=(const slab_resource&) = delete;
+  slab_resource& operator=(slab_resource&&) = delete;
+
+  /**
+   * @brief Move constructs the resource leaving rhs in an empty but
+   *        valid state (as long as the same is true for the upstream
+   *        resource)
+   * @note  The operation is not thread safe even if the resources are
+   *        configured as such. All memory allocated by the rhs
+   *        resource and not deallocated before the move must be
+   *        deallocated through the new instance
+   **/
+  constexpr slab_resource(slab_resource&& rhs)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>) = default;
+
+  /**
+   * @brief Allocates a slot for an object, calling the upstream
+   *        allocate() if all the slabs are full
+   * @param size must not be greater than object_size (the whole slot
+   *        is allocated anyway), otherwise the allocation fails
+   * @param alignment must be a power of 2 not greater than the
+   *        alignment of the slots, otherwise the allocation fails
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size,
+     const size_t alignment = alignof(std::max_align_t)) noexcept {
+    if (size > _object_size || alignment > impl_t::object_alignment)
+      [[unlikely]] return nullptr;
+
+    return impl_.allocate();
+  }
+
+  /**
+   * @brief Returns the slot to the free list of its slab. The
+   *        deallocate() call on the upstream resource happens only on
+   *        destruction
+   **/
+  void deallocate(void* const ptr, const size_t,
+                  const size_t = alignof(std::max_align_t)) noexcept {
+    impl_.deallocate(ptr); // NB: size and alignment are ignored
+  }
+
+  /**
+   * @brief Returns the number of free slots in all the slabs
+   *        allocated so far
+   * @note  Not thread safe: must only be called at quiescent points,
+   *        i.e., with no other calls on the resource in progress
+   **/
+  size_t count_free_slots() noexcept {
+    return impl_.count_free_slots();
+  }
+
+  /**
+   * @brief Returns the underlying resource (e.g., to get the
+   *        statistics of the upstream allocations if it is a
+   *        stats_resource)
+   **/
+  const upstream_t& upstream() const noexcept {
+    return impl_.get_upstream();
+  }
+
+  bool operator==(const slab_resource&) const noexcept = default;
+
+private:
+  impl_t impl_;
+};
+
+} // namespace memaw
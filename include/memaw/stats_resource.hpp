@@ -0,0 +1,366 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "literals.hpp"
+#include "resource_traits.hpp"
+
+#include "__detail/adaptor_base.hpp"
+#include "__detail/base.hpp"
+#include "__detail/mem_ref.hpp"
+#include "__detail/thread_index.hpp"
+
+/**
+ * @file
+ * A resource adaptor that collects the statistics of allocations made
+ * through it
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Configuration parameters for stats_resource with valid
+ *        defaults
+ **/
+struct stats_resource_config {
+  /**
+   * @brief The number of independent sets of counters. Threads are
+   *        spread among them so that they rarely write to the same
+   *        cache line. Ignored (i.e., always 1) if the underlying
+   *        resource is not thread safe
+   **/
+  const size_t shards_count = 8;
+
+  /**
+   * @brief The maximum (absolute) change of the live bytes a single
+   *        set of counters accumulates before adding it to the shared
+   *        value the peak is computed from. Thus the reported peak
+   *        may differ from the real one by at most shards_count times
+   *        this value (but never if the resource is not thread safe)
+   **/
+  const size_t peak_granularity = 64_KiB;
+};
+
+/**
+ * @brief A snapshot of the statistics collected by stats_resource
+ **/
+struct resource_stats {
+  /**
+   * @brief The number of buckets in the size histogram (one for every
+   *        possible ceiled power of 2 of the size)
+   **/
+  constexpr static size_t histogram_size =
+    std::numeric_limits<size_t>::digits + 1;
+
+  size_t allocations;         // successful allocate() calls
+  size_t failed_allocations;  // allocate() calls that failed or threw
+  size_t deallocations;       // deallocate() calls
+
+  size_t allocated_bytes;     // the sum of the sizes of all allocations
+  size_t deallocated_bytes;   // the sum of the sizes of all deallocations
+
+  /**
+   * @brief The number of bytes allocated and not yet deallocated
+   *        (i.e., allocated_bytes - deallocated_bytes)
+   **/
+  size_t live_bytes;
+
+  /**
+   * @brief The (approximate, see
+   *        stats_resource_config::peak_granularity) maximum of
+   *        live_bytes ever reached
+   **/
+  size_t peak_bytes;
+
+  /**
+   * @brief The i-th element is the number of successful allocations
+   *        with the size in the range (2^(i-1), 2^i] (the first one
+   *        also counts the allocations of 0 bytes)
+   **/
+  std::array<size_t, histogram_size> size_histogram;
+};
+
+/**
+ * @brief Memory resource adaptor that forwards all the calls to the
+ *        underlying resource and counts the allocations and
+ *        deallocations (see resource_stats for the list of values)
+ *
+ * The counters are updated with relaxed atomics (if the upstream is
+ * thread safe) in one of the several cache-line-aligned shards picked
+ * by the calling thread, so the adaptor doesn't become a contention
+ * point. The numbers are exact once all the calls have returned.
+ *
+ * Since the adaptor models all the same concepts as the upstream, it
+ * can also be put under another adaptor to see what that one requests
+ * from its upstream, e.g., the number and the size of the blocks
+ * allocated by a pool:
+ *
+ *   pool_resource<stats_resource<regular_pages_resource>> pool;
+ *   ...
+ *   const auto stats = pool.upstream().get_stats();
+ **/
+template <resource R, stats_resource_config _config = {}>
+class stats_resource: public __detail::adaptor_base<R> {
+  using base_t = __detail::adaptor_base<R>;
+
+public:
+  static_assert(_config.shards_count > 0);
+  static_assert(_config.peak_granularity > 0);
+
+  using typename base_t::upstream_t;
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const stats_resource_config& config = _config;
+
+  constexpr stats_resource()
+    noexcept(std::is_nothrow_default_constructible_v<upstream_t>)
+    requires(std::default_initializable<upstream_t>) {}
+
+  constexpr stats_resource(upstream_t&& upstream)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    base_t(std::move(upstream)) {}
+
+  stats_resource(const stats_resource&) = delete;
+  stats_resource& operator=(const stats_resource&) = delete;
+  stats_resource& operator=(stats_resource&&) = delete;
+
+  /**
+   * @brief Move constructs the resource (with the upstream moved and
+   *        the statistics copied)
+   * @note  The operation is not thread safe
+   **/
+  constexpr stats_resource(stats_resource&& rhs)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>) = default;
+
+  /**
+   * @brief Returns the current values of the counters. May be called
+   *        concurrently with the allocations (in which case the
+   *        values are not necessarily consistent with each other)
+   **/
+  inline resource_stats get_stats() const noexcept;
+
+  /**
+   * @brief Forwards the call to the upstream allocate() and counts
+   *        the result. If the upstream throws, that is counted as a
+   *        failure
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size, const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_allocate<upstream_t>) {
+    auto& shard = get_shard();
+
+    void* result;
+#ifdef __cpp_exceptions
+    if constexpr (!__detail::has_nothrow_allocate<upstream_t>) {
+      try {
+        result = upstream_.allocate(size, alignment);
+      } catch (...) {
+        add(shard.failed_allocations, 1);
+        throw;
+      }
+    }
+    else
+#endif
+      result = upstream_.allocate(size, alignment);
+
+    if (result) [[likely]] on_allocate(shard, 1, size);
+    else add(shard.failed_allocations, 1);
+    return result;
+  }
+
+  /**
+   * @brief Forwards the call to the upstream allocate_batch() and
+   *        counts the result (is only defined if the upstream has the
+   *        method)
+   **/
+  size_t allocate_batch(const size_t count, const size_t size,
+                        const size_t alignment, void** const out) noexcept
+    requires(__detail::has_batch_allocate<upstream_t>) {
+    auto& shard = get_shard();
+
+    const auto result = upstream_.allocate_batch(count, size, alignment, out);
+    if (result) [[likely]] on_allocate(shard, result, size);
+    if (result < count) [[unlikely]] add(shard.failed_allocations, 1);
+    return result;
+  }
+
+  /**
+   * @brief Forwards the call to the upstream deallocate() and counts
+   *        it
+   **/
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_deallocate<upstream_t>) {
+    upstream_.deallocate(ptr, size, alignment);
+    on_deallocate(get_shard(), 1, size);
+  }
+
+  /**
+   * @brief Forwards the call to the upstream deallocate_batch() and
+   *        counts the (non-null) regions (is only defined if the
+   *        upstream has the method)
+   **/
+  void deallocate_batch(const size_t count, const size_t size,
+                        const size_t alignment,
+                        void* const* const ptrs) noexcept
+    requires(__detail::has_batch_deallocate<upstream_t>) {
+    upstream_.deallocate_batch(count, size, alignment, ptrs);
+
+    size_t deallocated = 0;
+    for (size_t i = 0; i < count; ++i) deallocated+= (ptrs[i] != nullptr);
+    if (deallocated) on_deallocate(get_shard(), deallocated, size);
+  }
+
+private:
+  using base_t::upstream_;
+
+  constexpr static auto thread_safety =
+    base_t::is_thread_safe ? __detail::thread_safe : __detail::thread_unsafe;
+
+  constexpr static size_t shards_count =
+    base_t::is_thread_safe ? _config.shards_count : 1;
+
+  // Without concurrency the peak can be tracked exactly
+  constexpr static size_t peak_granularity =
+    base_t::is_thread_safe ? _config.peak_granularity : 1;
+
+  struct alignas(__detail::cache_line_size) shard_t {
+    size_t allocations;
+    size_t failed_allocations;
+    size_t deallocations;
+    size_t allocated_bytes;
+    size_t deallocated_bytes;
+
+    // The (signed, two's complement) change of the live bytes not yet
+    // added to live_bytes_
+    size_t pending_bytes;
+
+    std::array<size_t, resource_stats::histogram_size> size_histogram;
+  };
+
+  static size_t get_size_class(const size_t size) noexcept {
+    return size ? std::bit_width(size - 1) : 0;
+  }
+
+  static size_t load(size_t& value) noexcept {
+    return __detail::make_mem_ref<thread_safety>(value)
+      .load(__detail::mo_t::relaxed);
+  }
+
+  static size_t add(size_t& value, const size_t delta) noexcept {
+    return __detail::make_mem_ref<thread_safety>(value)
+      .fetch_add(delta, __detail::mo_t::relaxed) + delta;
+  }
+
+  inline shard_t& get_shard() noexcept;
+
+  inline void on_allocate(shard_t&, size_t, size_t) noexcept;
+  inline void on_deallocate(shard_t&, size_t, size_t) noexcept;
+
+  /**
+   * @brief Adds the (signed) delta to the pending bytes of the shard
+   *        and, if they get too big, adds them to live_bytes_ and
+   *        updates the peak
+   **/
+  inline void update_live(shard_t&, size_t) noexcept;
+
+
+  // NB: the counters are mutable for the atomic loads in get_stats()
+  mutable std::array<shard_t, shards_count> shards_ = {};
+
+  // Both are written rarely (once per peak_granularity bytes), so they
+  // share their own cache line
+  mutable struct alignas(__detail::cache_line_size) {
+    size_t live_bytes;  // signed, two's complement
+    size_t peak_bytes;
+  } totals_ = {};
+};
+
+template <resource R, stats_resource_config _config>
+auto stats_resource<R, _config>::get_shard() noexcept -> shard_t& {
+  if constexpr (shards_count == 1) return shards_[0];
+  else {
+    // NB: the thread indices are shared among all instances of the type
+    return shards_[__detail::get_thread_index<stats_resource>()
+                   % shards_count];
+  }
+}
+
+template <resource R, stats_resource_config _config>
+void stats_resource<R, _config>::on_allocate(shard_t& shard,
+                                             const size_t count,
+                                             const size_t size) noexcept {
+  add(shard.allocations, count);
+  add(shard.allocated_bytes, count * size);
+  add(shard.size_histogram[get_size_class(size)], count);
+  update_live(shard, count * size);
+}
+
+template <resource R, stats_resource_config _config>
+void stats_resource<R, _config>::on_deallocate(shard_t& shard,
+                                               const size_t count,
+                                               const size_t size) noexcept {
+  add(shard.deallocations, count);
+  add(shard.deallocated_bytes, count * size);
+  update_live(shard, -(count * size));
+}
+
+template <resource R, stats_resource_config _config>
+void stats_resource<R, _config>::update_live(shard_t& shard,
+                                             const size_t delta) noexcept {
+  using __detail::make_mem_ref;
+  using __detail::mo_t;
+
+  const auto pending = std::ptrdiff_t(add(shard.pending_bytes, delta));
+  if (static_cast<size_t>(pending < 0 ? -pending : pending)
+      < peak_granularity) [[likely]] return;
+
+  // Take all of the pending bytes, whatever they are by now
+  const auto flushed = make_mem_ref<thread_safety>(shard.pending_bytes)
+    .exchange(0, mo_t::relaxed);
+
+  const auto live = std::ptrdiff_t(add(totals_.live_bytes, flushed));
+  if (live <= 0) return;
+
+  const auto peak_ref = make_mem_ref<thread_safety>(totals_.peak_bytes);
+  auto peak = peak_ref.load(mo_t::relaxed);
+  while (size_t(live) > peak
+         && !peak_ref.compare_exchange_weak(peak, size_t(live),
+                                            mo_t::relaxed, mo_t::relaxed));
+}
+
+template <resource R, stats_resource_config _config>
+resource_stats stats_resource<R, _config>::get_stats() const noexcept {
+  resource_stats result = {};
+  for (auto& shard : shards_) {
+    result.allocations+= load(shard.allocations);
+    result.failed_allocations+= load(shard.failed_allocations);
+    result.deallocations+= load(shard.deallocations);
+    result.allocated_bytes+= load(shard.allocated_bytes);
+    result.deallocated_bytes+= load(shard.deallocated_bytes);
+
+    for (size_t i = 0; i < resource_stats::histogram_size; ++i)
+      result.size_histogram[i]+= load(shard.size_histogram[i]);
+  }
+
+  result.live_bytes = result.allocated_bytes - result.deallocated_bytes;
+
+  // The peak may be behind by the still pending bytes
+  result.peak_bytes = std::max(load(totals_.peak_bytes), result.live_bytes);
+  return result;
+}
+
+} // namespace memaw
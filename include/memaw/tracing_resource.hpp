@@ -0,0 +1,310 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "concepts.hpp"
+#include "resource_traits.hpp"
+
+#include "__detail/adaptor_base.hpp"
+#include "__detail/base.hpp"
+#include "__detail/mem_ref.hpp"
+#include "__detail/thread_registry.hpp"
+
+/**
+ * @file
+ * A resource adaptor that writes a binary trace of the allocations
+ * made through it
+ *
+ * @author    patternnoster@github
+ * @copyright 2023, under the MIT License (see /LICENSE for details)
+ **/
+
+namespace memaw {
+
+/**
+ * @brief Configuration parameters for tracing_resource with valid
+ *        defaults
+ **/
+struct tracing_resource_config {
+  /**
+   * @brief The number of records every thread accumulates before
+   *        writing them to the file (with a single fwrite() call)
+   **/
+  const size_t buffer_size = 4096;
+};
+
+/**
+ * @brief The kinds of calls recorded by tracing_resource
+ **/
+enum class trace_event : uint8_t {
+  allocate,         // a successful allocation
+  deallocate,       // a deallocation
+  failed_allocate   // an allocation that returned nullptr or threw
+};
+
+/**
+ * @brief A single record of the trace written by tracing_resource.
+ *        The trace file is just an array of these (in the native byte
+ *        order), with the records of every thread in the order of the
+ *        calls, but the threads' buffers interleaved arbitrarily (so
+ *        the records are to be stably sorted by timestamp first)
+ **/
+struct trace_record {
+  uint64_t timestamp;     // nanoseconds since the resource construction
+  uint64_t address;       // the allocated (or deallocated) pointer
+  uint64_t size;
+  uint32_t thread;        // the index of the thread (in the order of
+                          // their first calls to the resource)
+  uint8_t alignment_log;  // the base 2 logarithm of the alignment
+  trace_event event;
+  uint16_t reserved;      // always 0
+};
+
+static_assert(sizeof(trace_record) == 32);
+
+/**
+ * @brief Memory resource adaptor that forwards all the calls to the
+ *        underlying resource and records them to a binary trace file
+ *        (see trace_record) for the offline analysis, e.g., with the
+ *        memaw_replay tool from the benchmarks
+ *
+ * Every thread puts the records into its own buffer (without any
+ * synchronization), which is written to the file with a single
+ * fwrite() call once full (relying on the stdio locking). The remains
+ * of the buffers are written by flush() and in the destructor. The
+ * file is not owned by the adaptor and must stay open until then.
+ *
+ * The threads are indexed in the order of their first calls. The
+ * buffer of a thread that has exited (along with its index) is taken
+ * over by the next thread with the same id.
+ *
+ * The adaptor models all the same concepts as the upstream, so it can
+ * also be put under another adaptor to trace what that one requests
+ * from its upstream.
+ **/
+template <resource R, tracing_resource_config _config = {}>
+class tracing_resource: public __detail::adaptor_base<R> {
+  using base_t = __detail::adaptor_base<R>;
+
+public:
+  static_assert(_config.buffer_size > 0);
+
+  using typename base_t::upstream_t;
+
+  /**
+   * @brief The configuration parameters of the resource
+   **/
+  constexpr static const tracing_resource_config& config = _config;
+
+  /**
+   * @brief Constructs the resource writing the trace to the given file
+   *        (opened for binary writing) with the upstream default
+   *        constructed
+   **/
+  explicit tracing_resource(std::FILE* const file)
+    noexcept(std::is_nothrow_default_constructible_v<upstream_t>)
+    requires(std::default_initializable<upstream_t>): file_(file) {}
+
+  /**
+   * @brief Constructs the resource writing the trace to the given file
+   *        (opened for binary writing) with the upstream move
+   *        constructed
+   **/
+  tracing_resource(std::FILE* const file, upstream_t&& upstream)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    base_t(std::move(upstream)), file_(file) {}
+
+  tracing_resource(const tracing_resource&) = delete;
+  tracing_resource& operator=(const tracing_resource&) = delete;
+  tracing_resource& operator=(tracing_resource&&) = delete;
+
+  /**
+   * @brief Move constructs the resource (taking over the file and the
+   *        buffered records of rhs, which stops tracing)
+   * @note  The operation is not thread safe
+   **/
+  tracing_resource(tracing_resource&& rhs)
+    noexcept(std::is_nothrow_move_constructible_v<upstream_t>):
+    base_t(std::move(rhs)),
+    file_(std::exchange(rhs.file_, nullptr)),
+    start_(rhs.start_),
+    last_thread_(rhs.last_thread_),
+    buffers_(std::move(rhs.buffers_)) {}
+
+  /**
+   * @brief Writes the remaining records to the file
+   **/
+  ~tracing_resource() noexcept {
+    flush();
+    buffers_.clear([](void* const ptr) noexcept {
+      ::operator delete(ptr);
+    });
+  }
+
+  /**
+   * @brief Writes the buffered records of all the threads to the file
+   *        and flushes it. Returns false if any write to the file has
+   *        failed so far
+   * @note  Not thread safe: must only be called at quiescent points,
+   *        i.e., with no other calls on the resource in progress
+   **/
+  inline bool flush() noexcept;
+
+  /**
+   * @brief Forwards the call to the upstream allocate() and records
+   *        the result. If the upstream throws, that is recorded as a
+   *        failure
+   **/
+  [[nodiscard]] void* allocate
+    (const size_t size, const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_allocate<upstream_t>) {
+    void* result;
+#ifdef __cpp_exceptions
+    if constexpr (!__detail::has_nothrow_allocate<upstream_t>) {
+      try {
+        result = upstream_.allocate(size, alignment);
+      } catch (...) {
+        record(trace_event::failed_allocate, nullptr, size, alignment);
+        throw;
+      }
+    }
+    else
+#endif
+      result = upstream_.allocate(size, alignment);
+
+    record(result ? trace_event::allocate : trace_event::failed_allocate,
+           result, size, alignment);
+    return result;
+  }
+
+  /**
+   * @brief Forwards the call to the upstream allocate_batch() and
+   *        records every allocated region (and a failure if there are
+   *        less than count of them). Is only defined if the upstream
+   *        has the method
+   **/
+  size_t allocate_batch(const size_t count, const size_t size,
+                        const size_t alignment, void** const out) noexcept
+    requires(__detail::has_batch_allocate<upstream_t>) {
+    const auto result = upstream_.allocate_batch(count, size, alignment, out);
+
+    for (size_t i = 0; i < result; ++i)
+      record(trace_event::allocate, out[i], size, alignment);
+    if (result < count) [[unlikely]]
+      record(trace_event::failed_allocate, nullptr, size, alignment);
+
+    return result;
+  }
+
+  /**
+   * @brief Records the call and forwards it to the upstream
+   *        deallocate()
+   * @note  The record is made first, so that its timestamp precedes
+   *        the one of any following allocation of the same address
+   *        (by another thread)
+   **/
+  void deallocate(void* const ptr, const size_t size,
+                  const size_t alignment = alignof(std::max_align_t))
+    noexcept(__detail::has_nothrow_deallocate<upstream_t>) {
+    record(trace_event::deallocate, ptr, size, alignment);
+    upstream_.deallocate(ptr, size, alignment);
+  }
+
+  /**
+   * @brief Records every (non-null) region and forwards the call to
+   *        the upstream deallocate_batch() (see deallocate()). Is only
+   *        defined if the upstream has the method
+   **/
+  void deallocate_batch(const size_t count, const size_t size,
+                        const size_t alignment,
+                        void* const* const ptrs) noexcept
+    requires(__detail::has_batch_deallocate<upstream_t>) {
+    for (size_t i = 0; i < count; ++i)
+      if (ptrs[i]) record(trace_event::deallocate, ptrs[i], size, alignment);
+
+    upstream_.deallocate_batch(count, size, alignment, ptrs);
+  }
+
+private:
+  using clock_t = std::chrono::steady_clock;
+
+  struct buffer_t {
+    uint32_t thread;  // plus one, 0 until the first record
+    size_t count;
+    std::array<trace_record, _config.buffer_size> records;
+  };
+
+  inline void record(trace_event, const void*, size_t, size_t) noexcept;
+
+  // Writes the buffered records (if any) and empties the buffer
+  inline void write(buffer_t&) noexcept;
+
+  using base_t::upstream_;
+
+  std::FILE* file_;
+  clock_t::time_point start_ = clock_t::now();
+
+  uint32_t last_thread_ = 0;
+
+  // NB: the buffers are allocated from the global heap, so that they
+  // don't show up in the trace of an adaptor put under this one
+  __detail::thread_registry<buffer_t> buffers_;
+};
+
+template <resource R, tracing_resource_config _config>
+void tracing_resource<R, _config>::record(const trace_event event,
+                                          const void* const ptr,
+                                          const size_t size,
+                                          const size_t alignment) noexcept {
+  if (!file_) [[unlikely]] return;
+
+  const auto buffer = buffers_.get([](const size_t size) noexcept {
+    return ::operator new(size, std::nothrow);
+  });
+  if (!buffer) [[unlikely]] return;  // Nothing to do but drop the record
+
+  if (!buffer->thread) [[unlikely]]
+    buffer->thread = __detail::make_mem_ref<__detail::thread_safe>
+      (last_thread_).fetch_add(1, __detail::mo_t::relaxed) + 1;
+
+  const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>
+    (clock_t::now() - start_).count();
+
+  buffer->records[buffer->count++] = {
+    .timestamp = uint64_t(timestamp),
+    .address = uint64_t(uintptr_t(ptr)),
+    .size = uint64_t(size),
+    .thread = buffer->thread - 1,
+    .alignment_log = uint8_t(std::countr_zero(alignment)),
+    .event = event,
+    .reserved = 0
+  };
+
+  if (buffer->count == _config.buffer_size) [[unlikely]] write(*buffer);
+}
+
+template <resource R, tracing_resource_config _config>
+void tracing_resource<R, _config>::write(buffer_t& buffer) noexcept {
+  if (buffer.count)
+    std::fwrite(buffer.records.data(), sizeof(trace_record),
+                buffer.count, file_);
+  buffer.count = 0;
+}
+
+template <resource R, tracing_resource_config _config>
+bool tracing_resource<R, _config>::flush() noexcept {
+  if (!file_) return true;
+
+  buffers_.for_each([this](buffer_t& buffer) noexcept { write(buffer); });
+  return std::fflush(file_) == 0 && !std::ferror(file_);
+}
+
+} // namespace memaw
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <list>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "memaw/allocator.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+using at_granular_t =
+  test_resource<resource_params{ .nothrow_alloc = true,
+                                 .nothrow_dealloc = true,
+                                 .min_size = 64, .is_granular = true }>;
+
+using at_pages_allocator_t = allocator<int, regular_pages_resource>;
+using at_pool_t = pool_resource<regular_pages_resource>;
+
+TEST(AllocatorTests, traits) {
+  // Empty resources with equal instances need not be stored
+  EXPECT_TRUE(at_pages_allocator_t::is_stateless);
+  EXPECT_TRUE(std::is_empty_v<at_pages_allocator_t>);
+  EXPECT_TRUE(std::allocator_traits<at_pages_allocator_t>
+              ::is_always_equal::value);
+  EXPECT_TRUE(std::is_default_constructible_v<at_pages_allocator_t>);
+
+  using pool_allocator_t = allocator<int, at_pool_t>;
+  EXPECT_FALSE(pool_allocator_t::is_stateless);
+  EXPECT_EQ(sizeof(pool_allocator_t), sizeof(void*));
+  EXPECT_FALSE(std::allocator_traits<pool_allocator_t>
+               ::is_always_equal::value);
+  EXPECT_FALSE(std::is_default_constructible_v<pool_allocator_t>);
+
+  using rebound_t = std::allocator_traits<pool_allocator_t>
+    ::rebind_alloc<double>;
+  EXPECT_TRUE((std::same_as<rebound_t, allocator<double, at_pool_t>>));
+}
+
+TEST(AllocatorTests, sizes) {
+  mock_resource mock;
+  at_granular_t res{mock};
+  allocator<uint32_t, at_granular_t> alloc{res};
+
+  const auto ptr = reinterpret_cast<uint32_t*>(uintptr_t(1_KiB));
+
+  // The sizes are ceiled to the granule, the alignment is the type's
+  EXPECT_CALL(mock, allocate(64, alignof(uint32_t))).WillOnce(Return(ptr));
+  EXPECT_CALL(mock, deallocate(ptr, 64, alignof(uint32_t))).Times(2);
+  EXPECT_CALL(mock, allocate(128, alignof(uint32_t)))
+    .WillOnce(Return(nullptr));
+
+  EXPECT_EQ(alloc.allocate(10), ptr);
+  alloc.deallocate(ptr, 10);
+  alloc.deallocate(ptr, 16);  // The full granule can also be freed
+
+  EXPECT_THROW((void)alloc.allocate(17), std::bad_alloc);
+  EXPECT_THROW((void)alloc.allocate(alloc.max_size() + 1),
+               std::bad_array_new_length);
+
+#ifdef __cpp_lib_allocate_at_least
+  EXPECT_CALL(mock, allocate(192, alignof(uint32_t))).WillOnce(Return(ptr));
+
+  const auto result = std::allocator_traits<decltype(alloc)>
+    ::allocate_at_least(alloc, 33);
+  EXPECT_EQ(result.ptr, ptr);
+  EXPECT_EQ(result.count, 48);
+#endif
+}
+
+TEST(AllocatorTests, equality) {
+  at_pool_t pool1, pool2;
+
+  allocator<int, at_pool_t> alloc1{pool1}, alloc2{pool2};
+  const allocator<double, at_pool_t> alloc3{alloc1};
+
+  EXPECT_EQ(alloc1, alloc1);
+  EXPECT_NE(alloc1, alloc2);
+  EXPECT_EQ(alloc1, alloc3);
+  EXPECT_EQ(&alloc3.resource(), &pool1);
+
+  EXPECT_EQ(at_pages_allocator_t{},
+            (allocator<char, regular_pages_resource>{}));
+}
+
+TEST(AllocatorTests, containers) {
+  at_pool_t pool;
+
+  std::vector<int, allocator<int, at_pool_t>> vec{pool};
+  for (int i = 0; i < 1000; ++i) vec.push_back(i);
+
+  std::list<int, allocator<int, at_pool_t>> list{pool};
+  for (int i = 0; i < 1000; ++i) list.push_back(i);
+
+  for (int i = 0; i < 1000; ++i) EXPECT_EQ(vec[i], i);
+  EXPECT_EQ(list.back(), 999);
+
+  std::vector<int, at_pages_allocator_t> pages_vec(1_KiB, 42);
+  EXPECT_EQ(pages_vec.back(), 42);
+  EXPECT_GE(pages_vec.capacity(), 1_KiB);
+}
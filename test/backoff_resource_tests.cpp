@@ -0,0 +1,142 @@
+#include <chrono>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "memaw/backoff_resource.hpp"
+#include "memaw/chain_resource.hpp"
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+using bot_upstream_t =
+  test_resource<resource_params{ .nothrow_alloc = true,
+                                 .nothrow_dealloc = true,
+                                 .min_size = 64, .alignment = 64,
+                                 .is_granular = true,
+                                 .is_thread_safe = true,
+                                 .group = {1, 1} }>;
+
+using bot_backoff_t =
+  backoff_resource<bot_upstream_t, backoff_resource_config{ .skip_calls = 3 }>;
+
+using bot_timed_t =
+  backoff_resource<bot_upstream_t,
+                   backoff_resource_config{ .skip_calls = 0,
+                                            .skip_microseconds = 50'000 }>;
+
+using bot_both_t =
+  backoff_resource<bot_upstream_t,
+                   backoff_resource_config{ .skip_calls = 10,
+                                            .skip_microseconds = 50'000 }>;
+
+TEST(BackoffResourceTests, concepts) {
+  EXPECT_TRUE(resource<bot_backoff_t>);
+  EXPECT_TRUE(nothrow_resource<bot_backoff_t>);
+  EXPECT_TRUE(granular_resource<bot_backoff_t>);
+  EXPECT_TRUE(overaligning_resource<bot_backoff_t>);
+  EXPECT_TRUE(thread_safe_resource<bot_backoff_t>);
+  EXPECT_FALSE(sweeping_resource<bot_backoff_t>);
+  EXPECT_FALSE(purging_resource<bot_backoff_t>);
+
+  EXPECT_EQ(bot_backoff_t::min_size(), 64);
+  EXPECT_EQ(bot_backoff_t::guaranteed_alignment(), 64);
+
+  EXPECT_FALSE(nothrow_resource<backoff_resource<test_resource<>>>);
+  EXPECT_FALSE(bound_resource<backoff_resource<test_resource<>>>);
+
+  EXPECT_TRUE((interchangeable_resource_with<bot_backoff_t, bot_upstream_t>));
+  EXPECT_TRUE((interchangeable_resource_with<bot_backoff_t, bot_timed_t>));
+
+  // Doesn't break the chain deallocation dispatch
+  using pages_backoff_t = backoff_resource<big_pages_resource>;
+  EXPECT_TRUE(sweeping_resource<pages_backoff_t>);
+  EXPECT_TRUE(purging_resource<pages_backoff_t>);
+  EXPECT_TRUE((interchangeable_resource_with<pages_backoff_t,
+                                             regular_pages_resource>));
+  EXPECT_TRUE((nothrow_resource<chain_resource<pages_backoff_t,
+                                               regular_pages_resource>>));
+}
+
+TEST(BackoffResourceTests, call_limit) {
+  mock_resource mock;
+  bot_backoff_t res{bot_upstream_t{mock}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  // After a failure the same size class is skipped for 3 calls...
+  EXPECT_CALL(mock, allocate(128, 64)).Times(2).WillRepeatedly(Return(nullptr));
+  EXPECT_EQ(res.allocate(128, 64), nullptr);
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(res.allocate(128, 64), nullptr);
+
+  // ... but other size classes are not
+  EXPECT_CALL(mock, allocate(64, _)).WillOnce(Return(ptr));
+  EXPECT_EQ(res.allocate(64), ptr);
+
+  // Then it's probed again and skipped again after a failure
+  EXPECT_EQ(res.allocate(128, 64), nullptr);
+  EXPECT_EQ(res.allocate(128, 64), nullptr);
+
+  // A probe that succeeds resets the state
+  for (int i = 0; i < 2; ++i) EXPECT_EQ(res.allocate(128, 64), nullptr);
+
+  EXPECT_CALL(mock, allocate(128, 64)).Times(2).WillRepeatedly(Return(ptr));
+  EXPECT_EQ(res.allocate(128, 64), ptr);
+  EXPECT_EQ(res.allocate(128, 64), ptr);
+
+  EXPECT_CALL(mock, deallocate(ptr, 128, 64));
+  res.deallocate(ptr, 128, 64);
+}
+
+TEST(BackoffResourceTests, time_limit) {
+  mock_resource mock;
+  bot_timed_t res{bot_upstream_t{mock}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  EXPECT_CALL(mock, allocate(256, _)).WillOnce(Return(nullptr));
+  EXPECT_EQ(res.allocate(256), nullptr);
+  for (int i = 0; i < 100; ++i) EXPECT_EQ(res.allocate(256), nullptr);
+
+  // Skipped until the time runs out
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_CALL(mock, allocate(256, _)).Times(2).WillRepeatedly(Return(ptr));
+  EXPECT_EQ(res.allocate(256), ptr);
+  EXPECT_EQ(res.allocate(256), ptr);
+}
+
+TEST(BackoffResourceTests, both_limits) {
+  mock_resource mock;
+  bot_both_t res{bot_upstream_t{mock}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  // Skipping stops when the calls limit runs out first...
+  EXPECT_CALL(mock, allocate(512, _)).Times(2).WillRepeatedly(Return(nullptr));
+  EXPECT_EQ(res.allocate(512), nullptr);
+  for (int i = 0; i < 10; ++i) EXPECT_EQ(res.allocate(512), nullptr);
+  EXPECT_EQ(res.allocate(512), nullptr);
+
+  // ... or when the time runs out first
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_CALL(mock, allocate(512, _)).WillOnce(Return(ptr));
+  EXPECT_EQ(res.allocate(512), ptr);
+
+  // The success resets both limits, so a new failure skips exactly
+  // the full number of calls again
+  EXPECT_CALL(mock, allocate(512, _)).WillOnce(Return(nullptr));
+  EXPECT_EQ(res.allocate(512), nullptr);
+  for (int i = 0; i < 10; ++i) EXPECT_EQ(res.allocate(512), nullptr);
+
+  EXPECT_CALL(mock, allocate(512, _)).WillOnce(Return(ptr));
+  EXPECT_EQ(res.allocate(512), ptr);
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cstdint>
@@ -7,6 +8,7 @@
 #include <memory>
 #include <new>
 #include <nupp/algorithm.hpp>
+#include <numeric>
 #include <set>
 #include <thread>
 #include <utility>
@@ -105,6 +107,7 @@ TYPED_TEST(CacheResourceConceptsTests, concepts) {
   EXPECT_TRUE(bound_resource<TypeParam>);
   EXPECT_TRUE(granular_resource<TypeParam>);
   EXPECT_TRUE(sweeping_resource<TypeParam>);
+  EXPECT_TRUE(expanding_resource<TypeParam>);
 
   if constexpr (TypeParam::config.granularity > alignof(std::max_align_t)) {
     EXPECT_TRUE(overaligning_resource<TypeParam>);
@@ -163,12 +166,24 @@ constexpr cache_resource_config cache2_config = {
   .thread_safe = _thread_safe
 };
 
+constexpr cache_resource_config arena_cache_config = {
+  .granularity = pow2_t{1_KiB},
+  .min_block_size = 1_MiB,
+  .max_block_size = 4_MiB,
+  .block_size_multiplier = 2.42,
+  .thread_safe = true,
+  .thread_arena_size = 64_KiB
+};
+
 template <resource R, bool _thread_safe = true>
 using cache1_t = cache_resource<R, cache1_config<_thread_safe>>;
 
 template <resource R, bool _thread_safe = true>
 using cache2_t = cache_resource<R, cache2_config<_thread_safe>>;
 
+template <resource R>
+using arena_cache_t = cache_resource<R, arena_cache_config>;
+
 template <typename T>
 class CacheResourceTestsBase: public testing::Test {
 protected:
@@ -203,23 +218,40 @@ class CacheResourceTests: public resource_test,
 protected:
   using upstream_t = T::upstream_t;
 
+  // Without DWCAS the thread safe cache keeps the head size in
+  // granules, so it requests multiples of granularity
+  constexpr static bool has_packed_head =
+    T::config.thread_safe && !__detail::use_dwcas;
+
+  constexpr static size_t ceil_upstream_size(const size_t size) noexcept {
+    if constexpr (granular_resource<upstream_t>) {
+      // Add some for the result to be a multiple
+      const auto rem = size % upstream_t::min_size();
+      if (!rem) return size;
+      return size + (upstream_t::min_size() - rem);
+    }
+    else if constexpr (bound_resource<upstream_t>)
+      return nupp::maximum(size, upstream_t::min_size());
+    else
+      return size;
+  }
+
   constexpr static size_t get_block_size(const size_t num) noexcept {
     size_t bs_lim = T::config.min_block_size;
     for (size_t i = 0; i < num; ++i)  // NB: not the same as std::pow
       bs_lim = size_t(bs_lim * T::config.block_size_multiplier);
 
-    bs_lim = nupp::minimum(bs_lim, T::config.max_block_size);
+    bs_lim = ceil_upstream_size(nupp::minimum(bs_lim,
+                                              T::config.max_block_size));
+    if constexpr (has_packed_head) {
+      size_t unit = T::config.granularity;
+      if constexpr (granular_resource<upstream_t>)
+        unit = std::lcm(unit, upstream_t::min_size());
 
-    if constexpr (granular_resource<upstream_t>) {
-      // Add some for the result to be a multiple
-      const auto rem = bs_lim % upstream_t::min_size();
-      if (!rem) return bs_lim;
-      return bs_lim + (upstream_t::min_size() - rem);
+      bs_lim = ceil_upstream_size((bs_lim + unit - 1) / unit * unit);
     }
-    else if constexpr (bound_resource<upstream_t>)
-      return nupp::maximum(bs_lim, upstream_t::min_size());
-    else
-      return bs_lim;
+
+    return bs_lim;
   }
 
   void mock_upstream_alloc(const size_t count) noexcept {
@@ -417,7 +449,8 @@ using ThreadSafeCacheResources =
   testing::Types<cache1_t<upstream1_t>, cache1_t<upstream2_t>,
                  cache1_t<upstream3_t>,
                  cache2_t<upstream1_t>, cache2_t<upstream2_t>,
-                 cache2_t<upstream3_t>>;
+                 cache2_t<upstream3_t>,
+                 arena_cache_t<upstream1_t>, arena_cache_t<upstream2_t>>;
 TYPED_TEST_SUITE(CacheResourceThreadingTests, ThreadSafeCacheResources);
 
 TYPED_TEST(CacheResourceThreadingTests, randomized_multithread) {
@@ -492,3 +525,479 @@ TYPED_TEST(CacheResourceThreadingTests, randomized_multithread) {
 
   this->deallocate_all(cache_allocs);
 }
+
+constexpr cache_resource_config reuse_cache_config = {
+  .granularity = pow2_t{1_KiB},
+  .min_block_size = 64_KiB,
+  .max_block_size = 64_KiB,
+  .max_reused_size = 4_KiB
+};
+
+using reuse_cache_t = cache_resource<upstream1_t, reuse_cache_config>;
+
+TEST(CacheResourceReuseTests, reuse) {
+  alignas(4_KiB) static std::byte block[64_KiB];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(64_KiB, 1_KiB)).WillOnce(Return(block));
+
+  auto cache = std::make_unique<reuse_cache_t>(mock);
+
+  const auto ptr1 = cache->allocate(2_KiB);
+  EXPECT_EQ(ptr1, block);
+  const auto ptr2 = cache->allocate(1_KiB);
+  EXPECT_EQ(ptr2, block + 2_KiB);
+
+  // The freed chunk is reused for the same size only
+  cache->deallocate(ptr1, 2_KiB);
+  EXPECT_EQ(cache->allocate(1_KiB), block + 3_KiB);
+  EXPECT_EQ(cache->allocate(2_KiB), ptr1);
+
+  // ...and only if its alignment is enough
+  cache->deallocate(ptr2, 1_KiB);
+  EXPECT_EQ(cache->allocate(1_KiB, 4_KiB), block + 4_KiB);
+  EXPECT_EQ(cache->allocate(1_KiB), ptr2);
+
+  // Bigger chunks are not reused
+  const auto ptr3 = cache->allocate(8_KiB);
+  EXPECT_EQ(ptr3, block + 5_KiB);
+  cache->deallocate(ptr3, 8_KiB);
+  EXPECT_EQ(cache->allocate(8_KiB), block + 13_KiB);
+
+  cache->deallocate(block, 5_KiB);
+  cache->deallocate(block + 13_KiB, 8_KiB);
+
+  // Everything must be merged back into one block
+  EXPECT_CALL(mock, deallocate(block, 64_KiB, 1_KiB));
+  cache.reset();
+}
+
+TEST(CacheResourceReuseTests, batch) {
+  alignas(4_KiB) static std::byte block[64_KiB];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(64_KiB, 1_KiB)).WillOnce(Return(block));
+
+  auto cache = std::make_unique<reuse_cache_t>(mock);
+
+  // A batch is allocated as one region
+  std::array<void*, 6> ptrs;
+  ASSERT_EQ(cache->allocate_batch(4, 1_KiB, 16, ptrs.data()), 4);
+  for (size_t i = 0; i < 4; ++i)
+    EXPECT_EQ(ptrs[i], block + i * 1_KiB);
+
+  // Freed chunks are reused first, then the head moves
+  cache->deallocate_batch(4, 1_KiB, 16, ptrs.data());
+
+  std::array<void*, 6> ptrs2;
+  ASSERT_EQ(cache->allocate_batch(6, 1_KiB, 16, ptrs2.data()), 6);
+  EXPECT_EQ(std::set<void*>(ptrs2.begin(), ptrs2.begin() + 4),
+            std::set<void*>(ptrs.begin(), ptrs.begin() + 4));
+  EXPECT_EQ(ptrs2[4], block + 4_KiB);
+  EXPECT_EQ(ptrs2[5], block + 5_KiB);
+
+  // Big alignments are allocated one by one
+  ASSERT_EQ(cache->allocate_batch(2, 1_KiB, 4_KiB, ptrs.data()), 2);
+  EXPECT_EQ(ptrs[0], block + 8_KiB);
+  EXPECT_EQ(ptrs[1], block + 12_KiB);
+
+  cache->deallocate_batch(6, 1_KiB, 16, ptrs2.data());
+  cache->deallocate_batch(2, 1_KiB, 4_KiB, ptrs.data());
+
+  // Everything must be merged back into one block
+  EXPECT_CALL(mock, deallocate(block, 64_KiB, 1_KiB));
+  cache.reset();
+}
+
+TEST(CacheResourceResetTests, reset) {
+  using cache_t =
+    cache_resource<upstream1_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 16_KiB,
+                                          .max_block_size = 16_KiB,
+                                          .resettable = true }>;
+
+  alignas(4_KiB) static std::byte block1[16_KiB];
+  alignas(4_KiB) static std::byte block2[16_KiB];
+  alignas(4_KiB) static std::byte block3[16_KiB];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(16_KiB, 1_KiB))
+    .WillOnce(Return(block1))
+    .WillOnce(Return(block2))
+    .WillOnce(Return(block3));
+
+  auto cache = std::make_unique<cache_t>(mock);
+
+  // The first granule of every block is taken by its header
+  EXPECT_EQ(cache->allocate(4_KiB), block1 + 1_KiB);
+
+  const auto marker = cache->marker();
+  EXPECT_EQ(cache->allocate(8_KiB), block1 + 5_KiB);
+  EXPECT_EQ(cache->allocate(8_KiB), block2 + 1_KiB);
+
+  // The new block is kept and taken again when needed
+  cache->rewind(marker);
+  EXPECT_EQ(cache->allocate(8_KiB), block1 + 5_KiB);
+  EXPECT_EQ(cache->allocate(8_KiB), block2 + 1_KiB);
+
+  // Only the most recent block fits into the retained size
+  EXPECT_CALL(mock, deallocate(block1, 16_KiB, 1_KiB));
+  cache->reset(16_KiB);
+
+  EXPECT_EQ(cache->allocate(4_KiB), block2 + 1_KiB);
+  cache->deallocate(block2 + 1_KiB, 4_KiB);  // Does nothing
+  EXPECT_EQ(cache->allocate(12_KiB), block3 + 1_KiB);
+
+  EXPECT_CALL(mock, deallocate(block2, 16_KiB, 1_KiB));
+  EXPECT_CALL(mock, deallocate(block3, 16_KiB, 1_KiB));
+  cache.reset();
+}
+
+class CacheResourceReuseThreadingTests: public resource_multithreaded_test,
+                                        public testing::Test {};
+
+TEST_F(CacheResourceReuseThreadingTests, randomized_multithread) {
+  constexpr size_t threads_count = 8;
+  constexpr size_t allocs_per_thread = 10000;
+
+  mock_resource mock;
+  mock_allocations(mock, 1024, 64_KiB, 1_KiB);
+  auto cache = std::make_unique<reuse_cache_t>(mock);
+
+  std::latch latch(threads_count);
+
+  std::vector<std::thread> threads;
+  threads.reserve(threads_count);
+
+  for (size_t i = 0; i < threads_count; ++i)
+    threads.emplace_back([&cache, &latch](const size_t id) {
+      latch.arrive_and_wait();
+
+      // Every allocation is filled with the thread's mark and checked
+      // before it's freed, so a chunk given out twice gets noticed
+      const auto mark = std::byte(id + 1);
+      std::vector<std::pair<std::byte*, size_t>> local_allocs;
+
+      size_t allocs_num = 0;
+      while (allocs_num < allocs_per_thread || !local_allocs.empty()) {
+        if (allocs_num < allocs_per_thread && (rand() % 2)) {
+          const size_t size = (1 + rand() % 4) * 1_KiB;
+          const auto ptr = (std::byte*)cache->allocate(size);
+          if (!ptr) continue;
+
+          std::fill_n(ptr, size, mark);
+          local_allocs.emplace_back(ptr, size);
+          ++allocs_num;
+        }
+        else if (!local_allocs.empty()) {
+          const auto it = local_allocs.begin() + (rand() % local_allocs.size());
+          EXPECT_EQ(std::count(it->first, it->first + it->second, mark),
+                    it->second);
+
+          cache->deallocate(it->first, it->second);
+          std::swap(*it, local_allocs.back());
+          local_allocs.pop_back();
+        }
+      }
+    }, i);
+
+  for (auto& t : threads) t.join();
+
+  mock_deallocations(mock);
+  cache.reset();
+  EXPECT_EQ(allocations.size(), 0);
+}
+
+TEST(CacheResourceArenaTests, allocation) {
+  using cache_t =
+    cache_resource<upstream1_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 64_KiB,
+                                          .max_block_size = 64_KiB,
+                                          .thread_arena_size = 8_KiB }>;
+
+  alignas(4_KiB) static std::byte block[64_KiB];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(64_KiB, 1_KiB)).WillOnce(Return(block));
+
+  auto cache = std::make_unique<cache_t>(mock);
+
+  // The first allocation takes the (1KiB) arena record and the arena
+  // itself from the block
+  EXPECT_EQ(cache->allocate(1_KiB), block + 1_KiB);
+  EXPECT_EQ(cache->allocate(2_KiB), block + 2_KiB);
+
+  // Another thread gets its own arena
+  std::thread([&cache]() {
+    EXPECT_EQ(cache->allocate(1_KiB), block + 10_KiB);
+  }).join();
+
+  EXPECT_EQ(cache->allocate(1_KiB, 2_KiB), block + 4_KiB);
+
+  // Too big for the arena
+  EXPECT_EQ(cache->allocate(5_KiB), block + 18_KiB);
+
+  // Takes exactly what's left, so the next one refills the arena
+  EXPECT_EQ(cache->allocate(4_KiB), block + 5_KiB);
+  EXPECT_EQ(cache->allocate(1_KiB), block + 23_KiB);
+
+  cache->deallocate(block + 1_KiB, 8_KiB);
+  cache->deallocate(block + 10_KiB, 1_KiB);
+  cache->deallocate(block + 18_KiB, 6_KiB);
+
+  // The arenas leftovers and records are merged back as well
+  EXPECT_CALL(mock, deallocate(block, 64_KiB, 1_KiB));
+  cache.reset();
+}
+
+TEST(CacheResourceExpandTests, expand) {
+  using cache_t =
+    cache_resource<upstream1_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 16_KiB,
+                                          .max_block_size = 16_KiB }>;
+
+  alignas(4_KiB) static std::byte block[16_KiB];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(16_KiB, 1_KiB)).WillOnce(Return(block));
+
+  auto cache = std::make_unique<cache_t>(mock);
+
+  // The last allocation grows into the head
+  const auto ptr1 = cache->allocate(4_KiB);
+  EXPECT_EQ(ptr1, block);
+  EXPECT_TRUE(cache->expand(ptr1, 4_KiB, 8_KiB));
+
+  const auto ptr2 = cache->allocate(1_KiB);
+  EXPECT_EQ(ptr2, block + 8_KiB);
+  EXPECT_FALSE(cache->expand(ptr1, 8_KiB, 12_KiB));
+  EXPECT_TRUE(cache->expand(ptr2, 1_KiB, 4_KiB));
+
+  // And gives the space back when shrunk
+  EXPECT_TRUE(cache->expand(ptr2, 4_KiB, 2_KiB));
+  EXPECT_EQ(cache->allocate(1_KiB), block + 10_KiB);
+
+  // Other regions are shrunk by freeing the tail but can't grow
+  EXPECT_TRUE(cache->expand(ptr1, 8_KiB, 6_KiB));
+  EXPECT_FALSE(cache->expand(ptr2, 2_KiB, 3_KiB));
+
+  // Nor can the last one past the end of the block
+  const auto ptr3 = cache->allocate(1_KiB);
+  EXPECT_EQ(ptr3, block + 11_KiB);
+  EXPECT_FALSE(cache->expand(ptr3, 1_KiB, 8_KiB));
+
+  cache->deallocate(ptr1, 6_KiB);
+  cache->deallocate(ptr2, 2_KiB);
+  cache->deallocate(block + 10_KiB, 1_KiB);
+  cache->deallocate(ptr3, 1_KiB);
+
+  EXPECT_CALL(mock, deallocate(block, 16_KiB, 1_KiB));
+  cache.reset();
+}
+
+TEST(CacheResourceRefillTests, caller) {
+  using cache_t =
+    cache_resource<upstream1_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 16_KiB,
+                                          .max_block_size = 16_KiB,
+                                          .refill_watermark = 4_KiB }>;
+
+  // NB: gaps between the blocks so that they are never merged
+  alignas(4_KiB) static std::byte memory[36_KiB];
+  const auto block1 = memory, block2 = memory + 20_KiB;
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(16_KiB, 1_KiB))
+    .WillOnce(Return(block1))
+    .WillOnce(Return(block2));
+
+  auto cache = std::make_unique<cache_t>(mock);
+
+  // Leaves exactly the watermark, so no refill yet
+  EXPECT_EQ(cache->allocate(12_KiB), block1);
+  EXPECT_FALSE(cache->needs_refill());
+
+  // Crosses it and allocates the next block right away
+  EXPECT_EQ(cache->allocate(1_KiB), block1 + 12_KiB);
+  testing::Mock::VerifyAndClearExpectations(&mock);
+  EXPECT_FALSE(cache->needs_refill());
+  EXPECT_FALSE(cache->refill());
+
+  // Which is then taken with no upstream calls
+  EXPECT_EQ(cache->allocate(4_KiB), block2);
+  EXPECT_EQ(cache->allocate(2_KiB), block2 + 4_KiB);
+
+  cache->deallocate(block1, 13_KiB);
+  cache->deallocate(block2, 6_KiB);
+
+  EXPECT_CALL(mock, deallocate(block1, 16_KiB, 1_KiB));
+  EXPECT_CALL(mock, deallocate(block2, 16_KiB, 1_KiB));
+  cache.reset();
+}
+
+TEST(CacheResourceRefillTests, manual) {
+  using cache_t =
+    cache_resource<upstream1_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 16_KiB,
+                                          .max_block_size = 16_KiB,
+                                          .thread_safe = false,
+                                          .refill_watermark = 4_KiB,
+                                          .refill = refill_mode::manual }>;
+
+  alignas(4_KiB) static std::byte memory[60_KiB];
+  const auto block1 = memory, block2 = memory + 20_KiB,
+    block3 = memory + 40_KiB;
+
+  mock_resource mock;
+  auto cache = std::make_unique<cache_t>(mock);
+
+  // Can be used to warm the cache up
+  EXPECT_TRUE(cache->needs_refill());
+  EXPECT_CALL(mock, allocate(16_KiB, 1_KiB)).WillOnce(Return(block1));
+  EXPECT_TRUE(cache->refill());
+  EXPECT_FALSE(cache->needs_refill());
+  EXPECT_FALSE(cache->refill());
+
+  EXPECT_EQ(cache->allocate(8_KiB), block1);
+  EXPECT_EQ(cache->allocate(6_KiB), block1 + 8_KiB);
+  testing::Mock::VerifyAndClearExpectations(&mock);
+
+  // Nothing happens until asked
+  EXPECT_TRUE(cache->needs_refill());
+  EXPECT_CALL(mock, allocate(16_KiB, 1_KiB)).WillOnce(Return(block2));
+  EXPECT_TRUE(cache->refill());
+  testing::Mock::VerifyAndClearExpectations(&mock);
+
+  // Too big for the block kept aside, so it stays for the next one
+  EXPECT_CALL(mock, allocate(20_KiB, 1_KiB)).WillOnce(Return(block3));
+  EXPECT_EQ(cache->allocate(20_KiB), block3);
+  testing::Mock::VerifyAndClearExpectations(&mock);
+
+  // The current block is still the same
+  EXPECT_EQ(cache->allocate(2_KiB), block1 + 14_KiB);
+  EXPECT_EQ(cache->allocate(14_KiB), block2);
+
+  cache->deallocate(block1, 16_KiB);
+  cache->deallocate(block2, 14_KiB);
+  cache->deallocate(block3, 20_KiB);
+
+  EXPECT_CALL(mock, deallocate(block1, 16_KiB, 1_KiB));
+  EXPECT_CALL(mock, deallocate(block2, 16_KiB, 1_KiB));
+  EXPECT_CALL(mock, deallocate(block3, 20_KiB, 1_KiB));
+  cache.reset();
+}
+
+class CacheResourceRefillThreadingTests: public resource_multithreaded_test,
+                                         public testing::Test {};
+
+// NB: the helper thread calls the upstream concurrently with the others
+using refill_upstream_t =
+  test_resource<resource_params{ .is_sweeping = true,
+                                 .is_thread_safe = true }>;
+
+TEST_F(CacheResourceRefillThreadingTests, background) {
+  constexpr size_t threads_count = 8;
+  constexpr size_t allocs_per_thread = 1000;
+
+  using cache_t =
+    cache_resource<refill_upstream_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 64_KiB,
+                                          .max_block_size = 64_KiB,
+                                          .refill_watermark = 16_KiB,
+                                          .refill = refill_mode::background
+                                        }>;
+
+  mock_resource mock;
+  mock_allocations(mock, 1024, 64_KiB, 1_KiB);
+  auto cache = std::make_unique<cache_t>(mock);
+
+  std::latch latch(threads_count);
+
+  std::vector<std::thread> threads;
+  threads.reserve(threads_count);
+
+  for (size_t i = 0; i < threads_count; ++i)
+    threads.emplace_back([&cache, &latch]() {
+      latch.arrive_and_wait();
+
+      std::vector<std::pair<void*, size_t>> local_allocs;
+      for (size_t j = 0; j < allocs_per_thread; ++j) {
+        const size_t size = (1 + rand() % 4) * 1_KiB;
+        if (const auto ptr = cache->allocate(size))
+          local_allocs.emplace_back(ptr, size);
+
+        if (rand() % 3 == 0 && !local_allocs.empty()) {
+          cache->deallocate(local_allocs.back().first,
+                            local_allocs.back().second);
+          local_allocs.pop_back();
+        }
+      }
+
+      for (const auto& [ptr, size] : local_allocs)
+        cache->deallocate(ptr, size);
+    });
+
+  for (auto& t : threads) t.join();
+
+  // The helper thread may still be allocating until the destructor
+  // joins it, so the deallocations are only checked after that
+  std::vector<allocation> deallocations;
+  EXPECT_CALL(mock, deallocate(_, _, _))
+    .WillRepeatedly([&deallocations](void* const ptr, const size_t size,
+                                     const size_t alignment) {
+      deallocations.push_back({ ptr, size, alignment });
+    });
+  cache.reset();
+
+  // The block kept aside (if any) must be returned as well
+  mock_deallocations(mock);
+  for (const auto& [ptr, size, alignment] : deallocations)
+    mock.deallocate(ptr, size, alignment);
+  EXPECT_EQ(allocations.size(), 0);
+}
+
+TEST_F(CacheResourceRefillThreadingTests, move_while_pending) {
+  using cache_t =
+    cache_resource<refill_upstream_t,
+                   cache_resource_config{ .granularity = pow2_t{1_KiB},
+                                          .min_block_size = 64_KiB,
+                                          .max_block_size = 64_KiB,
+                                          .refill_watermark = 16_KiB,
+                                          .refill = refill_mode::background
+                                        }>;
+
+  const auto memory = std::make_unique<std::byte[]>(2 * 64_KiB);
+  std::atomic<size_t> blocks_count = 0;
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(64_KiB, _))
+    .WillRepeatedly([&memory, &blocks_count](size_t, size_t) -> void* {
+      const auto i = blocks_count.fetch_add(1);
+      return i < 2 ? memory.get() + i * 64_KiB : nullptr;
+    });
+  EXPECT_CALL(mock, deallocate(_, _, _)).Times(testing::AnyNumber());
+
+  auto cache = std::make_unique<cache_t>(mock);
+
+  // Leaves less than the watermark, so the refill is requested, and
+  // the move (most likely) comes before the helper thread takes it
+  ASSERT_EQ(cache->allocate(49_KiB), memory.get());
+  cache_t cache2{std::move(*cache)};
+  cache.reset();
+
+  // The request is either done or dropped, but the refills go on
+  if (cache2.needs_refill()) {
+    EXPECT_TRUE(cache2.refill());
+  }
+  EXPECT_EQ(blocks_count.load(), 2);
+  EXPECT_FALSE(cache2.needs_refill());
+
+  // The block kept aside is taken once the current one is exhausted
+  EXPECT_EQ(cache2.allocate(32_KiB), memory.get() + 64_KiB);
+}
@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+
+#include "memaw/cache_resource.hpp"
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/mapped_resource.hpp"
+
+#if !MEMAW_IS(OS, WINDOWS)
+#  include <unistd.h>
+#endif
+
+using namespace memaw;
+
+TEST(MappedResourceTests, concepts) {
+  using file_t = mapped_file_resource<>;
+  using shm_t = shared_memory_resource<page_types::regular,
+                                       mapped_resource_config{
+                                         .thread_safe = false
+                                       }>;
+
+  EXPECT_TRUE(resource<file_t>);
+  EXPECT_TRUE(nothrow_resource<file_t>);
+  EXPECT_TRUE(bound_resource<file_t>);
+  EXPECT_TRUE(granular_resource<file_t>);
+  EXPECT_TRUE(overaligning_resource<file_t>);
+  EXPECT_TRUE(sweeping_resource<file_t>);
+  EXPECT_TRUE(thread_safe_resource<file_t>);
+
+  EXPECT_TRUE(resource<shm_t>);
+  EXPECT_TRUE(granular_resource<shm_t>);
+  EXPECT_TRUE(sweeping_resource<shm_t>);
+  EXPECT_FALSE(thread_safe_resource<shm_t>);
+
+  EXPECT_EQ(file_t::min_size(), os_resource::get_page_size());
+  EXPECT_EQ(shm_t::guaranteed_alignment(),
+            os_resource::guaranteed_alignment());
+}
+
+TEST(MappedResourceTests, shared_memory) {
+  const auto page_size = shared_memory_resource<>::min_size();
+
+  shared_memory_resource<> res{4 * page_size + 1};
+  ASSERT_NE(res.range_begin(), nullptr);
+  EXPECT_EQ(res.mapped_size(), 5 * page_size);
+  EXPECT_EQ(res.used_size(), 0);
+
+  EXPECT_EQ(res.allocate(page_size + 1), nullptr);
+  EXPECT_EQ(res.allocate(6 * page_size), nullptr);
+
+  // Allocations are sequential
+  const auto ptr1 = static_cast<char*>(res.allocate(page_size));
+  const auto ptr2 = static_cast<char*>(res.allocate(2 * page_size));
+  EXPECT_EQ(ptr1, res.range_begin());
+  EXPECT_EQ(ptr2, ptr1 + page_size);
+  EXPECT_EQ(res.used_size(), 3 * page_size);
+
+  std::strcpy(ptr2, "shared");
+  res.deallocate(ptr1, page_size);  // no-op
+
+#if !MEMAW_IS(OS, WINDOWS)
+  // Map the same object again (as another process would do with the
+  // descriptor passed to it)
+  shared_memory_resource<> other{::dup(res.native_handle()), res.mapped_size(),
+                                 res.used_size()};
+  ASSERT_NE(other.range_begin(), nullptr);
+  EXPECT_NE(other.range_begin(), res.range_begin());
+  EXPECT_EQ(other.used_size(), 3 * page_size);
+
+  const auto other_ptr2 =
+    static_cast<char*>(other.range_begin()) + page_size;
+  EXPECT_STREQ(other_ptr2, "shared");
+
+  // And the changes are visible both ways
+  const auto ptr3 = static_cast<char*>(other.allocate(page_size));
+  ASSERT_NE(ptr3, nullptr);
+  std::strcpy(ptr3, "back");
+  EXPECT_STREQ(ptr2 + 2 * page_size, "back");
+#endif
+
+  // Move leaves the source empty
+  shared_memory_resource<> moved{std::move(res)};
+  EXPECT_EQ(res.range_begin(), nullptr);
+  EXPECT_EQ(res.allocate(page_size), nullptr);
+  EXPECT_EQ(moved.allocate(2 * page_size), ptr2 + 2 * page_size);
+  EXPECT_EQ(moved.allocate(page_size), nullptr);
+}
+
+TEST(MappedResourceTests, file) {
+  const auto page_size = mapped_file_resource<>::min_size();
+  const auto path = testing::TempDir() + "memaw_mapped_file_test";
+  std::remove(path.c_str());
+
+  {
+    mapped_file_resource<> res{path.c_str()};  // empty file
+    EXPECT_EQ(res.range_begin(), nullptr);
+    EXPECT_EQ(res.allocate(page_size), nullptr);
+  }
+
+  {
+    mapped_file_resource<> res{path.c_str(), 2 * page_size};
+    ASSERT_NE(res.range_begin(), nullptr);
+    EXPECT_EQ(res.mapped_size(), 2 * page_size);
+
+    const auto ptr = static_cast<char*>(res.allocate(page_size));
+    ASSERT_NE(ptr, nullptr);
+    std::strcpy(ptr, "persistent");
+    EXPECT_TRUE(res.flush());
+  }
+
+  {
+    // Reopen with the file size and the previously used part
+    mapped_file_resource<> res{path.c_str(), 0, page_size};
+    ASSERT_NE(res.range_begin(), nullptr);
+    EXPECT_EQ(res.mapped_size(), 2 * page_size);
+    EXPECT_STREQ(static_cast<char*>(res.range_begin()), "persistent");
+
+    const auto ptr = static_cast<char*>(res.allocate(page_size));
+    EXPECT_EQ(ptr, static_cast<char*>(res.range_begin()) + page_size);
+    EXPECT_EQ(res.allocate(page_size), nullptr);
+  }
+
+  std::remove(path.c_str());
+}
+
+TEST(MappedResourceTests, cache_upstream) {
+  using upstream_t = shared_memory_resource<>;
+  constexpr cache_resource_config config = {
+    .min_block_size = 64_KiB,
+    .max_block_size = 64_KiB
+  };
+
+  cache_resource<upstream_t, config> cache{upstream_t{1_MiB}};
+  const auto begin = uintptr_t(cache.upstream().range_begin());
+  ASSERT_NE(begin, 0);
+
+  // Everything is allocated from the shared object
+  for (size_t i = 0; i < 32; ++i) {
+    const auto ptr = uintptr_t(cache.allocate(16_KiB));
+    ASSERT_NE(ptr, 0);
+    EXPECT_GE(ptr, begin);
+    EXPECT_LE(ptr + 16_KiB, begin + 1_MiB);
+  }
+
+  EXPECT_EQ(cache.upstream().used_size(), 512_KiB);
+}
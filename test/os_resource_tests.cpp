@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdint>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -7,6 +8,10 @@
 #include "memaw/concepts.hpp"
 #include "memaw/os_resource.hpp"
 
+#if MEMAW_IS(OS, LINUX)
+#  include <sys/mman.h>
+#endif
+
 using namespace memaw;
 
 MATCHER_P(IsAlignedBy, log2, "") {
@@ -115,20 +120,32 @@ TEST_F(OsResourceTests, static_info) {
     EXPECT_LT(page_size, *big_page_size_opt);
   }
 
+  const auto transparent_page_size_opt =
+    os_resource::get_transparent_page_size();
+  if (transparent_page_size_opt) {
+    EXPECT_TRUE(nupp::is_pow2(transparent_page_size_opt->value));
+    EXPECT_LT(page_size, *transparent_page_size_opt);
+  }
+
   const auto min_size_reg = os_resource::min_size();
   const auto min_size_big = os_resource::min_size(page_types::big);
+  const auto min_size_thp = os_resource::min_size(page_types::transparent);
   const auto min_size_exp = os_resource::min_size(pow2_t{64_MiB});
 
   EXPECT_EQ(min_size_reg, page_size);
   EXPECT_EQ(min_size_big, big_page_size_opt.value_or(page_size));
+  EXPECT_EQ(min_size_thp, transparent_page_size_opt.value_or(page_size));
   EXPECT_EQ(min_size_exp, 64_MiB);
 
   const auto align_reg = os_resource::guaranteed_alignment(page_types::regular);
   const auto align_big = os_resource::guaranteed_alignment(page_types::big);
+  const auto align_thp =
+    os_resource::guaranteed_alignment(page_types::transparent);
   const auto align_exp = os_resource::guaranteed_alignment(pow2_t{64_MiB});
 
   EXPECT_EQ(align_reg, granularity);
   EXPECT_GE(align_big, min_size_big);
+  EXPECT_GE(align_thp, min_size_thp);
   EXPECT_GE(align_exp, min_size_exp);
 
   bool has_ps = false, has_bps = false;
@@ -136,7 +153,7 @@ TEST_F(OsResourceTests, static_info) {
     EXPECT_TRUE(nupp::is_pow2(x.value));
 
     if (x == page_size) has_ps = true;
-    else if (big_page_size_opt && x == *big_page_size_opt)
+    if (big_page_size_opt && x == *big_page_size_opt)
       has_bps = true;
   }
 
@@ -154,7 +171,17 @@ TEST_F(OsResourceTests, regular_pages) {
     EXPECT_NE(p.first, nullptr);  // Assume regular page allocation
                                   // succeeds...
 
+  const auto aligned_count = this->allocs.size();
   this->test_overaligned_allocs(tag, 10);
+
+#if !MEMAW_IS(OS, WINDOWS)
+  // ...even with big alignments on Unix-like systems
+  for (size_t i = aligned_count; i < this->allocs.size(); ++i)
+    EXPECT_NE(this->allocs[i].first, nullptr);
+#else
+  (void)aligned_count;
+#endif
+
   this->deallocate_all();
 }
 
@@ -167,6 +194,37 @@ TEST_F(OsResourceTests, big_pages) {
   this->deallocate_all();
 }
 
+TEST_F(OsResourceTests, big_pages_stats) {
+  // There is never a pool of regular pages
+  EXPECT_FALSE(os_resource::get_big_pages_stats(res.get_page_size()));
+
+  const auto big_page_size_opt = os_resource::get_big_page_size();
+  if (!big_page_size_opt) return;
+
+  const auto stats_opt = os_resource::get_big_pages_stats(*big_page_size_opt);
+#if MEMAW_IS(OS, LINUX)
+  ASSERT_TRUE(stats_opt);
+  EXPECT_LE(stats_opt->free, stats_opt->total);
+  EXPECT_LE(stats_opt->available(), stats_opt->free);
+#else
+  EXPECT_FALSE(stats_opt);
+#endif
+}
+
+TEST_F(OsResourceTests, transparent_pages) {
+  constexpr auto tag = page_types::transparent;
+
+  this->test_allocs(tag);
+  this->test_aligned_allocs(tag);
+  this->test_overaligned_allocs(tag, 3);
+
+  // These are regular pages in the end, so any alignment must work
+  for (auto p : this->allocs)
+    EXPECT_NE(p.first, nullptr);
+
+  this->deallocate_all();
+}
+
 TEST_F(OsResourceTests, explicitly_sized_pages) {
   // We will try all the pages in the list and one that isn't there
   const auto routine = [this](const pow2_t size) {
@@ -196,3 +254,136 @@ TEST_F(OsResourceTests, explicitly_sized_pages) {
     break;
   }
 }
+
+TEST_F(OsResourceTests, numa_policies) {
+  const auto nodes_count = os_resource::get_numa_nodes_count();
+  EXPECT_GE(nodes_count, 1);
+  EXPECT_LT(os_resource::get_current_numa_node(), nodes_count);
+
+  const auto size = res.get_page_size() * 4;
+  const auto routine = [&](const numa_policy policy) {
+    const auto result =
+      res.allocate(size, res.guaranteed_alignment(), page_types::regular,
+                   { .numa = policy });
+    allocs.emplace_back(result, size);
+    return result != nullptr;
+  };
+
+  // Node 0 always exists and the local policy is supported everywhere
+  EXPECT_TRUE(routine(numa_policy::local()));
+#if MEMAW_IS(OS, LINUX)
+  EXPECT_TRUE(routine(numa_policy::bind(0)));
+  EXPECT_TRUE(routine(numa_policy::prefer(0)));
+  EXPECT_TRUE(routine(numa_policy::interleave(1)));
+#elif MEMAW_IS(OS, WINDOWS)
+  EXPECT_FALSE(routine(numa_policy::interleave(1)));
+#endif
+
+  // An empty mask is never valid
+  EXPECT_FALSE(routine({ .mode = numa_mode::bind, .nodes = 0 }));
+
+  // Neither is a node out of the mask range
+  EXPECT_EQ(numa_policy::bind(numa_policy::max_nodes).nodes, 0);
+  EXPECT_FALSE(routine(numa_policy::bind(numa_policy::max_nodes)));
+  EXPECT_FALSE(routine(numa_policy::prefer(1000)));
+
+  this->deallocate_all();
+}
+
+TEST_F(OsResourceTests, populate) {
+  const auto page_size = res.get_page_size();
+  const auto size = page_size * 256;
+
+#if MEMAW_IS(OS, LINUX)
+  const auto is_resident = [&](void* const ptr, const size_t size) {
+    std::vector<unsigned char> pages(size / page_size);
+    if (mincore(ptr, size, pages.data()) != 0) return false;
+    return std::ranges::all_of(pages, [](auto p) { return p & 1; });
+  };
+#else
+  const auto is_resident = [](void*, size_t) { return true; };
+#endif
+
+  const auto populated = res.allocate(size, page_size, page_types::regular,
+                                      { .populate = true });
+  ASSERT_NE(populated, nullptr);
+  EXPECT_TRUE(is_resident(populated, size));
+  res.deallocate(populated, size);
+
+  // Prefaulting must preserve the contents
+  for (const size_t threads_count : { 1, 3, 8, 1000 }) {
+    const auto ptr = static_cast<char*>(res.allocate(size));
+    ASSERT_NE(ptr, nullptr);
+
+    ptr[0] = 'x';
+    ptr[size - 1] = 'y';
+    EXPECT_TRUE(res.prefault(ptr, size, threads_count));
+    EXPECT_TRUE(is_resident(ptr, size));
+    EXPECT_EQ(ptr[0], 'x');
+    EXPECT_EQ(ptr[size - 1], 'y');
+
+    res.deallocate(ptr, size);
+  }
+}
+
+TEST_F(OsResourceTests, purge) {
+  const auto page_size = res.get_page_size();
+  const auto size = page_size * 16;
+
+  const auto ptr = static_cast<char*>(res.allocate(size));
+  ASSERT_NE(ptr, nullptr);
+  for (size_t i = 0; i < size; ++i) ptr[i] = 'x';
+
+  // The range must stay accessible
+  res.purge(ptr + page_size, size - 2*page_size);
+  ptr[page_size] = 'y';
+  EXPECT_EQ(ptr[0], 'x');
+  EXPECT_EQ(ptr[size - 1], 'x');
+
+#if MEMAW_IS(OS, LINUX)
+  // And be zero-filled again on Linux
+  EXPECT_EQ(ptr[page_size], 'y');
+  EXPECT_EQ(ptr[page_size + 1], 0);
+  EXPECT_EQ(ptr[size - page_size - 1], 0);
+
+  std::vector<unsigned char> pages(size / page_size);
+  ASSERT_EQ(mincore(ptr, size, pages.data()), 0);
+  EXPECT_FALSE(pages[2] & 1);
+#endif
+
+  res.deallocate(ptr, size);
+}
+
+TEST_F(OsResourceTests, expand) {
+  EXPECT_TRUE(expanding_resource<os_resource>);
+
+  const auto page_size = res.get_page_size();
+  const auto size = page_size * 4;
+
+  const auto ptr = static_cast<char*>(res.allocate(size));
+  ASSERT_NE(ptr, nullptr);
+  ptr[0] = 'x';
+  ptr[size - 1] = 'y';
+
+  // Shrinking is supported everywhere, growing back is on our targets
+  ASSERT_TRUE(res.expand(ptr, size, page_size * 2));
+  ptr[page_size * 2 - 1] = 'z';
+  ASSERT_TRUE(res.expand(ptr, page_size * 2, size));
+  EXPECT_EQ(ptr[0], 'x');
+  EXPECT_EQ(ptr[page_size * 2 - 1], 'z');
+  ptr[size - 1] = 'y';
+
+#if MEMAW_IS(OS, LINUX)
+  // Moved (if necessary) without copying
+  const auto big_size = page_size * 1024;
+  const auto new_ptr = static_cast<char*>(res.reallocate(ptr, size, big_size));
+  ASSERT_NE(new_ptr, nullptr);
+  EXPECT_EQ(new_ptr[0], 'x');
+  EXPECT_EQ(new_ptr[size - 1], 'y');
+  new_ptr[big_size - 1] = 'z';
+
+  res.deallocate(new_ptr, big_size);
+#else
+  res.deallocate(ptr, size);
+#endif
+}
@@ -7,13 +7,23 @@
 
 using namespace memaw;
 
+using populated_pages_resource =
+  pages_resource<page_types::regular, os_allocation_options{
+                                        .populate = true }>;
+
+template <size_t _node>
+concept prt_numa_node = requires { typename numa_pages_resource<_node>; };
+
 template <class T>
 class OsAndPagesResourcesTests: public ::testing::Test {};
 
 using OsAndPagesResources = ::testing::Types<os_resource,
                                              regular_pages_resource,
                                              big_pages_resource,
-                                             fixed_pages_resource<2_MiB>>;
+                                             transparent_pages_resource,
+                                             fixed_pages_resource<2_MiB>,
+                                             numa_pages_resource<0>,
+                                             populated_pages_resource>;
 TYPED_TEST_SUITE(OsAndPagesResourcesTests, OsAndPagesResources);
 
 TYPED_TEST(OsAndPagesResourcesTests, concepts) {
@@ -24,6 +34,8 @@ TYPED_TEST(OsAndPagesResourcesTests, concepts) {
   EXPECT_TRUE(sweeping_resource<TypeParam>);
   EXPECT_TRUE(thread_safe_resource<TypeParam>);
   EXPECT_TRUE(nothrow_resource<TypeParam>);
+  EXPECT_TRUE(purging_resource<TypeParam>);
+  EXPECT_TRUE(expanding_resource<TypeParam>);
 
   []<typename... Ts>(const testing::Types<Ts...>) {
     const auto test = []<typename T>() {
@@ -41,23 +53,43 @@ TEST(PagesResourceTests, base) {
 
   regular_pages_resource reg;
   big_pages_resource big;
+  transparent_pages_resource thp;
   fixed_pages_resource<size> fixed;
+  numa_pages_resource<0> numa;
 
   EXPECT_EQ(reg.min_size(), os.get_page_size());
   EXPECT_EQ(big.min_size(), os.get_big_page_size().value_or(reg.min_size()));
+  EXPECT_EQ(thp.min_size(),
+            os.get_transparent_page_size().value_or(reg.min_size()));
   EXPECT_EQ(fixed.min_size(), size);
+  EXPECT_EQ(numa.min_size(), reg.min_size());
+
+  // The node must fit the mask of numa_policy
+  EXPECT_TRUE(prt_numa_node<63>);
+  EXPECT_FALSE(prt_numa_node<64>);
 
   EXPECT_GE(reg.guaranteed_alignment(), reg.min_size());
   EXPECT_GE(big.guaranteed_alignment(), big.min_size());
+  EXPECT_GE(thp.guaranteed_alignment(), thp.min_size());
   EXPECT_GE(fixed.guaranteed_alignment(), fixed.min_size());
 
   const auto reg_ptr = reg.allocate(reg.min_size());
   EXPECT_NE(reg_ptr, nullptr);
 
+  const auto thp_ptr = thp.allocate(thp.min_size());
+  EXPECT_NE(thp_ptr, nullptr);
+
+#if MEMAW_IS(OS, LINUX) || MEMAW_IS(OS, WINDOWS)
+  const auto numa_ptr = numa.allocate(numa.min_size());
+  EXPECT_NE(numa_ptr, nullptr);
+  numa.deallocate(numa_ptr, numa.min_size());
+#endif
+
   const auto big_ptr = big.allocate(big.min_size());
   const auto fixed_ptr = fixed.allocate(fixed.min_size());
 
   reg.deallocate(reg_ptr, reg.min_size());
+  thp.deallocate(thp_ptr, thp.min_size());
   big.deallocate(big_ptr, big.min_size());
   fixed.deallocate(fixed_ptr, fixed.min_size());
 }
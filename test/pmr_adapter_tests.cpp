@@ -0,0 +1,72 @@
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pmr_adapter.hpp"
+#include "memaw/pool_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+using pat_granular_t =
+  test_resource<resource_params{ .nothrow_alloc = true,
+                                 .nothrow_dealloc = true,
+                                 .min_size = 64, .is_granular = true }>;
+
+using pat_pool_t = pool_resource<regular_pages_resource>;
+
+TEST(PmrAdapterTests, forwarding) {
+  mock_resource mock;
+  pmr_adapter<pat_granular_t> adapter{pat_granular_t{mock}};
+  std::pmr::memory_resource& base = adapter;
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  EXPECT_CALL(mock, allocate(64, 8)).WillOnce(Return(ptr));
+  EXPECT_CALL(mock, deallocate(ptr, 64, 8));
+  EXPECT_CALL(mock, allocate(128, 64)).WillOnce(Return(nullptr));
+
+  EXPECT_EQ(base.allocate(1, 8), ptr);
+  base.deallocate(ptr, 1, 8);
+  EXPECT_THROW((void)base.allocate(65, 64), std::bad_alloc);
+
+  EXPECT_EQ(adapter.resource().mock, &mock);
+  EXPECT_TRUE(resource<pmr_adapter<pat_granular_t>>);
+}
+
+TEST(PmrAdapterTests, equality) {
+  pmr_adapter<pat_pool_t> pool1, pool2;
+  EXPECT_TRUE(pool1.is_equal(pool1));
+  EXPECT_FALSE(pool1.is_equal(pool2));
+  EXPECT_FALSE(pool1.is_equal(*std::pmr::new_delete_resource()));
+
+  // Any instances of a resource with equal instances are equal
+  pmr_adapter<regular_pages_resource> pages1, pages2;
+  pmr_adapter<big_pages_resource> big_pages;
+  EXPECT_TRUE(pages1.is_equal(pages2));
+  EXPECT_TRUE(pages2.is_equal(pages1));
+  EXPECT_FALSE(pages1.is_equal(big_pages));
+}
+
+TEST(PmrAdapterTests, containers) {
+  pmr_adapter<pat_pool_t> pool;
+
+  std::pmr::vector<int> vec{&pool};
+  for (int i = 0; i < 1000; ++i) vec.push_back(i);
+  for (int i = 0; i < 1000; ++i) EXPECT_EQ(vec[i], i);
+
+  // Regular pages are granular, any size can be requested anyway
+  pmr_adapter<regular_pages_resource> pages;
+  std::pmr::vector<char> pages_vec(100, 'a', &pages);
+  EXPECT_EQ(pages_vec.back(), 'a');
+}
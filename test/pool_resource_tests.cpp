@@ -1,3 +1,4 @@
+#include <array>
 #include <bit>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -46,6 +47,17 @@ TEST(PoolResourceStaticTests, chunk_sizes) {
                                         .max_chunk_size = 1_KiB,
                                         .chunk_size_multiplier = 1 }>;
   EXPECT_THAT(pr3_t::chunk_sizes, ElementsAre(1_KiB));
+
+  using pr4_t =  // explicit sizes
+    pool_resource<upstream_t,
+                  pool_resource_config{
+                    .min_chunk_size = pow2_t{1_KiB},
+                    .max_chunk_size = 16_KiB,
+                    .explicit_chunk_sizes = { 1_KiB, 5_KiB, 6_KiB, 7_KiB,
+                                              8_KiB, 16_KiB }
+                  }>;
+  EXPECT_THAT(pr4_t::chunk_sizes,
+              ElementsAre(1_KiB, 5_KiB, 6_KiB, 7_KiB, 8_KiB, 16_KiB));
 }
 
 
@@ -79,12 +91,46 @@ constexpr pool_resource_config pool2_config = {
   .thread_safe = _thread_safe
 };
 
+template <bool _thread_safe>
+constexpr pool_resource_config pool3_config = {
+  .min_chunk_size = pow2_t{1024},
+  .max_chunk_size = 8192,
+  .chunk_size_multiplier = 2,
+  .explicit_chunk_sizes = { 1024, 2048, 3072, 5120, 7168, 8192 },
+  .thread_safe = _thread_safe
+};
+
+constexpr pool_resource_config cached_pool_config = {
+  .min_chunk_size = pow2_t{1024},
+  .max_chunk_size = 8192,
+  .chunk_size_multiplier = 2,
+  .thread_safe = true,
+  .thread_cache_size = 8
+};
+
+constexpr pool_resource_config trimmable_pool_config = {
+  .min_chunk_size = pow2_t{1024},
+  .max_chunk_size = 8192,
+  .chunk_size_multiplier = 2,
+  .thread_safe = true,
+  .trimmable = true
+};
+
 template <resource R, bool _thread_safe = true>
 using pool1_t = pool_resource<R, pool1_config<_thread_safe>>;
 
 template <resource R, bool _thread_safe = true>
 using pool2_t = pool_resource<R, pool2_config<_thread_safe>>;
 
+template <resource R, bool _thread_safe = true>
+using pool3_t = pool_resource<R, pool3_config<_thread_safe>>;
+
+template <resource R>
+using cached_pool_t = pool_resource<R, cached_pool_config>;
+
+template <resource R>
+using trimmable_pool_t = pool_resource<R, trimmable_pool_config>;
+
 template <typename T>
 class PoolResourceTestsBase: public testing::Test {
 protected:
@@ -528,6 +574,368 @@ TYPED_TEST(PoolResourceTests, deallocation) {
   this->deallocate_all();
 }
 
+TEST(PoolResourceExplicitSizesTests, allocation) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{
+                    .min_chunk_size = pow2_t{1_KiB},
+                    .max_chunk_size = 12_KiB,
+                    .explicit_chunk_sizes = { 1_KiB, 3_KiB, 12_KiB }
+                  }>;
+
+  constexpr size_t block_size = 24_KiB;
+  alignas(4_KiB) static std::byte block[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB)).WillOnce(Return(block));
+
+  auto pool = std::make_unique<pool_t>(mock);
+
+  // The rest of the block is split into 12KiB + 3 * 3KiB chunks, so
+  // every next allocation gets a chunk of exactly its size class
+  EXPECT_EQ(pool->allocate(3_KiB), block);
+  EXPECT_EQ(pool->allocate(3_KiB), block + 15_KiB);
+  EXPECT_EQ(pool->allocate(12_KiB), block + 3_KiB);
+  EXPECT_EQ(pool->allocate(2_KiB), block + 18_KiB);
+  EXPECT_EQ(pool->allocate(1_KiB), block + 20_KiB);
+
+  pool->deallocate(block, 21_KiB);
+
+  EXPECT_CALL(mock, deallocate(block, block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceThreadCacheTests, local_reuse) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = true,
+                                        .thread_cache_size = 4 }>;
+
+  constexpr size_t block_size = 8_KiB;
+  alignas(1_KiB) static std::byte block[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB)).WillOnce(Return(block));
+
+  auto pool = std::make_unique<pool_t>(mock);
+
+  // The first allocation also creates the magazine of this thread
+  const auto ptr1 = pool->allocate(1_KiB);
+  ASSERT_NE(ptr1, nullptr);
+
+  pool->deallocate(ptr1, 1_KiB);
+  EXPECT_EQ(pool->allocate(1_KiB), ptr1);  // Taken from the magazine
+  pool->deallocate(ptr1, 1_KiB);
+
+  // But not by any other thread
+  void* ptr2 = nullptr;
+  std::thread([&pool, &ptr2]() {
+    ptr2 = pool->allocate(1_KiB);
+    EXPECT_NE(ptr2, nullptr);
+  }).join();
+  EXPECT_NE(ptr2, ptr1);
+  pool->deallocate(ptr2, 1_KiB);
+
+  // Everything (including the magazines) must be merged back
+  EXPECT_CALL(mock, deallocate(block, block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceThreadCacheTests, remote_free) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = true,
+                                        .thread_cache_size = 4 }>;
+
+  constexpr size_t block_size = 8_KiB;
+  alignas(4_KiB) static std::byte blocks[2 * block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB))
+    .WillOnce(Return(blocks)).WillOnce(Return(blocks + block_size));
+
+  auto pool = std::make_unique<pool_t>(mock);
+
+  // The producer takes 5 chunks from the first block (after its
+  // magazine)
+  std::set<void*> produced;
+  for (size_t i = 0; i < 5; ++i) produced.insert(pool->allocate(1_KiB));
+  EXPECT_EQ(produced.size(), 5);
+
+  // The consumer gets its own magazine (from the second block) and
+  // flushes the first 3 chunks that don't fit into it as a batch
+  std::thread([&pool, &produced]() {
+    for (const auto ptr : produced) pool->deallocate(ptr, 1_KiB);
+  }).join();
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(6, 2, 1));
+
+  // Which is taken by the producer at once when its magazine is empty
+  std::array<void*, 4> ptrs;
+  for (size_t i = 0; i < 3; ++i) {
+    ptrs[i] = pool->allocate(1_KiB);
+    EXPECT_TRUE(produced.contains(ptrs[i]));
+  }
+
+  ptrs[3] = pool->allocate(1_KiB);
+  EXPECT_GE(ptrs[3], blocks + block_size);
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(2, 2, 1));
+
+  for (const auto ptr : ptrs) pool->deallocate(ptr, 1_KiB);
+
+  EXPECT_CALL(mock, deallocate(blocks, 2 * block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceTrimTests, release_unused) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = false,
+                                        .trimmable = true }>;
+
+  // Every block loses its last 1KiB to the header
+  constexpr size_t block_size = 8_KiB;
+  alignas(1_KiB) static std::byte block1[block_size];
+  alignas(1_KiB) static std::byte block2[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB))
+    .WillOnce(Return(block1)).WillOnce(Return(block2));
+
+  auto pool = std::make_unique<pool_t>(mock);
+
+  const auto ptr1 = pool->allocate(4_KiB);
+  EXPECT_EQ(ptr1, block1);
+  const auto ptr2 = pool->allocate(4_KiB);
+  EXPECT_EQ(ptr2, block2);
+
+  EXPECT_EQ(pool->release_unused(), 0);
+
+  // Now the first block is entirely free
+  pool->deallocate(ptr1, 4_KiB);
+  EXPECT_CALL(mock, deallocate(block1, block_size, 1_KiB));
+  EXPECT_EQ(pool->release_unused(), block_size);
+
+  // But the free chunks of the second one are still there
+  const auto ptr3 = pool->allocate(2_KiB);
+  EXPECT_EQ(ptr3, block2 + 4_KiB);
+
+  pool->deallocate(ptr3, 2_KiB);
+  pool->deallocate(ptr2, 4_KiB);
+  EXPECT_EQ(pool->release_unused(block_size), 0);
+
+  EXPECT_CALL(mock, deallocate(block2, block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceBatchTests, allocation) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = false }>;
+
+  constexpr size_t block_size = 8_KiB;
+  alignas(4_KiB) static std::byte block[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(_, _)).WillRepeatedly(Return(nullptr));
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB)).WillOnce(Return(block))
+    .RetiresOnSaturation();
+
+  auto pool = std::make_unique<pool_t>(mock);
+
+  // All the block is split into 1KiB regions and then it runs out
+  std::array<void*, 10> ptrs;
+  ASSERT_EQ(pool->allocate_batch(ptrs.size(), 1_KiB, 1_KiB, ptrs.data()), 8);
+
+  const std::set<void*> all_ptrs(ptrs.begin(), ptrs.begin() + 8);
+  EXPECT_EQ(all_ptrs.size(), 8);
+  for (const auto ptr : all_ptrs) {
+    EXPECT_GE(ptr, block);
+    EXPECT_LT(ptr, block + block_size);
+  }
+
+  // Deallocated chunks are taken back in parts
+  pool->deallocate_batch(8, 1_KiB, 1_KiB, ptrs.data());
+
+  std::array<void*, 8> ptrs2;
+  EXPECT_EQ(pool->allocate_batch(3, 1_KiB, 1_KiB, ptrs2.data()), 3);
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(5, 0, 0));
+  EXPECT_EQ(pool->allocate_batch(6, 1_KiB, 1_KiB, ptrs2.data() + 3), 5);
+  EXPECT_EQ(std::set<void*>(ptrs2.begin(), ptrs2.end()), all_ptrs);
+
+  // Bigger sizes are made of smaller chunks one by one as usual
+  pool->deallocate_batch(8, 1_KiB, 1_KiB, ptrs2.data());
+  EXPECT_EQ(pool->allocate_batch(2, 4_KiB, 4_KiB, ptrs.data()), 0);
+
+  EXPECT_CALL(mock, deallocate(block, block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceBatchTests, thread_cache) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = true,
+                                        .thread_cache_size = 4 }>;
+
+  constexpr size_t block_size = 8_KiB;
+  alignas(1_KiB) static std::byte block[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB)).WillOnce(Return(block));
+
+  auto pool = std::make_unique<pool_t>(mock);
+
+  std::array<void*, 4> ptrs;
+  ASSERT_EQ(pool->allocate_batch(4, 1_KiB, 1_KiB, ptrs.data()), 4);
+
+  // The magazine takes all of them back and gives them out again
+  pool->deallocate_batch(4, 1_KiB, 1_KiB, ptrs.data());
+
+  std::array<void*, 4> ptrs2;
+  ASSERT_EQ(pool->allocate_batch(4, 1_KiB, 1_KiB, ptrs2.data()), 4);
+  EXPECT_EQ(std::set<void*>(ptrs.begin(), ptrs.end()),
+            std::set<void*>(ptrs2.begin(), ptrs2.end()));
+
+  pool->deallocate_batch(4, 1_KiB, 1_KiB, ptrs2.data());
+
+  EXPECT_CALL(mock, deallocate(block, block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceStatsTests, count_free_chunks) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = true,
+                                        .thread_cache_size = 4 }>;
+
+  constexpr size_t block_size = 8_KiB;
+  alignas(4_KiB) static std::byte block[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB)).WillOnce(Return(block));
+
+  auto pool = std::make_unique<pool_t>(mock);
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(0, 0, 0));
+
+  // The magazine takes one chunk, the rest of the block is split
+  const auto ptr = pool->allocate(2_KiB);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(1, 0, 1));
+
+  // The cached chunks are counted as well
+  pool->deallocate(ptr, 2_KiB);
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(1, 1, 1));
+
+  EXPECT_CALL(mock, deallocate(block, block_size, 1_KiB));
+  pool.reset();
+}
+
+TEST(PoolResourceLargeTests, pass_through) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = false,
+                                        .large_allocations =
+                                          large_allocation_mode::pass_through
+                                      }>;
+
+  EXPECT_TRUE(nothrow_resource<pool_t>);
+  EXPECT_FALSE(sweeping_resource<pool_t>);
+
+  alignas(8_KiB) static std::byte block[16_KiB];
+
+  mock_resource mock;
+  auto pool = std::make_unique<pool_t>(mock);
+
+  // Large regions go right to the upstream and back
+  EXPECT_CALL(mock, allocate(16_KiB, 1_KiB)).WillOnce(Return(block));
+  EXPECT_EQ(pool->allocate(16_KiB), block);
+
+  EXPECT_CALL(mock, deallocate(block, 16_KiB, 1_KiB));
+  pool->deallocate(block, 16_KiB);
+
+  // Over-aligned ones keep their alignment
+  EXPECT_CALL(mock, allocate(12_KiB, 8_KiB)).WillOnce(Return(block));
+  EXPECT_EQ(pool->allocate(12_KiB, 8_KiB), block);
+
+  EXPECT_CALL(mock, deallocate(block, 12_KiB, 8_KiB));
+  pool->deallocate(block, 12_KiB, 8_KiB);
+
+  // Nothing is left for the destructor
+  pool.reset();
+}
+
+TEST(PoolResourceLargeTests, cached) {
+  using pool_t =
+    pool_resource<upstream1_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = true,
+                                        .trimmable = true,
+                                        .large_allocations =
+                                          large_allocation_mode::cached,
+                                        .max_cached_large_size = 64_KiB }>;
+
+  alignas(1_KiB) static std::byte block1[10_KiB];
+  alignas(1_KiB) static std::byte block2[10_KiB];
+  alignas(1_KiB) static std::byte block3[128_KiB];
+
+  mock_resource mock;
+  auto pool = std::make_unique<pool_t>(mock);
+
+  // 9KiB are ceiled to the 10KiB class
+  EXPECT_CALL(mock, allocate(10_KiB, 1_KiB))
+    .WillOnce(Return(block1)).WillOnce(Return(block2));
+  const auto ptr1 = pool->allocate(9_KiB);
+  EXPECT_EQ(ptr1, block1);
+
+  // The whole region is reused by the same class
+  pool->deallocate(ptr1, 9_KiB);
+  EXPECT_EQ(pool->allocate(10_KiB), block1);
+
+  std::array<void*, 2> ptrs;
+  EXPECT_EQ(pool->allocate_batch(1, 9_KiB, 1_KiB, ptrs.data()), 1);
+  EXPECT_EQ(ptrs[0], block2);
+
+  ptrs[1] = block1;
+  pool->deallocate_batch(2, 10_KiB, 1_KiB, ptrs.data());
+  EXPECT_THAT(pool->count_free_chunks(), ElementsAre(0, 0, 0));
+
+  // The regions above the limit are passed through
+  EXPECT_CALL(mock, allocate(128_KiB, 1_KiB)).WillOnce(Return(block3));
+  EXPECT_EQ(pool->allocate(128_KiB), block3);
+
+  EXPECT_CALL(mock, deallocate(block3, 128_KiB, 1_KiB));
+  pool->deallocate(block3, 128_KiB);
+
+  // The cached ones are returned on release_unused()
+  EXPECT_CALL(mock, deallocate(block1, 10_KiB, 1_KiB));
+  EXPECT_CALL(mock, deallocate(block2, 10_KiB, 1_KiB));
+  EXPECT_EQ(pool->release_unused(), 20_KiB);
+
+  pool.reset();
+}
+
 template <typename T>
 class PoolResourceThreadingTests: public resource_multithreaded_test,
                                   public PoolResourceTestsBase<T> {
@@ -561,7 +969,11 @@ using ThreadSafePoolResources =
   testing::Types<pool1_t<upstream1_t>, pool1_t<upstream2_t>,
                  pool1_t<upstream3_t>,
                  pool2_t<upstream1_t>, pool2_t<upstream2_t>,
-                 pool2_t<upstream3_t>>;
+                 pool2_t<upstream3_t>,
+                 pool3_t<upstream1_t>, pool3_t<upstream2_t>,
+                 cached_pool_t<upstream1_t>, cached_pool_t<upstream2_t>,
+                 trimmable_pool_t<upstream1_t>,
+                 trimmable_pool_t<upstream2_t>>;
 TYPED_TEST_SUITE(PoolResourceThreadingTests, ThreadSafePoolResources);
 
 TYPED_TEST(PoolResourceThreadingTests, randomized_multithread) {
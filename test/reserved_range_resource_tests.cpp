@@ -0,0 +1,213 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <latch>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "memaw/cache_resource.hpp"
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/reserved_range_resource.hpp"
+
+#if !MEMAW_IS(OS, WINDOWS)
+#  include <unistd.h>
+#endif
+
+using namespace memaw;
+
+using rrt_range1_t = reserved_range_resource<>;
+using rrt_range2_t =
+  reserved_range_resource<reserved_range_resource_config{
+                            .reserve_size = 64_MiB,
+                            .commit_size = 1,  // i.e., a page
+                            .thread_safe = false
+                          }>;
+
+#if !MEMAW_IS(OS, WINDOWS)
+/**
+ * @brief Checks if the address is readable by making the kernel read
+ *        it (to write to a pipe), which fails instead of crashing
+ **/
+bool rrt_is_readable(const void* const ptr) {
+  int fds[2];
+  if (::pipe(fds) != 0) return false;
+
+  const bool result = ::write(fds[1], ptr, 1) == 1;
+  ::close(fds[0]);
+  ::close(fds[1]);
+  return result;
+}
+#endif
+
+TEST(ReservedRangeResourceTests, concepts) {
+  EXPECT_TRUE(resource<rrt_range1_t>);
+  EXPECT_TRUE(bound_resource<rrt_range1_t>);
+  EXPECT_TRUE(granular_resource<rrt_range1_t>);
+  EXPECT_TRUE(overaligning_resource<rrt_range1_t>);
+  EXPECT_TRUE(sweeping_resource<rrt_range1_t>);
+  EXPECT_TRUE(thread_safe_resource<rrt_range1_t>);
+  EXPECT_TRUE(nothrow_resource<rrt_range1_t>);
+  EXPECT_TRUE(purging_resource<rrt_range1_t>);
+
+  EXPECT_FALSE(thread_safe_resource<rrt_range2_t>);
+  EXPECT_FALSE((interchangeable_resource_with<rrt_range1_t, rrt_range1_t>));
+}
+
+TEST(ReservedRangeResourceTests, allocation) {
+  rrt_range2_t res;
+  ASSERT_NE(res.range_begin(), nullptr);
+  EXPECT_EQ(res.reserved_size(), 64_MiB);
+  EXPECT_EQ(res.used_size(), 0);
+
+  const auto page_size = res.min_size();
+  EXPECT_EQ(res.allocate(page_size / 2), nullptr);  // Not a multiple
+
+  // Subsequent allocations are contiguous and accessible
+  const auto begin = static_cast<char*>(res.range_begin());
+  std::vector<std::pair<void*, size_t>> allocs;
+  for (size_t i = 1; i <= 8; ++i) {
+    const auto ptr = static_cast<char*>(res.allocate(page_size * i));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(ptr, begin + res.used_size() - page_size * i);
+    for (size_t j = 0; j < page_size * i; ++j) ptr[j] = 'x';
+    allocs.emplace_back(ptr, page_size * i);
+  }
+
+  EXPECT_EQ(res.used_size(), page_size * 36);
+
+  // Overaligned allocations skip the addresses before
+  const auto aligned = res.allocate(page_size, 1_MiB);
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(uintptr_t(aligned) % 1_MiB, 0);
+  static_cast<char*>(aligned)[0] = 'x';
+#if !MEMAW_IS(OS, WINDOWS)
+  // ...and don't commit them
+  const auto before_aligned = static_cast<char*>(aligned) - page_size;
+  if (before_aligned >= begin + page_size * 36) {
+    EXPECT_FALSE(rrt_is_readable(before_aligned));
+  }
+#endif
+  res.deallocate(aligned, page_size);
+
+  // Adjacent regions can be decommitted at once
+  res.deallocate(allocs[0].first, allocs[0].second + allocs[1].second);
+  for (size_t i = 2; i < allocs.size(); ++i)
+    res.deallocate(allocs[i].first, allocs[i].second);
+
+  // The range is exhausted eventually
+  EXPECT_EQ(res.allocate(64_MiB), nullptr);
+  EXPECT_NE(res.allocate(page_size), nullptr);
+
+  // Moving leaves the source empty
+  rrt_range2_t res2{std::move(res)};
+  EXPECT_EQ(res2.range_begin(), begin);
+  EXPECT_EQ(res.range_begin(), nullptr);
+  EXPECT_EQ(res.allocate(page_size), nullptr);
+}
+
+TEST(ReservedRangeResourceTests, multithreaded) {
+  constexpr size_t ThreadsCount = 8;
+  constexpr size_t AllocsCount = 256;
+
+  rrt_range1_t res;
+  ASSERT_NE(res.range_begin(), nullptr);
+
+  const auto page_size = res.min_size();
+  std::vector<std::vector<std::pair<char*, size_t>>> allocs(ThreadsCount);
+
+  std::latch latch{ThreadsCount};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < ThreadsCount; ++i) {
+    threads.emplace_back([&, i]() {
+      latch.arrive_and_wait();
+      for (size_t j = 0; j < AllocsCount; ++j) {
+        const auto size = page_size * (1 + (i + j) % 4);
+        const auto ptr = static_cast<char*>(res.allocate(size));
+        ASSERT_NE(ptr, nullptr);
+
+        // Must be committed (i.e., accessible) right away
+        ptr[0] = ptr[size - 1] = 'x';
+        allocs[i].emplace_back(ptr, size);
+      }
+    });
+  }
+
+  for (auto& t : threads) t.join();
+
+  // Everything must be within the range and fit it exactly
+  size_t total_size = 0;
+  for (const auto& list : allocs) {
+    for (const auto& [ptr, size] : list) {
+      EXPECT_GE(ptr, static_cast<char*>(res.range_begin()));
+      EXPECT_LE(ptr + size,
+                static_cast<char*>(res.range_begin()) + res.used_size());
+      total_size+= size;
+      res.deallocate(ptr, size);
+    }
+  }
+
+  EXPECT_EQ(total_size, res.used_size());
+}
+
+#if !MEMAW_IS(OS, WINDOWS)
+TEST(ReservedRangeResourceTests, multithreaded_decommit) {
+  constexpr size_t ThreadsCount = 8;
+  constexpr size_t AllocsCount = 1024;
+
+  // Commit page by page, so that the threads keep advancing the
+  // committed offset while the others deallocate
+  reserved_range_resource<reserved_range_resource_config{
+                            .reserve_size = 1_GiB,
+                            .commit_size = 1
+                          }> res;
+  ASSERT_NE(res.range_begin(), nullptr);
+
+  const auto page_size = res.min_size();
+  std::vector<std::vector<char*>> allocs(ThreadsCount);
+
+  std::latch latch{ThreadsCount};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < ThreadsCount; ++i) {
+    threads.emplace_back([&, i]() {
+      latch.arrive_and_wait();
+      for (size_t j = 0; j < AllocsCount; ++j) {
+        const auto ptr = static_cast<char*>(res.allocate(page_size));
+        ASSERT_NE(ptr, nullptr);
+        ptr[0] = 'x';
+        res.deallocate(ptr, page_size);
+        allocs[i].push_back(ptr);
+      }
+    });
+  }
+
+  for (auto& t : threads) t.join();
+
+  // No deallocated page may have been committed again
+  for (const auto& list : allocs)
+    for (const auto ptr : list) EXPECT_FALSE(rrt_is_readable(ptr));
+}
+#endif
+
+TEST(ReservedRangeResourceTests, cache_upstream) {
+  using cache_t =
+    cache_resource<reserved_range_resource<reserved_range_resource_config{
+                                             .reserve_size = 1_GiB }>,
+                   cache_resource_config{ .min_block_size = 1_MiB,
+                                          .max_block_size = 4_MiB }>;
+  cache_t cache;
+
+  // The blocks are adjacent so the allocations are too
+  char* prev = nullptr;
+  for (size_t i = 0; i < 16; ++i) {
+    const auto ptr = static_cast<char*>(cache.allocate(1_MiB));
+    ASSERT_NE(ptr, nullptr);
+    ptr[0] = 'x';
+
+    if (prev) {
+      EXPECT_EQ(ptr, prev + 1_MiB);
+    }
+    prev = ptr;
+    cache.deallocate(ptr, 1_MiB);
+  }
+}
@@ -1,10 +1,20 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <memory_resource>
+#include <new>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "memaw/concepts.hpp"
 #include "memaw/literals.hpp"
 #include "memaw/resource_traits.hpp"
+#include "memaw/__detail/resource_common.hpp"
+#include "memaw/__detail/tagged_ptr.hpp"
 
 #include "test_resource.hpp"
 
@@ -23,7 +33,9 @@ using common_res1_t =
   test_resource<resource_params{ .nothrow_alloc = true,
                                  .nothrow_dealloc = true,
                                  .is_sweeping = true,
-                                 .is_thread_safe = true }>;
+                                 .is_thread_safe = true,
+                                 .is_purging = true,
+                                 .is_expanding = true }>;
 using common_res2_t =
   test_resource<resource_params{ .min_size = 1024, .alignment = 8_KiB,
                                  .is_granular = true }>;
@@ -56,6 +68,12 @@ TEST(ResourceTraitsTests, concepts) {
 
   EXPECT_TRUE(traits1_t::is_thread_safe);
   EXPECT_FALSE(traits2_t::is_thread_safe);
+
+  EXPECT_TRUE(traits1_t::is_purging);
+  EXPECT_FALSE(traits2_t::is_purging);
+
+  EXPECT_TRUE(traits1_t::is_expanding);
+  EXPECT_FALSE(traits2_t::is_expanding);
 }
 
 TEST(ResourceTraitsTests, free_functions) {
@@ -101,4 +119,168 @@ TEST(ResourceTraitsTests, free_functions) {
   const auto al_res2 = allocate_at_least<exceptions_policy::nothrow>(res3, 42);
   EXPECT_EQ(al_res2.ptr, nullptr);
   EXPECT_EQ(al_res2.size, 1024);
+
+  // Batches fall back to the single calls, stopping at a failure
+  std::array<void*, 4> ptrs;
+  EXPECT_CALL(throwing_mock, allocate(42, 1024)).Times(3)
+    .WillOnce(Return(&ptrs)).WillOnce(Return(&ptrs))
+    .WillOnce([] (auto...) -> void* { throw 42; }).RetiresOnSaturation();
+  EXPECT_EQ(allocate_batch(res3, ptrs.size(), 42, 1024, ptrs.data()), 2);
+
+  ptrs[2] = nullptr;
+  EXPECT_CALL(throwing_mock, deallocate(&ptrs, 42, 1024)).Times(2)
+    .RetiresOnSaturation();
+  deallocate_batch(res3, 3, 42, 1024, ptrs.data());
+
+  // Purging is a no-op for resources that don't support it
+  EXPECT_CALL(non_throwing_mock, purge(nullptr, 42)).Times(1);
+  EXPECT_TRUE(purge(res1, nullptr, 42));
+  EXPECT_FALSE(purge(res2, nullptr, 42));
+}
+
+TEST(ResourceTraitsTests, reallocation) {
+  mock_resource mock;
+  common_res1_t res1{mock};
+  common_res2_t res2{mock};
+
+  std::array<char, 1024> buffer1 = { 'a', 'b', 'c', 'd' };
+  std::array<char, 1024> buffer2 = {};
+
+  // Equal sizes need no calls at all
+  EXPECT_TRUE(expand(res1, buffer1.data(), 42, 42));
+  EXPECT_TRUE(expand(res2, buffer1.data(), 42, 42));
+
+  EXPECT_CALL(mock, expand(buffer1.data(), 4, 8)).Times(2)
+    .WillRepeatedly(Return(true));
+  EXPECT_TRUE(expand(res1, buffer1.data(), 4, 8));
+  EXPECT_FALSE(expand(res2, buffer1.data(), 4, 8));
+
+  EXPECT_EQ(reallocate(res1, buffer1.data(), 4, 8), buffer1.data());
+
+  // Otherwise the contents are copied to a new region
+  EXPECT_CALL(mock, expand(buffer1.data(), 4, 64)).WillOnce(Return(false));
+  EXPECT_CALL(mock, allocate(64, alignof(std::max_align_t)))
+    .WillOnce(Return(buffer2.data()));
+  EXPECT_CALL(mock, deallocate(buffer1.data(), 4, alignof(std::max_align_t)));
+  EXPECT_EQ(reallocate(res1, buffer1.data(), 4, 64), buffer2.data());
+  EXPECT_EQ(std::string_view(buffer2.data(), 4), "abcd");
+
+  // And the old one stays if that fails
+  EXPECT_CALL(mock, allocate(2048, 16)).WillOnce(Return(nullptr));
+  EXPECT_EQ(reallocate<exceptions_policy::nothrow>(res2, buffer2.data(),
+                                                   1024, 2048, 16),
+            nullptr);
+}
+
+TEST(ResourceCommonTests, sort_list) {
+  struct item_t {
+    item_t* next;
+  };
+
+  constexpr size_t count = 1000;
+  std::array<item_t, count> items;
+
+  std::array<item_t*, count> order;
+  for (size_t i = 0; i < count; ++i) order[i] = &items[i];
+  std::ranges::shuffle(order, std::mt19937{42});
+
+  for (size_t i = 0; i < count; ++i)
+    order[i]->next = (i + 1 < count) ? order[i + 1] : nullptr;
+
+  EXPECT_EQ(__detail::sort_list<item_t>(nullptr), nullptr);
+
+  auto item = __detail::sort_list(order[0]);
+  for (size_t i = 0; i < count; ++i, item = item->next)
+    ASSERT_EQ(item, &items[i]);
+  EXPECT_EQ(item, nullptr);
+}
+
+TEST(ResourceCommonTests, merge_chunks) {
+  struct chunk_t {
+    chunk_t* next;
+    size_t size;
+  };
+
+  constexpr size_t count = 1000;
+  constexpr size_t chunk_size = 2 * sizeof(chunk_t);
+  alignas(chunk_t) std::array<std::byte, count * chunk_size> memory;
+
+  const auto get_chunk = [&memory](const size_t id) {
+    return reinterpret_cast<chunk_t*>(memory.data() + id * chunk_size);
+  };
+
+  // Take all the chunks but every 100th in a random order
+  std::vector<chunk_t*> order;
+  for (size_t i = 0; i < count; ++i)
+    if (i % 100 != 99) order.push_back(new (get_chunk(i)) chunk_t{});
+  std::ranges::shuffle(order, std::mt19937{42});
+
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i]->next = (i + 1 < order.size()) ? order[i + 1] : nullptr;
+
+  // The first half of the list goes first to test the sorted part
+  const auto middle = order[order.size() / 2 - 1];
+  const auto second_half = std::exchange(middle->next, nullptr);
+
+  auto regions = __detail::merge_chunks(order[0], chunk_size);
+  regions = __detail::merge_chunks(second_half, chunk_size, regions);
+
+  for (size_t i = 0; i < count / 100; ++i, regions = regions->next) {
+    ASSERT_EQ(regions, get_chunk(i * 100));
+    EXPECT_EQ(regions->size, 99 * chunk_size);
+  }
+  EXPECT_EQ(regions, nullptr);
+}
+
+TEST(ResourceCommonTests, tagged_ptr) {
+  using unpacked_t = __detail::tagged_ptr<std::byte, __detail::thread_safe,
+                                          64, false>;
+  using packed_t = __detail::tagged_ptr<std::byte, __detail::thread_safe,
+                                        64, true>;
+
+  EXPECT_FALSE(unpacked_t::is_packed);
+  EXPECT_TRUE(packed_t::is_packed);
+  EXPECT_EQ(sizeof(packed_t), sizeof(uint64_t));
+
+  // The tag takes the high bits and the ones zeroed by the alignment
+  EXPECT_EQ(packed_t::tag_bits, 22);
+  EXPECT_EQ(packed_t::max_tag, (size_t(1) << 22) - 1);
+  EXPECT_EQ(unpacked_t::max_tag, ~size_t(0));
+
+  alignas(64) std::array<std::byte, 128> memory;
+  const auto ptr = memory.data() + 64;
+
+  packed_t packed{ptr, packed_t::max_tag};
+  EXPECT_EQ(packed.ptr(), ptr);
+  EXPECT_EQ(packed.tag(), packed_t::max_tag);
+
+  // The packed tag wraps around
+  packed = { ptr, packed_t::max_tag + 1 };
+  EXPECT_EQ(packed.ptr(), ptr);
+  EXPECT_EQ(packed.tag(), 0);
+
+  packed = { nullptr, 42 };
+  EXPECT_EQ(packed.ptr(), nullptr);
+  EXPECT_EQ(packed.tag(), 42);
+
+  constexpr auto relaxed = std::memory_order_relaxed;
+
+  unpacked_t unpacked{ptr, ~size_t(0)};
+  EXPECT_EQ(unpacked_t::load_ptr(unpacked, relaxed), ptr);
+  EXPECT_EQ(unpacked_t::load(unpacked, relaxed).tag(), ~size_t(0));
+
+  // Both compare as a whole and are changed by a single CAS
+  auto old_packed = packed_t::load(packed, relaxed);
+  EXPECT_EQ(old_packed, packed);
+  EXPECT_TRUE(__detail::make_mem_ref<__detail::thread_safe>(packed)
+              .compare_exchange_strong(old_packed, packed_t{ ptr, 43 },
+                                       relaxed, relaxed));
+  EXPECT_EQ(packed.ptr(), ptr);
+  EXPECT_EQ(packed.tag(), 43);
+
+  auto old_unpacked = unpacked_t{ ptr, 0 };
+  EXPECT_FALSE(__detail::make_mem_ref<__detail::thread_safe>(unpacked)
+               .compare_exchange_strong(old_unpacked, unpacked_t{},
+                                        relaxed, relaxed));
+  EXPECT_EQ(old_unpacked, unpacked);
 }
@@ -0,0 +1,138 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "memaw/chain_resource.hpp"
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/segregator_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+template <size_t _min_size, size_t _alignment, bool _granular,
+          int _group = 0>
+constexpr resource_params sgt_params =
+  { .nothrow_alloc = true, .nothrow_dealloc = true,
+    .min_size = _min_size, .alignment = _alignment,
+    .is_granular = _granular, .is_thread_safe = true,
+    .group = {_group, 0} };
+
+template <size_t _min_size = 0, size_t _alignment = 0, bool _granular = false,
+          int _group = 0, size_t _idx = 0>
+using sgt_resource =
+  test_resource<sgt_params<_min_size, _alignment, _granular, _group>, _idx>;
+
+TEST(SegregatorResourceTests, concepts) {
+  using seg1_t = segregator_resource<256, sgt_resource<16, 64, true>,
+                                     sgt_resource<0, 0, false, 0, 1>>;
+  using seg2_t = segregator_resource<1_KiB, sgt_resource<8, 128>,
+                                     sgt_resource<24, 256, true, 1>>;
+  using seg3_t = segregator_resource<1_MiB, regular_pages_resource,
+                                     big_pages_resource>;
+
+  EXPECT_TRUE(resource<seg1_t>);
+  EXPECT_TRUE(nothrow_resource<seg1_t>);
+  EXPECT_TRUE(thread_safe_resource<seg1_t>);
+  EXPECT_TRUE(granular_resource<seg1_t>);
+  EXPECT_FALSE(overaligning_resource<seg1_t>);
+  EXPECT_FALSE(sweeping_resource<seg1_t>);
+  EXPECT_EQ(seg1_t::min_size(), 16);
+
+  // Only the Small resource determines the allocation sizes
+  EXPECT_FALSE(granular_resource<seg2_t>);
+  EXPECT_TRUE(overaligning_resource<seg2_t>);
+  EXPECT_EQ(seg2_t::min_size(), 8);
+  EXPECT_EQ(seg2_t::guaranteed_alignment(), 128);
+
+  using seg4_t = segregator_resource<1, test_resource<>, sgt_resource<>>;
+  EXPECT_FALSE(nothrow_resource<seg4_t>);
+  EXPECT_FALSE(thread_safe_resource<seg4_t>);
+  EXPECT_FALSE(bound_resource<seg4_t>);
+
+  // The segregator of equal_instances resources also has them
+  EXPECT_TRUE((interchangeable_resource_with<seg3_t, seg3_t>));
+  EXPECT_TRUE((interchangeable_resource_with<seg3_t, regular_pages_resource>));
+  EXPECT_TRUE((interchangeable_resource_with<seg1_t, sgt_resource<>>));
+  EXPECT_FALSE((interchangeable_resource_with<seg2_t, sgt_resource<>>));
+
+  // Can be chained with a substitutable deallocator
+  EXPECT_TRUE((resource<chain_resource<seg3_t, regular_pages_resource>>));
+}
+
+TEST(SegregatorResourceTests, routing) {
+  mock_resource small, large;
+
+  segregator_resource<128, sgt_resource<>, sgt_resource<0, 0, false, 0, 1>>
+    seg{sgt_resource<>{small}, sgt_resource<0, 0, false, 0, 1>{large}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  EXPECT_CALL(small, allocate(1, _)).WillOnce(Return(ptr));
+  EXPECT_CALL(small, allocate(128, 64)).WillOnce(Return(nullptr));
+  EXPECT_CALL(large, allocate(129, _)).WillOnce(Return(ptr));
+  EXPECT_CALL(large, allocate(1_MiB, 64)).WillOnce(Return(ptr));
+
+  EXPECT_EQ(seg.allocate(1), ptr);
+  EXPECT_EQ(seg.allocate(128, 64), nullptr);  // No fallback to large
+  EXPECT_EQ(seg.allocate(129), ptr);
+  EXPECT_EQ(seg.allocate(1_MiB, 64), ptr);
+
+  EXPECT_CALL(small, deallocate(ptr, 1, _));
+  EXPECT_CALL(large, deallocate(ptr, 129, _));
+  EXPECT_CALL(large, deallocate(ptr, 1_MiB, 64));
+
+  seg.deallocate(ptr, 1);
+  seg.deallocate(ptr, 129);
+  seg.deallocate(ptr, 1_MiB, 64);
+}
+
+TEST(SegregatorResourceTests, ceiling) {
+  mock_resource small, large;
+
+  using small_t = sgt_resource<16, 0, true>;
+  using large_t = sgt_resource<4_KiB, 0, true, 0, 1>;
+  using seg_t = segregator_resource<32, small_t,
+                                    segregator_resource<64, small_t, large_t>>;
+
+  EXPECT_EQ(resource_traits<seg_t>::ceil_allocation_size(1), 16);
+  EXPECT_EQ(resource_traits<seg_t>::ceil_allocation_size(100), 112);
+
+  seg_t seg{small_t{small}, {small_t{small}, large_t{large}}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  // The small allocations are not ceiled to the large granule
+  EXPECT_CALL(small, allocate(16, _)).WillOnce(Return(ptr));
+  EXPECT_CALL(small, deallocate(ptr, 16, _));
+
+  const auto result = allocate_at_least(seg, 1);
+  EXPECT_EQ(result.ptr, ptr);
+  EXPECT_EQ(result.size, 16);
+  seg.deallocate(result.ptr, result.size);
+
+  // While the Large one still gets the sizes it accepts
+  EXPECT_CALL(large, allocate(4_KiB, _)).WillOnce(Return(ptr));
+  EXPECT_CALL(large, deallocate(ptr, 4_KiB, _));
+
+  const auto result2 = allocate_at_least(seg, 100);
+  EXPECT_EQ(result2.ptr, ptr);
+  EXPECT_EQ(result2.size, 112);
+  seg.deallocate(result2.ptr, result2.size);
+}
+
+TEST(SegregatorResourceTests, pages) {
+  segregator_resource<64_KiB, regular_pages_resource, os_resource> seg;
+
+  const auto page_size = os_resource::get_page_size();
+  for (const size_t size : { size_t(page_size), size_t(1_MiB) }) {
+    const auto ptr = static_cast<char*>(seg.allocate(size));
+    ASSERT_NE(ptr, nullptr);
+    ptr[0] = ptr[size - 1] = 'x';
+    seg.deallocate(ptr, size);
+  }
+}
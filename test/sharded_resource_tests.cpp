@@ -0,0 +1,179 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+#include "memaw/sharded_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+using shrt_upstream_t =
+  test_resource<resource_params{ .nothrow_alloc = true,
+                                 .nothrow_dealloc = true,
+                                 .min_size = 64, .alignment = 64,
+                                 .is_granular = true,
+                                 .is_sweeping = true,
+                                 .is_thread_safe = true }>;
+
+constexpr sharded_resource_config shrt_per_thread = {
+  .selection = shard_selection::per_thread
+};
+
+using shrt_sharded_t = sharded_resource<shrt_upstream_t, 4, shrt_per_thread>;
+
+/**
+ * @brief A thread safe resource that allocates from its own buffer
+ *        and is not interchangeable with its other instances
+ **/
+class shrt_range_resource {
+public:
+  constexpr static bool is_thread_safe = true;
+
+  void* allocate(const size_t size, const size_t = 1) noexcept {
+    const auto offset = offset_.fetch_add(size, std::memory_order_relaxed);
+    return offset + size <= buffer_.size() ? &buffer_[offset] : nullptr;
+  }
+
+  void deallocate(void*, size_t, size_t = 1) noexcept {
+    deallocations_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool owns(const void* const ptr) const noexcept {
+    return ptr >= buffer_.data() && ptr < buffer_.data() + buffer_.size();
+  }
+
+  size_t deallocations() const noexcept {
+    return deallocations_.load(std::memory_order_relaxed);
+  }
+
+  bool operator==(const shrt_range_resource& rhs) const noexcept {
+    return this == &rhs;
+  }
+
+private:
+  std::array<std::byte, 1_KiB> buffer_;
+  std::atomic<size_t> offset_ = 0;
+  std::atomic<size_t> deallocations_ = 0;
+};
+
+using shrt_range_sharded_t =
+  sharded_resource<shrt_range_resource, 4, shrt_per_thread>;
+
+size_t dispatch_deallocate(const shrt_range_sharded_t& res, void* const ptr,
+                           size_t, size_t) noexcept {
+  for (size_t i = 0; i < shrt_range_sharded_t::shards_count; ++i)
+    if (res.shard(i).owns(ptr)) return i;
+  return 0;
+}
+
+TEST(ShardedResourceTests, concepts) {
+  EXPECT_TRUE(resource<shrt_sharded_t>);
+  EXPECT_TRUE(nothrow_resource<shrt_sharded_t>);
+  EXPECT_TRUE(granular_resource<shrt_sharded_t>);
+  EXPECT_TRUE(overaligning_resource<shrt_sharded_t>);
+  EXPECT_TRUE(sweeping_resource<shrt_sharded_t>);
+  EXPECT_TRUE(thread_safe_resource<shrt_sharded_t>);
+
+  EXPECT_EQ(shrt_sharded_t::min_size(), 64);
+  EXPECT_EQ(shrt_sharded_t::guaranteed_alignment(), 64);
+  EXPECT_TRUE((interchangeable_resource_with<shrt_sharded_t,
+                                             shrt_upstream_t>));
+
+  // The shards are not interchangeable, but have a dispatcher
+  EXPECT_TRUE(nothrow_resource<shrt_range_sharded_t>);
+  EXPECT_FALSE(sweeping_resource<shrt_range_sharded_t>);
+
+  // No dispatcher for pools, so no deallocate() as well
+  using pool_sharded_t =
+    sharded_resource<pool_resource<regular_pages_resource>, 2>;
+  EXPECT_FALSE(resource<pool_sharded_t>);
+  EXPECT_TRUE(thread_safe_resource<pool_resource<regular_pages_resource>>);
+}
+
+TEST(ShardedResourceTests, routing) {
+  std::array<mock_resource, 4> mocks;
+  shrt_sharded_t res{[&mocks](const size_t i) {
+    return shrt_upstream_t{mocks[i]};
+  }};
+
+  const auto idx = shrt_sharded_t::current_shard();
+  ASSERT_LT(idx, 4);
+  EXPECT_EQ(shrt_sharded_t::current_shard(), idx);  // per thread
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+  EXPECT_CALL(mocks[idx], allocate(128, 64))
+    .Times(2).WillRepeatedly(Return(ptr));
+  EXPECT_CALL(mocks[idx], deallocate(ptr, 128, 64)).Times(1);
+  EXPECT_CALL(mocks[(idx + 1) % 4], deallocate(ptr, 128, 64)).Times(1);
+
+  EXPECT_EQ(res.allocate(128, 64), ptr);
+  res.deallocate(ptr, 128, 64);
+
+  const auto [result, result_idx] = res.do_allocate(128, 64);
+  EXPECT_EQ(result, ptr);
+  EXPECT_EQ(result_idx, idx);
+  res.deallocate_with((idx + 1) % 4, ptr, 128, 64);
+}
+
+TEST(ShardedResourceTests, dispatch) {
+  shrt_range_sharded_t res;
+
+  // Allocate from every shard in different threads and deallocate in
+  // this one
+  std::array<void*, 4> ptrs;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < ptrs.size(); ++i)
+    threads.emplace_back([&res, &ptrs, i]{ ptrs[i] = res.allocate(64); });
+  for (auto& thread : threads) thread.join();
+
+  // Every region goes back to the shard that owns it
+  std::array<size_t, 4> owned = {};
+  for (const auto ptr : ptrs) {
+    ASSERT_NE(ptr, nullptr);
+    ++owned[dispatch_deallocate(res, ptr, 64, 1)];
+    res.deallocate(ptr, 64);
+  }
+
+  for (size_t i = 0; i < 4; ++i)
+    EXPECT_EQ(res.shard(i).deallocations(), owned[i]);
+}
+
+TEST(ShardedResourceTests, multithreaded) {
+  constexpr size_t threads_count = 8;
+  constexpr size_t iterations = 1000;
+
+  // The default CPU selection with non-interchangeable pools
+  sharded_resource<pool_resource<regular_pages_resource>, 4> res;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threads_count; ++i) {
+    threads.emplace_back([&res]{
+      std::vector<std::pair<void*, size_t>> allocated;
+      for (size_t j = 0; j < iterations; ++j) {
+        const auto result = res.do_allocate(4_KiB);
+        ASSERT_NE(result.first, nullptr);
+        ASSERT_LT(result.second, 4);
+        allocated.push_back(result);
+      }
+
+      for (const auto& [ptr, idx] : allocated)
+        res.deallocate_with(idx, ptr, 4_KiB);
+    });
+  }
+
+  for (auto& thread : threads) thread.join();
+}
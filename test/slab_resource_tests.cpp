@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <latch>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/segregator_resource.hpp"
+#include "memaw/slab_resource.hpp"
+#include "memaw/stats_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using slrt_upstream_t = stats_resource<regular_pages_resource>;
+
+template <bool _thread_safe>
+constexpr slab_resource_config slrt_config = {
+  .slab_size = pow2_t{4_KiB},
+  .block_size = 16_KiB,
+  .thread_safe = _thread_safe
+};
+
+template <size_t _object_size, bool _thread_safe = true>
+using slrt_slab_t =
+  slab_resource<slrt_upstream_t, _object_size, slrt_config<_thread_safe>>;
+
+TEST(SlabResourceTests, concepts) {
+  using slab1_t = slrt_slab_t<16>;
+  using slab2_t = slrt_slab_t<192, false>;
+
+  EXPECT_TRUE(resource<slab1_t>);
+  EXPECT_TRUE(nothrow_resource<slab1_t>);
+  EXPECT_TRUE(thread_safe_resource<slab1_t>);
+  EXPECT_FALSE(bound_resource<slab1_t>);
+  EXPECT_FALSE(sweeping_resource<slab1_t>);
+  EXPECT_FALSE(overaligning_resource<slab1_t>);
+
+  EXPECT_FALSE(thread_safe_resource<slab2_t>);
+  EXPECT_TRUE(overaligning_resource<slab2_t>);
+  EXPECT_EQ(slab2_t::guaranteed_alignment(), 64);
+
+  EXPECT_FALSE((thread_safe_resource<slab_resource<test_resource<>, 64>>));
+  EXPECT_TRUE((thread_safe_resource<slab_resource<regular_pages_resource,
+                                                  64>>));
+
+  // The header takes (a part of) the first slot (its free list is
+  // one word smaller without DWCAS)
+  EXPECT_EQ(slab1_t::slots_per_slab,
+            4_KiB / 16 - (__detail::use_dwcas ? 3 : 2));
+  EXPECT_EQ(slab2_t::slots_per_slab, (4_KiB - 64) / 192);
+
+  // Slabs of several sizes
+  using sizes_t =
+    segregator_resource<32, slrt_slab_t<32>,
+                        segregator_resource<64, slrt_slab_t<64>,
+                                            regular_pages_resource>>;
+  EXPECT_TRUE(resource<sizes_t>);
+  EXPECT_TRUE(thread_safe_resource<sizes_t>);
+}
+
+template <typename T>
+class SlabResourceAllocationTests: public testing::Test {};
+
+using SlrtTypes = testing::Types<slrt_slab_t<16>, slrt_slab_t<48, false>,
+                                 slrt_slab_t<256>>;
+TYPED_TEST_SUITE(SlabResourceAllocationTests, SlrtTypes);
+
+TYPED_TEST(SlabResourceAllocationTests, allocation) {
+  constexpr size_t object_size = TypeParam::object_size;
+  constexpr size_t slots = TypeParam::slots_per_slab;
+
+  TypeParam slab;
+
+  EXPECT_EQ(slab.allocate(object_size + 1), nullptr);
+  EXPECT_EQ(slab.allocate(object_size, 4_KiB), nullptr);
+  EXPECT_EQ(slab.upstream().get_stats().allocations, 0);
+
+  // A slab is allocated sequentially
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < slots; ++i) {
+    const auto ptr = slab.allocate(i % 2 ? object_size : 1);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(uintptr_t(ptr) % alignof(std::max_align_t), 0);
+
+    if (!ptrs.empty()) {
+      EXPECT_EQ(uintptr_t(ptr), uintptr_t(ptrs.back()) + object_size);
+    }
+    ptrs.push_back(ptr);
+  }
+
+  // All in the same slab of the first block
+  EXPECT_EQ(uintptr_t(ptrs.front()) & ~(4_KiB - 1),
+            uintptr_t(ptrs.back()) & ~(4_KiB - 1));
+  EXPECT_EQ(slab.count_free_slots(), 3 * slots);
+
+  auto stats = slab.upstream().get_stats();
+  EXPECT_EQ(stats.allocations, 1);
+  EXPECT_EQ(stats.allocated_bytes, 16_KiB);
+
+  // Then go the other slabs and blocks
+  for (size_t i = 0; i < 4 * slots; ++i) {
+    const auto ptr = slab.allocate(object_size);
+    ASSERT_NE(ptr, nullptr);
+    ptrs.push_back(ptr);
+  }
+
+  stats = slab.upstream().get_stats();
+  EXPECT_EQ(stats.allocations, 2);
+  EXPECT_EQ(slab.count_free_slots(), 3 * slots);
+
+  std::set<void*> unique_ptrs(ptrs.begin(), ptrs.end());
+  EXPECT_EQ(unique_ptrs.size(), ptrs.size());
+
+  // The freed slots are reused in the LIFO order
+  slab.deallocate(ptrs[5], object_size);
+  slab.deallocate(ptrs[7], 1);
+  EXPECT_EQ(slab.count_free_slots(), 3 * slots + 2);
+
+  EXPECT_EQ(slab.allocate(object_size), ptrs[7]);
+  EXPECT_EQ(slab.allocate(object_size), ptrs[5]);
+
+  for (const auto ptr : ptrs) slab.deallocate(ptr, object_size);
+  EXPECT_EQ(slab.count_free_slots(), 8 * slots);
+
+  // Nothing is returned to the upstream before the destruction
+  EXPECT_EQ(slab.upstream().get_stats().deallocations, 0);
+
+  // Now the free slots are spread over (all) the slabs, but each of
+  // them is filled before the next one is taken
+  for (size_t i = 0; i < slots; ++i) ptrs[i] = slab.allocate(object_size);
+
+  const auto first_slab = uintptr_t(ptrs.front()) & ~(4_KiB - 1);
+  for (size_t i = 0; i < slots; ++i)
+    EXPECT_EQ(uintptr_t(ptrs[i]) & ~(4_KiB - 1), first_slab);
+
+  for (size_t i = 0; i < slots; ++i) slab.deallocate(ptrs[i], object_size);
+  EXPECT_EQ(slab.upstream().get_stats().allocations, 2);
+}
+
+TEST(SlabResourceTests, move) {
+  slrt_slab_t<64> slab1;
+
+  const auto ptr = slab1.allocate(64);
+  ASSERT_NE(ptr, nullptr);
+
+  slrt_slab_t<64> slab2{std::move(slab1)};
+  EXPECT_EQ(slab1.count_free_slots(), 0);
+  EXPECT_EQ(slab2.count_free_slots(),
+            4 * slrt_slab_t<64>::slots_per_slab - 1);
+
+  slab2.deallocate(ptr, 64);
+  EXPECT_EQ(slab2.allocate(64), ptr);
+  slab2.deallocate(ptr, 64);
+}
+
+TEST(SlabResourceTests, randomized_multithread) {
+  using slab_t = slrt_slab_t<32>;
+
+  constexpr size_t threads_count = 8;
+  constexpr size_t iterations = 20000;
+  constexpr size_t max_live = 200;
+
+  slab_t slab;
+
+  std::latch latch(threads_count);
+  std::array<std::vector<uint64_t*>, threads_count> leftovers;
+
+  std::vector<std::thread> threads;
+  threads.reserve(threads_count);
+
+  for (size_t i = 0; i < threads_count; ++i)
+    threads.emplace_back([&](const size_t id) {
+      latch.arrive_and_wait();  // All threads start at the same time
+
+      std::vector<uint64_t*> live;
+      for (size_t j = 0; j < iterations; ++j) {
+        if (live.size() < max_live && (live.empty() || rand() % 2)) {
+          const auto ptr = static_cast<uint64_t*>(slab.allocate(32));
+          ASSERT_NE(ptr, nullptr);
+
+          // Mark every object with the thread id and its address
+          std::fill_n(ptr, 4, uint64_t(ptr) ^ id);
+          live.push_back(ptr);
+        }
+        else {
+          const auto it = live.begin() + (rand() % live.size());
+          const auto ptr = *it;
+          for (size_t k = 0; k < 4; ++k)
+            EXPECT_EQ(ptr[k], uint64_t(ptr) ^ id);
+
+          // Some of the objects are freed by another thread
+          if (rand() % 4 == 0)
+            leftovers[(id + 1) % threads_count].push_back(ptr);
+          else slab.deallocate(ptr, 32);
+
+          *it = live.back();
+          live.pop_back();
+        }
+      }
+
+      for (const auto ptr : live) slab.deallocate(ptr, 32);
+    }, i);
+
+  for (auto& thread : threads) thread.join();
+
+  size_t leftovers_count = 0;
+  threads.clear();
+  for (size_t i = 0; i < threads_count; ++i) {
+    leftovers_count+= leftovers[i].size();
+    threads.emplace_back([&slab, &leftovers](const size_t id) {
+      for (const auto ptr : leftovers[id]) slab.deallocate(ptr, 32);
+    }, i);
+  }
+
+  for (auto& thread : threads) thread.join();
+
+  // Everything is free now
+  const auto stats = slab.upstream().get_stats();
+  EXPECT_EQ(slab.count_free_slots(),
+            stats.allocated_bytes / 4_KiB * slab_t::slots_per_slab);
+  EXPECT_GT(leftovers_count, 0);
+}
@@ -0,0 +1,189 @@
+#include <array>
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+#include "memaw/stats_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+using srt_upstream_t =
+  test_resource<resource_params{ .nothrow_alloc = true,
+                                 .nothrow_dealloc = true,
+                                 .min_size = 64, .alignment = 64,
+                                 .is_granular = true,
+                                 .is_sweeping = true,
+                                 .is_thread_safe = true,
+                                 .group = {1, 1} }>;
+
+using srt_stats_t =
+  stats_resource<srt_upstream_t,
+                 stats_resource_config{ .shards_count = 4,
+                                        .peak_granularity = 1_KiB }>;
+
+// Not thread safe, so the peak is exact
+using srt_exact_stats_t =
+  stats_resource<test_resource<resource_params{ .nothrow_alloc = true,
+                                                .nothrow_dealloc = true }>>;
+
+TEST(StatsResourceTests, concepts) {
+  EXPECT_TRUE(resource<srt_stats_t>);
+  EXPECT_TRUE(nothrow_resource<srt_stats_t>);
+  EXPECT_TRUE(granular_resource<srt_stats_t>);
+  EXPECT_TRUE(overaligning_resource<srt_stats_t>);
+  EXPECT_TRUE(sweeping_resource<srt_stats_t>);
+  EXPECT_TRUE(thread_safe_resource<srt_stats_t>);
+  EXPECT_FALSE(purging_resource<srt_stats_t>);
+
+  EXPECT_EQ(srt_stats_t::min_size(), 64);
+  EXPECT_EQ(srt_stats_t::guaranteed_alignment(), 64);
+
+  EXPECT_FALSE(nothrow_resource<stats_resource<test_resource<>>>);
+  EXPECT_FALSE(bound_resource<stats_resource<test_resource<>>>);
+
+  EXPECT_TRUE((interchangeable_resource_with<srt_stats_t, srt_upstream_t>));
+
+  using pages_stats_t = stats_resource<regular_pages_resource>;
+  EXPECT_TRUE(purging_resource<pages_stats_t>);
+  EXPECT_TRUE((interchangeable_resource_with<pages_stats_t,
+                                             regular_pages_resource>));
+}
+
+TEST(StatsResourceTests, counters) {
+  mock_resource mock;
+  srt_exact_stats_t res{mock};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+
+  auto stats = res.get_stats();
+  EXPECT_EQ(stats.allocations, 0);
+  EXPECT_EQ(stats.live_bytes, 0);
+  EXPECT_EQ(stats.peak_bytes, 0);
+
+  EXPECT_CALL(mock, allocate(_, _)).WillRepeatedly(Return(ptr));
+  EXPECT_CALL(mock, allocate(4_KiB, _)).WillOnce(Return(nullptr));
+  EXPECT_CALL(mock, deallocate(ptr, _, _)).Times(3);
+
+  EXPECT_EQ(res.allocate(64), ptr);
+  EXPECT_EQ(res.allocate(128), ptr);
+  EXPECT_EQ(res.allocate(192), ptr);
+  EXPECT_EQ(res.allocate(4_KiB), nullptr);
+
+  stats = res.get_stats();
+  EXPECT_EQ(stats.allocations, 3);
+  EXPECT_EQ(stats.failed_allocations, 1);
+  EXPECT_EQ(stats.deallocations, 0);
+  EXPECT_EQ(stats.allocated_bytes, 384);
+  EXPECT_EQ(stats.live_bytes, 384);
+  EXPECT_EQ(stats.peak_bytes, 384);
+
+  EXPECT_EQ(stats.size_histogram[6], 1);  // 64
+  EXPECT_EQ(stats.size_histogram[7], 1);  // 128
+  EXPECT_EQ(stats.size_histogram[8], 1);  // 192
+  EXPECT_EQ(stats.size_histogram[12], 0); // 4KiB (failed)
+
+  res.deallocate(ptr, 128);
+  res.deallocate(ptr, 192);
+  res.deallocate(ptr, 64);
+
+  stats = res.get_stats();
+  EXPECT_EQ(stats.deallocations, 3);
+  EXPECT_EQ(stats.deallocated_bytes, 384);
+  EXPECT_EQ(stats.live_bytes, 0);
+  EXPECT_EQ(stats.peak_bytes, 384);
+}
+
+TEST(StatsResourceTests, peak) {
+  mock_resource mock;
+  srt_stats_t res{srt_upstream_t{mock}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+  EXPECT_CALL(mock, allocate(_, _)).WillRepeatedly(Return(ptr));
+  EXPECT_CALL(mock, deallocate(ptr, _, _)).WillRepeatedly(Return());
+
+  // Bigger changes are flushed right away
+  EXPECT_EQ(res.allocate(8_KiB), ptr);
+  res.deallocate(ptr, 8_KiB);
+
+  EXPECT_EQ(res.allocate(2_KiB), ptr);
+  res.deallocate(ptr, 2_KiB);
+
+  const auto stats = res.get_stats();
+  EXPECT_EQ(stats.live_bytes, 0);
+  EXPECT_EQ(stats.peak_bytes, 8_KiB);
+}
+
+TEST(StatsResourceTests, multithreaded) {
+  constexpr size_t threads_count = 4;
+  constexpr size_t iterations = 1000;
+
+  mock_resource mock;
+  srt_stats_t res{srt_upstream_t{mock}};
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+  EXPECT_CALL(mock, allocate(64, _)).WillRepeatedly(Return(ptr));
+  EXPECT_CALL(mock, deallocate(ptr, 64, _)).WillRepeatedly(Return());
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threads_count; ++i) {
+    threads.emplace_back([&res, ptr]() {
+      for (size_t j = 0; j < iterations; ++j) {
+        EXPECT_EQ(res.allocate(64), ptr);
+        res.deallocate(ptr, 64);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const auto stats = res.get_stats();
+  EXPECT_EQ(stats.allocations, threads_count * iterations);
+  EXPECT_EQ(stats.deallocations, threads_count * iterations);
+  EXPECT_EQ(stats.size_histogram[6], threads_count * iterations);
+  EXPECT_EQ(stats.live_bytes, 0);
+  EXPECT_LE(stats.peak_bytes, threads_count * 64);
+}
+
+TEST(StatsResourceTests, pool_upstream) {
+  using upstream_t =
+    stats_resource<test_resource<resource_params{ .is_sweeping = true }>>;
+
+  using pool_t =
+    pool_resource<upstream_t,
+                  pool_resource_config{ .min_chunk_size = pow2_t{1_KiB},
+                                        .max_chunk_size = 4_KiB,
+                                        .chunk_size_multiplier = 2,
+                                        .thread_safe = false }>;
+
+  constexpr size_t block_size = 8_KiB;
+  alignas(1_KiB) static std::byte block[block_size];
+
+  mock_resource mock;
+  EXPECT_CALL(mock, allocate(block_size, 1_KiB)).WillOnce(Return(block));
+
+  auto pool = std::make_unique<pool_t>(upstream_t{mock});
+
+  // The blocks the pool grows by are seen in the upstream stats
+  std::array<void*, 3> ptrs;
+  for (auto& ptr : ptrs) ptr = pool->allocate(2_KiB);
+
+  auto stats = pool->upstream().get_stats();
+  EXPECT_EQ(stats.allocations, 1);
+  EXPECT_EQ(stats.live_bytes, block_size);
+
+  for (const auto ptr : ptrs) pool->deallocate(ptr, 2_KiB);
+
+  EXPECT_CALL(mock, deallocate(block, block_size, 1_KiB));
+  pool.reset();
+}
@@ -9,6 +9,8 @@ using namespace memaw;
 struct mock_resource {
   MOCK_METHOD(void*, allocate, (size_t, size_t));
   MOCK_METHOD(void, deallocate, (void*, size_t, size_t));
+  MOCK_METHOD(void, purge, (void*, size_t));
+  MOCK_METHOD(bool, expand, (void*, size_t, size_t));
 };
 
 struct resource_params {
@@ -21,6 +23,8 @@ struct resource_params {
   bool is_granular = false;
   bool is_sweeping = false;
   bool is_thread_safe = false;
+  bool is_purging = false;
+  bool is_expanding = false;
 
   std::pair<int, int> group = { 0, 0 };
 };
@@ -60,6 +64,16 @@ struct test_resource {
     mock->deallocate(ptr, size, alignment);
   }
 
+  void purge(void* const ptr, const size_t size) noexcept
+    requires(_params.is_purging) {
+    mock->purge(ptr, size);
+  }
+
+  bool expand(void* const ptr, const size_t old_size, const size_t new_size)
+    noexcept requires(_params.is_expanding) {
+    return mock->expand(ptr, old_size, new_size);
+  }
+
   bool operator==(const test_resource&) const noexcept = default;
 
   mock_resource* mock = nullptr;
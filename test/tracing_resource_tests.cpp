@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "memaw/concepts.hpp"
+#include "memaw/literals.hpp"
+#include "memaw/pages_resource.hpp"
+#include "memaw/pool_resource.hpp"
+#include "memaw/tracing_resource.hpp"
+
+#include "test_resource.hpp"
+
+using namespace memaw;
+
+using testing::_;
+using testing::Return;
+
+using trt_upstream_t =
+  test_resource<resource_params{ .nothrow_alloc = true,
+                                 .nothrow_dealloc = true,
+                                 .min_size = 64, .alignment = 64,
+                                 .is_granular = true,
+                                 .is_sweeping = true,
+                                 .is_thread_safe = true,
+                                 .group = {1, 1} }>;
+
+using trt_tracing_t =
+  tracing_resource<trt_upstream_t,
+                   tracing_resource_config{ .buffer_size = 4 }>;
+
+/**
+ * @brief A temporary file to write a trace to, read back in full
+ **/
+class trt_trace_file {
+public:
+  trt_trace_file(): file_(std::tmpfile()) {}
+
+  trt_trace_file(const trt_trace_file&) = delete;
+  trt_trace_file& operator=(const trt_trace_file&) = delete;
+
+  ~trt_trace_file() {
+    if (file_) std::fclose(file_);
+  }
+
+  std::FILE* get() const noexcept {
+    return file_;
+  }
+
+  std::vector<trace_record> read() const {
+    std::fflush(file_);
+    std::rewind(file_);
+
+    std::vector<trace_record> result;
+    trace_record record;
+    while (std::fread(&record, sizeof(record), 1, file_) == 1)
+      result.push_back(record);
+
+    std::fseek(file_, 0, SEEK_END);
+    return result;
+  }
+
+private:
+  std::FILE* file_;
+};
+
+TEST(TracingResourceTests, concepts) {
+  EXPECT_TRUE(resource<trt_tracing_t>);
+  EXPECT_TRUE(nothrow_resource<trt_tracing_t>);
+  EXPECT_TRUE(granular_resource<trt_tracing_t>);
+  EXPECT_TRUE(overaligning_resource<trt_tracing_t>);
+  EXPECT_TRUE(sweeping_resource<trt_tracing_t>);
+  EXPECT_TRUE(thread_safe_resource<trt_tracing_t>);
+  EXPECT_FALSE(purging_resource<trt_tracing_t>);
+
+  EXPECT_EQ(trt_tracing_t::min_size(), 64);
+  EXPECT_EQ(trt_tracing_t::guaranteed_alignment(), 64);
+
+  EXPECT_FALSE(nothrow_resource<tracing_resource<test_resource<>>>);
+  EXPECT_TRUE((interchangeable_resource_with<trt_tracing_t, trt_upstream_t>));
+
+  EXPECT_TRUE(purging_resource<tracing_resource<regular_pages_resource>>);
+}
+
+TEST(TracingResourceTests, records) {
+  trt_trace_file file;
+  ASSERT_NE(file.get(), nullptr);
+
+  mock_resource mock;
+  auto res =
+    std::make_unique<trt_tracing_t>(file.get(), trt_upstream_t{mock});
+
+  const auto ptr = reinterpret_cast<void*>(uintptr_t(1_KiB));
+  EXPECT_CALL(mock, allocate(_, _)).WillRepeatedly(Return(ptr));
+  EXPECT_CALL(mock, allocate(4_KiB, _)).WillOnce(Return(nullptr));
+  EXPECT_CALL(mock, deallocate(ptr, _, _)).Times(2);
+
+  EXPECT_EQ(res->allocate(64), ptr);
+  EXPECT_EQ(res->allocate(128, 256), ptr);
+  EXPECT_EQ(res->allocate(4_KiB), nullptr);
+
+  // Nothing is written until the buffer is full
+  EXPECT_TRUE(file.read().empty());
+
+  res->deallocate(ptr, 128, 256);
+  EXPECT_EQ(file.read().size(), 4);
+
+  res->deallocate(ptr, 64);
+  EXPECT_EQ(file.read().size(), 4);
+  EXPECT_TRUE(res->flush());
+
+  const auto records = file.read();
+  ASSERT_EQ(records.size(), 5);
+
+  const auto expect_record = [&records](const size_t i,
+                                        const trace_event event,
+                                        const void* const ptr,
+                                        const size_t size,
+                                        const size_t alignment_log) {
+    EXPECT_EQ(records[i].event, event);
+    EXPECT_EQ(records[i].address, uintptr_t(ptr));
+    EXPECT_EQ(records[i].size, size);
+    EXPECT_EQ(records[i].alignment_log, alignment_log);
+    EXPECT_EQ(records[i].thread, 0);
+    if (i) {
+      EXPECT_GE(records[i].timestamp, records[i-1].timestamp);
+    }
+  };
+
+  const auto default_log = std::countr_zero(alignof(std::max_align_t));
+  expect_record(0, trace_event::allocate, ptr, 64, default_log);
+  expect_record(1, trace_event::allocate, ptr, 128, 8);
+  expect_record(2, trace_event::failed_allocate, nullptr, 4_KiB, default_log);
+  expect_record(3, trace_event::deallocate, ptr, 128, 8);
+  expect_record(4, trace_event::deallocate, ptr, 64, default_log);
+
+  // The moved-from instance stops tracing
+  EXPECT_CALL(mock, deallocate(ptr, 64, _));
+  trt_tracing_t res2{std::move(*res)};
+  res->deallocate(ptr, 64);
+  res.reset();
+  EXPECT_EQ(file.read().size(), 5);
+}
+
+TEST(TracingResourceTests, multithreaded) {
+  constexpr size_t threads_count = 4;
+  constexpr size_t iterations = 1000;
+
+  trt_trace_file file;
+  ASSERT_NE(file.get(), nullptr);
+
+  {
+    // NB: the upstream of the pool has no file, so it records nothing
+    using tracing_pages_t = tracing_resource<regular_pages_resource>;
+    using pool_t = pool_resource<tracing_pages_t>;
+
+    tracing_resource<pool_t> res{file.get(),
+                                 pool_t{tracing_pages_t{nullptr}}};
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threads_count; ++i) {
+      threads.emplace_back([&res]() {
+        for (size_t j = 0; j < iterations; ++j) {
+          const auto ptr = res.allocate(1_KiB);
+          ASSERT_NE(ptr, nullptr);
+          res.deallocate(ptr, 1_KiB);
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+
+  const auto records = file.read();
+  ASSERT_EQ(records.size(), threads_count * iterations * 2);
+
+  // Every thread has its own index and its records are in order
+  std::vector<std::vector<trace_record>> by_thread(threads_count);
+  for (const auto& record : records) {
+    ASSERT_LT(record.thread, threads_count);
+    by_thread[record.thread].push_back(record);
+  }
+
+  for (const auto& thread_records : by_thread) {
+    ASSERT_EQ(thread_records.size(), iterations * 2);
+    for (size_t i = 0; i < thread_records.size(); ++i) {
+      EXPECT_EQ(thread_records[i].event,
+                i % 2 ? trace_event::deallocate : trace_event::allocate);
+      if (i) {
+        EXPECT_GE(thread_records[i].timestamp,
+                  thread_records[i-1].timestamp);
+      }
+    }
+  }
+  // Ordered by the timestamps, every deallocation comes after the
+  // allocation of the same address and before its next allocation
+  std::vector<trace_record> sorted = records;
+  std::ranges::stable_sort(sorted, {}, &trace_record::timestamp);
+
+  std::set<uint64_t> live;
+  for (const auto& record : sorted) {
+    if (record.event == trace_event::allocate) {
+      EXPECT_TRUE(live.insert(record.address).second);
+    }
+    else {
+      EXPECT_EQ(live.erase(record.address), 1);
+    }
+  }
+  EXPECT_TRUE(live.empty());
+}